@@ -0,0 +1,292 @@
+/* ------------------------------------------------------------------------------
+|
+| Throughput benchmarks for RegexLT_
+|
+| Runs a fixed set of corpora, each with a regex typical for that kind of input, through
+| RegexLT_MatchProg(), RegexLT_Match() and RegexLT_ReplaceProg(). For each reports:
+|
+|     - MB/s, matches/s and ns per call
+|     - compile time, ns per RegexLT_Compile()
+|     - getMem() calls and peak heap per call
+|     - threads made per call and the most live at once; from RegexLT_MatchProgStats(), in a
+|       pass of its own, so the counting isn't timed
+|
+| The corpora are made here from a fixed seed, so every build runs the same input. Results
+| are printed as a table and also written as CSV to the file named on the command line
+| (default 'bench_results.csv'); so runs on different commits may be compared.
+|
+|     bench [results.csv] [iterations]
+|
+--------------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include "libs_support.h"
+#include "util.h"
+#include "regexlt.h"
+
+#define _LinesPerCorpus  200
+#define _MaxLineLen      120
+#define _DefaultIters    20
+
+PUBLIC U16 tdd_TestNum;       // The library labels debug prints with this.
+
+/* ------------------------------------ Counting allocator ----------------------------------
+
+   Each block carries its size ahead of it, so free() can take it off the live count.
+*/
+typedef struct { U32 calls; size_t live, peak; } S_MemCnt;
+
+PRIVATE S_MemCnt memCnt = {0};
+
+PRIVATE void * getMemCounted(size_t numBytes)
+{
+   size_t *p;
+   if( (p = malloc(numBytes + sizeof(size_t))) == NULL)
+      { return NULL; }
+   *p = numBytes;
+   memCnt.calls++;
+   if( (memCnt.live += numBytes) > memCnt.peak)
+      { memCnt.peak = memCnt.live; }
+   return memset(p+1, 0, numBytes);
+}
+
+PRIVATE void freeCounted(void *mem)
+{
+   if(mem != NULL) {
+      size_t *p = (size_t*)mem - 1;
+      memCnt.live -= *p;
+      free(p); }
+}
+
+PRIVATE void memCnt_Restart(void)
+   { memCnt.calls = 0; memCnt.peak = memCnt.live; }
+
+PRIVATE RegexLT_S_Cfg const cfg = {
+   .getMem        = getMemCounted,
+   .free          = freeCounted,
+   .printEnable   = FALSE,
+   .maxSubmatches = 9,
+   .maxRegexLen   = MAX_U8,
+   .maxStrLen     = _MaxLineLen + 1 };
+
+/* ------------------------------------------ Timing ------------------------------------------ */
+
+PRIVATE double nowNs(void)
+{
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+/* ------------------------------------------ Corpora -----------------------------------------
+
+   Made from a fixed-seed LCG, so the same on every run.
+*/
+PRIVATE U32 seed;
+
+PRIVATE U32 rnd(U32 n)
+   { seed = seed * 1103515245UL + 12345UL; return (seed >> 16) % n; }
+
+PRIVATE C8 const * pick(C8 const * const *lst, U8 cnt)
+   { return lst[rnd(cnt)]; }
+
+#define _Pick(lst) pick((lst), RECORDS_IN(lst))
+
+PRIVATE void mkNMEA(C8 *out)
+{
+   C8 const * const sentences[] = { "GPGGA", "GPRMC", "GPGSV", "GPVTG" };
+   snprintf(out, _MaxLineLen, "$%s,%02u%02u%02u.00,%02u%02u.%03u,N,%03u%02u.%03u,E,1,%02u,0.9,%u.%u,M,46.9,M,,*%02X",
+      _Pick(sentences), rnd(24), rnd(60), rnd(60), rnd(90), rnd(60), rnd(1000), rnd(180), rnd(60), rnd(1000),
+      rnd(12), rnd(900), rnd(10), rnd(256));
+}
+
+PRIVATE void mkAT(C8 *out)
+{
+   switch(rnd(5)) {
+      case 0:  snprintf(out, _MaxLineLen, "+CSQ: %u,%u", rnd(32), rnd(100)); break;
+      case 1:  snprintf(out, _MaxLineLen, "+CREG: %u,%u", rnd(3), rnd(6)); break;
+      case 2:  snprintf(out, _MaxLineLen, "+COPS: 0,0,\"Carrier %u\",%u", rnd(100), rnd(8)); break;
+      case 3:  snprintf(out, _MaxLineLen, "ERROR"); break;
+      default: snprintf(out, _MaxLineLen, "OK"); break; }
+}
+
+PRIVATE void mkSyslog(C8 *out)
+{
+   C8 const * const procs[] = { "sshd", "cron", "kernel", "systemd", "dhclient" };
+   C8 const * const msgs[]  = { "Failed password for root", "Accepted publickey for admin", "session opened", "link up", "renewing lease" };
+   snprintf(out, _MaxLineLen, "Oct %2u %02u:%02u:%02u host%u %s[%u]: %s from 10.%u.%u.%u port %u",
+      1+rnd(31), rnd(24), rnd(60), rnd(60), rnd(9), _Pick(procs), rnd(32768), _Pick(msgs), rnd(256), rnd(256), rnd(256), 1024+rnd(60000));
+}
+
+PRIVATE void mkIPs(C8 *out)
+{
+   C8 const * const words[] = { "route", "via", "dev", "eth0", "gw", "src", "metric" };
+   U16 at = 0;
+   while(at < _MaxLineLen - 20)
+   {
+      at += rnd(3) == 0
+         ? snprintf(out+at, _MaxLineLen-at, "%u.%u.%u.%u ", rnd(256), rnd(256), rnd(256), rnd(256))
+         : snprintf(out+at, _MaxLineLen-at, "%s ", _Pick(words));
+   }
+}
+
+PRIVATE void mkText(C8 *out)
+{
+   U16 c;
+   for(c = 0; c < _MaxLineLen-1; c++)
+      { out[c] = rnd(6) == 0 ? ' ' : 'a' + rnd(26); }
+   out[c] = '\0';
+}
+
+typedef struct {
+   C8 const *name;
+   void     (*make)(C8 *out);
+   C8 const *regex, *replace;
+} S_Corpus;
+
+PRIVATE S_Corpus const corpora[] = {
+   { "nmea",    mkNMEA,     "GPGGA,\\d+",                            "fix" },
+   { "at",      mkAT,       "\\+CSQ: \\d+",                          "rssi" },
+   { "syslog",  mkSyslog,   "sshd\\[\\d+\\]: Failed",                 "auth-fail" },
+   { "ip",      mkIPs,      "\\d+\\.\\d+\\.\\d+\\.\\d+",              "<ip>" },
+   { "text",    mkText,     "qu[aeiou]+",                            "Q" },
+};
+
+/* ------------------------------------------ Runs ------------------------------------------ */
+
+typedef enum { E_MatchProg = 0, E_Match, E_ReplaceProg } T_Api;
+
+PRIVATE C8 const *apiNames[] = { "MatchProg", "Match", "ReplaceProg" };
+
+typedef struct {
+   double   ns, compileNs;
+   U32      calls, matches, bytes, mallocs, threads, peakThreads;
+   size_t   peakBytes;
+} S_Result;
+
+PRIVATE void runCorpus(S_Corpus const *c, C8 lines[][_MaxLineLen+1], T_Api api, U16 iters, S_Result *r)
+{
+   void *prog;
+   C8 out[2*_MaxLineLen];
+   U16 it, l;
+
+   *r = (S_Result){0};
+
+   // Compile time; averaged over a few.
+   double t0 = nowNs();
+   for(it = 0; it < iters; it++) {
+      if(RegexLT_Compile(c->regex, &prog) == E_RegexRtn_OK) {
+         RegexLT_FreeProgram(prog); }}
+   r->compileNs = (nowNs() - t0) / iters;
+
+   if(RegexLT_Compile(c->regex, &prog) != E_RegexRtn_OK)
+   {
+      printf("'%s' didn't compile\r\n", c->regex);
+      return;
+   }
+
+   memCnt_Restart();
+   size_t liveAtStart = memCnt.live;
+
+   t0 = nowNs();
+   for(it = 0; it < iters; it++)
+   {
+      for(l = 0; l < _LinesPerCorpus; l++)
+      {
+         RegexLT_S_MatchList *ml = NULL;
+         T_RegexRtn rtn;
+
+         switch(api) {
+            case E_MatchProg:    rtn = RegexLT_MatchProg(prog, lines[l], &ml, _RegexLT_Flags_None); break;
+            case E_Match:        rtn = RegexLT_Match(c->regex, lines[l], &ml, _RegexLT_Flags_None); break;
+            case E_ReplaceProg:
+            default:             rtn = RegexLT_ReplaceProg(prog, lines[l], c->replace, out); break; }
+
+         RegexLT_FreeMatches(ml);
+         r->calls++;
+         r->bytes += strlen(lines[l]);
+         if(rtn == E_RegexRtn_Match) { r->matches++; }
+      }
+   }
+   r->ns = nowNs() - t0;
+   r->mallocs = memCnt.calls;
+   r->peakBytes = memCnt.peak - liveAtStart;
+
+   /* Threads, from a pass of RegexLT_MatchProgStats(), outside the timing. Each of the calls
+      runs this same program, with the same flags, on each line; so it's the same for all.
+   */
+   for(l = 0; l < _LinesPerCorpus; l++)
+   {
+      RegexLT_S_MatchList *ml = NULL;
+      RegexLT_S_Stats st = {0};
+
+      RegexLT_MatchProgStats(prog, lines[l], &ml, _RegexLT_Flags_None, &st);
+      RegexLT_FreeMatches(ml);
+      r->threads += st.threads;
+      if(st.peakThreads > r->peakThreads)
+         { r->peakThreads = st.peakThreads; }
+   }
+
+   RegexLT_FreeProgram(prog);
+}
+
+/* ------------------------------------------ main ------------------------------------------ */
+
+int main(int argc, char **argv)
+{
+   C8 const *csvName = argc > 1 ? argv[1] : "bench_results.csv";
+   U16 iters = argc > 2 ? atoi(argv[2]) : _DefaultIters;
+   FILE *csv;
+   static C8 lines[_LinesPerCorpus][_MaxLineLen+1];
+   U8 c; T_Api api; U16 l;
+
+   if(iters == 0)
+      { iters = 1; }
+
+   if( (csv = fopen(csvName, "w")) == NULL)
+   {
+      printf("Couldn't open '%s'\r\n", csvName);
+      return 1;
+   }
+   RegexLT_Init(&cfg);
+
+   fprintf(csv, "corpus,api,regex,calls,matches,bytes,ns_total,mb_per_s,matches_per_s,ns_per_call,compile_ns,mallocs_per_call,peak_bytes,threads_per_call,peak_threads\n");
+   printf("%-8s %-12s %9s %12s %10s %11s %10s %9s %9s %9s\r\n",
+      "corpus", "api", "MB/s", "matches/s", "ns/call", "compile ns", "mallocs", "peak B", "threads", "peak thr");
+
+   for(c = 0; c < RECORDS_IN(corpora); c++)
+   {
+      S_Corpus const *cp = &corpora[c];
+
+      for(seed = 1 + c, l = 0; l < _LinesPerCorpus; l++)
+         { cp->make(lines[l]); }
+
+      for(api = E_MatchProg; api <= E_ReplaceProg; api++)
+      {
+         S_Result r;
+         runCorpus(cp, lines, api, iters, &r);
+
+         double secs = r.ns / 1e9;
+         double mbps = secs > 0 ? r.bytes / secs / 1e6 : 0;
+         double mps  = secs > 0 ? r.matches / secs : 0;
+         double nspc = r.calls > 0 ? r.ns / r.calls : 0;
+         double mpc  = r.calls > 0 ? (double)r.mallocs / r.calls : 0;
+         double tpc  = (double)r.threads / _LinesPerCorpus;             // From the one untimed pass.
+
+         printf("%-8s %-12s %9.2f %12.0f %10.0f %11.0f %10.1f %9lu %9.1f %9lu\r\n",
+            cp->name, apiNames[api], mbps, mps, nspc, r.compileNs, mpc, (unsigned long)r.peakBytes, tpc, (unsigned long)r.peakThreads);
+         fprintf(csv, "%s,%s,\"%s\",%lu,%lu,%lu,%.0f,%.3f,%.0f,%.1f,%.0f,%.2f,%lu,%.1f,%lu\n",
+            cp->name, apiNames[api], cp->regex, (unsigned long)r.calls, (unsigned long)r.matches, (unsigned long)r.bytes,
+            r.ns, mbps, mps, nspc, r.compileNs, mpc, (unsigned long)r.peakBytes, tpc, (unsigned long)r.peakThreads);
+      }
+   }
+   fclose(csv);
+   return 0;
+}
+
+// ----------------------------------------- eof --------------------------------------------
@@ -0,0 +1,38 @@
+# ------------------------------------------------------------------
+#
+# Throughput benchmarks for RegexLT_. Optimised build; not TDD.
+#
+#     make -f bench.mak            - build 'bench'
+#     make -f bench.mak run        - build and run; results to bench_results.csv
+#
+# ---------------------------------------------------------------------
+
+TARGET = bench
+
+# Library sources; same places as for the unit tests.
+SRCDIR = ../src/
+
+CC = gcc
+CFLAGS = -O2 -std=gnu11 -D__COMPILER_IS_GENERIC__ -D__SYSTEM_IS_ANY__ -D__TARGET_IS_CONSOLE
+
+INC_DIRS = -I. -I../src -I$(SPJ_SWR_LOC)/util/public -I$(SPJ_SWR_LOC)/arith/public -I$(SPJ_SWR_LOC)/tiny2/GenericTypes
+
+SRC_FILES = bench.c $(wildcard $(SRCDIR)regexlt*.c)
+
+# 'util' and 'arith' support, as linked for the unit tests, come in through LIBS.
+LIBS ?=
+
+all: $(TARGET)
+
+$(TARGET): $(SRC_FILES)
+	$(CC) $(CFLAGS) $(INC_DIRS) $(SRC_FILES) $(LIBS) -o $(TARGET)
+
+run: $(TARGET)
+	./$(TARGET) bench_results.csv
+
+clean:
+	rm -f $(TARGET) bench_results.csv
+
+.PHONY: all run clean
+
+# ------------------------------- eof ------------------------------------
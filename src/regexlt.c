@@ -28,7 +28,13 @@
 |  Public:
 |     RegexLT_Init()
 |     RegexLT_Compile()
+|     RegexLT_ProgramSize()
+|     RegexLT_MemRequired()
+|     RegexLT_Analyze()
 |     RegexLT_MatchProg()
+|     RegexLT_MatchProgStats()
+|     RegexLT_MatchProgGroups()
+|     RegexLT_IsMatch()
 |     RegexLT_Match()
 |     RegexLT_Replace()
 |     RegexLT_ReplaceProg()
@@ -57,7 +63,12 @@
 
 // Private to RegexLT_'.
 #define dbgPrint           regexlt_dbgPrint
+#define simplifyRegex      regexlt_simplifyRegex
+#define simplifyMem        regexlt_simplifyMem
+#define runMemRequired     regexlt_runMemRequired
+#define threadsNeeded      regexlt_threadsNeeded
 #define compileRegex       regexlt_compileRegex
+#define optimizeProgram    regexlt_optimizeProgram
 #define runCompiledRegex   regexlt_runCompiledRegex
 #define printProgram       regexlt_printProgram
 #define getMemMultiple     regexlt_getMemMultiple
@@ -81,8 +92,8 @@ PUBLIC RegexLT_S_MatchList * newMatchList(U8 len)
    RegexLT_S_MatchList *ml;
 
    S_TryMalloc toMalloc[] = {                         // Memory which the compiler needs
-      { (void**)&ms,    (U16)len * sizeof(RegexLT_S_Match)  },
-      { (void**)&ml,    sizeof(RegexLT_S_MatchList)         } };
+      { (void**)&ms,    (U16)len * sizeof(RegexLT_S_Match),  E_RegexMem_MatchLists },
+      { (void**)&ml,    sizeof(RegexLT_S_MatchList),         E_RegexMem_MatchLists } };
 
    if( getMemMultiple(toMalloc, RECORDS_IN(toMalloc)) == FALSE)   // Oops!?
    {
@@ -132,6 +143,7 @@ PUBLIC T_RegexRtn RegexLT_Compile(C8 const *regexStr, void **progV)
       { return E_RegexRtn_BadCfg; }                         // then go no further.
 
    S_RegexStats stats = regexlt_prescan(regexStr);          // Prescan regex; check for gross errors and count resources needed to compile it.
+   C8 *simplified = NULL;
 
    if(stats.legal == FALSE)                                 // Regex was malformed?
       { return E_RegexRtn_BadExpr; }
@@ -143,22 +155,36 @@ PUBLIC T_RegexRtn RegexLT_Compile(C8 const *regexStr, void **progV)
       {
          T_RegexRtn rtn;
 
-         S_TryMalloc programTrunk[] = {{ progV,  sizeof(S_Program) }};
+         /* If the regex can be rewritten simpler then compile the rewrite instead. It's a different
+            string, so prescan again for the resources it needs.
+         */
+         if( (simplified = simplifyRegex(regexStr)) != NULL)
+         {
+            S_RegexStats s2 = regexlt_prescan(simplified);
+
+            if(s2.legal == TRUE)
+               { regexStr = simplified; stats = s2; }
+            else                                            // Rewrite didn't prescan (shouldn't happen)?
+               { safeFree(simplified); simplified = NULL; } // then compile the original.
+         }
+
+         S_TryMalloc programTrunk[] = {{ progV,  sizeof(S_Program), E_RegexMem_Program }};
 
          if( getMemMultiple(programTrunk, RECORDS_IN(programTrunk)) == FALSE)   // Malloc program trunk?
-            { return E_RegexRtn_OutOfMemory; }              // Some malloc() error.
+            { safeFree(simplified); return E_RegexRtn_OutOfMemory; }        // Some malloc() error.
          else
          {
             // Attach leaves to trunk
             S_Program *prog = *progV;
+            prog->simplified = simplified;                  // Program owns the rewritten regex, if there was one.
 
             S_TryMalloc programLeaves[] = {
-               { (void**)&prog->chSegs.buf,    (U16)stats.charboxes    * sizeof(S_CharSegs) },     // Chars-Boxes
-               { (void**)&prog->instrs.buf,   (U16)stats.instructions * sizeof(S_Instr) },         // Instructions (list)
-               { (void**)&prog->classes.ccs,  (U16)stats.classes      * sizeof(S_C8bag) }};        // any Char-classes
+               { (void**)&prog->chSegs.buf,    (U16)stats.charboxes    * sizeof(S_CharSegs), E_RegexMem_CharSegs },    // Chars-Boxes
+               { (void**)&prog->instrs.buf,   (U16)stats.instructions * sizeof(S_Instr),    E_RegexMem_Instrs },        // Instructions (list)
+               { (void**)&prog->classes.ccs,  (U16)stats.classes      * sizeof(S_C8bag),    E_RegexMem_Classes }};      // any Char-classes
 
             if( getMemMultiple(programLeaves, RECORDS_IN(programLeaves)) == FALSE)   // Malloc program leaves?
-               { return E_RegexRtn_OutOfMemory; }           // Some malloc() error.
+               { safeFree(simplified); safeFree(prog); *progV = NULL; return E_RegexRtn_OutOfMemory; }  // Some malloc() error.
             else                                            // otherwise have malloc()ed for program we will now compile.
             {
                /* Fill in the sizes of the as-yet empty 'leaves' we malloced for 'prog'. If we pre-scanned correctly
@@ -175,11 +201,14 @@ PUBLIC T_RegexRtn RegexLT_Compile(C8 const *regexStr, void **progV)
                   ? E_RegexRtn_OK
                   : E_RegexRtn_CompileFailed;
 
+               if(rtn == E_RegexRtn_OK)                     // Compiled?
+                  { optimizeProgram(prog); }                // then tidy it up before it's run.
+
                printProgram(prog);
 
                if(rtn != E_RegexRtn_OK)                     // Compile failed?
                {                                            // then free() 'prog' now; otherwise it's returned to caller.
-                  void *toFree[] = { prog->classes.ccs, prog->instrs.buf, prog->chSegs.buf };
+                  void *toFree[] = { prog->classes.ccs, prog->instrs.buf, prog->chSegs.buf, prog->simplified, prog };
                   safeFreeList(toFree, RECORDS_IN(toFree));
                   *progV = NULL;
                }
@@ -193,15 +222,154 @@ PUBLIC T_RegexRtn RegexLT_Compile(C8 const *regexStr, void **progV)
 
 PUBLIC T_RegexRtn RegexLT_FreeProgram(void *prog)
 {
-   void *toFree[] = { ((S_Program*)prog)->classes.ccs, ((S_Program*)prog)->instrs.buf, ((S_Program*)prog)->chSegs.buf };
+   void *toFree[] = { ((S_Program*)prog)->instrs.masks, ((S_Program*)prog)->instrs.skips, ((S_Program*)prog)->classes.ccs, ((S_Program*)prog)->instrs.buf, ((S_Program*)prog)->chSegs.buf, ((S_Program*)prog)->simplified, prog };
    safeFreeList(toFree, RECORDS_IN(toFree));
    return E_RegexRtn_OK;
 }
 
+/* --------------------------------------- RegexLT_ProgramSize ----------------------------------
+
+   Return the number of instructions in 'prog' as compiled and after it was optimized.
+*/
+PUBLIC RegexLT_S_ProgSize RegexLT_ProgramSize(void const *prog)
+{
+   RegexLT_S_ProgSize sz = {
+      .compiled  = ((S_Program const*)prog)->unoptimized,
+      .optimized = ((S_Program const*)prog)->instrs.put };
+   return sz;
+}
+
+/* --------------------------------------- RegexLT_MemRequired ----------------------------------
+
+   Return the most heap, in bytes, that compiling 'regexStr' and then matching it against up to
+   'maxInputLen' chars, with 'flags', can hold at once. Or 0 if 'regexStr' won't compile or
+   'maxInputLen' is more than RegexLT_Init() allows.
+
+   This is the program as RegexLT_Compile() gets it, from the prescan, plus the most a run can
+   add. It's exact for the program. For the run it's the worst case; both thread lists full,
+   every thread with its own matches. Thread lists are sized by the program; and by the input
+   length too, if its threads can get out of step (see regexlt_threadsNeeded()). It's sized
+   for RegexLT_MatchProg() with a match list; RegexLT_IsMatch() needs less. Blocks are counted
+   as asked for; so not RegexLT_TrackMem()'s tags, nor any overhead of the getMem() supplied.
+
+   The thread lists are sized by the compiler (see regexlt_optimizeProgram()). So this compiles
+   'regexStr', which gets and frees some heap.
+*/
+PRIVATE size_t matchListBytes(U8 len)                    // Same as newMatchList() gets.
+   { return (size_t)len * sizeof(RegexLT_S_Match) + sizeof(RegexLT_S_MatchList); }
+
+PRIVATE size_t programBytes(S_RegexStats const *s)      // Same as 'programTrunk' and 'programLeaves' in RegexLT_Compile().
+{
+   return
+      sizeof(S_Program) +
+      (size_t)s->charboxes    * sizeof(S_CharSegs) +
+      (size_t)s->instructions * sizeof(S_Instr) +
+      (size_t)s->classes      * sizeof(S_C8bag);
+}
+
+PRIVATE size_t engineBytes(S_InstrList const *l)          // Got by regexlt_analyzeProgram(), for the engine it chose.
+   { return (l->masks != NULL ? _ShiftAnd_MaskBytes : 0) + (l->skips != NULL ? _Literal_SkipBytes : 0); }
+
+PUBLIC size_t RegexLT_MemRequired(C8 const *regexStr, U16 maxInputLen, RegexLT_T_Flags flags)
+{
+   if(regexlt_cfg == NULL || maxInputLen > regexlt_cfg->maxStrLen)
+      { return 0; }
+
+   S_RegexStats stats = regexlt_prescan(regexStr);
+
+   if(stats.legal == FALSE)
+      { return 0; }
+   else
+   {
+      S_SimplifyMem sm = simplifyMem(regexStr);
+      size_t kept = 0;                                            // Rewritten regex kept by the program, if any.
+      C8 *simplified;
+
+      if( (simplified = simplifyRegex(regexStr)) != NULL)         // Would RegexLT_Compile() compile a rewrite?
+      {
+         S_RegexStats s2 = regexlt_prescan(simplified);
+         if(s2.legal == TRUE)
+            { stats = s2; kept = sm.kept; }                       // then it's sized from the rewrite, and keeps it.
+         safeFree(simplified);
+      }
+
+      size_t prog = programBytes(&stats) + kept;
+
+      S_Program *compiled;
+      if(RegexLT_Compile(regexStr, (void**)&compiled) != E_RegexRtn_OK)
+         { return 0; }
+      U16 maxThreads = threadsNeeded(&compiled->instrs, maxInputLen);
+      U8 maxMatches = compiled->instrs.groups + 1;                // As RegexLT_MatchProg() gives threads.
+      prog += engineBytes(&compiled->instrs);                     // The optimizer may have got more, for the engine.
+      RegexLT_FreeProgram(compiled);
+
+      size_t run =                                                // A match holds...
+         prog +                                                   // ...the program...
+         matchListBytes(stats.subExprs) +                         // ...the caller's match list...
+         (BSET(flags, _RegexLT_Flags_MatchLongest)
+            ? matchListBytes(maxMatches) : 0) +                   // ...a 2nd for comparing matches (see regexlt_runCompiledRegex())...
+         runMemRequired(maxThreads, maxMatches);                  // ...and the threads.
+
+      size_t compile = sm.working > prog ? sm.working : prog;     // Simplifying and the program aren't held at once (but for 'kept').
+      return run > compile ? run : compile;
+   }
+}
+
+/* --------------------------------------- RegexLT_Analyze ----------------------------------
+
+   Fill 'a' with what's known of 'prog', from RegexLT_Compile(); its size, how it starts and
+   ends, the literals and lengths of its matches, whether it could be run as a DFA and the
+   heap a match needs. Literals in 'a' point into 'prog'; so are valid until it's freed.
+
+   'matchBytes' and 'isMatchBytes' are the worst case, as RegexLT_MemRequired(). With
+   _RegexLT_Flags_MatchLongest a match gets a 2nd match list, of 'groups'+1.
+*/
+PRIVATE RegexLT_S_Literal publicLiteral(S_Literals const *lit)
+   { return (RegexLT_S_Literal){.chars = lit->start, .len = lit->len}; }
+
+PUBLIC void RegexLT_Analyze(void const *prog, RegexLT_S_Analysis *a)
+{
+   S_Program const *p = prog;
+   S_InstrList const *l = &p->instrs;
+   U8 c;
+
+   *a = (RegexLT_S_Analysis){
+      .instrs        = RegexLT_ProgramSize(prog),
+      .classes       = p->classes.put,
+      .groups        = l->groups,
+      .anchoredStart = l->anchoredStart,
+      .anchoredEnd   = l->anchoredEnd,
+      .prefix        = publicLiteral(&l->prefix),
+      .suffix        = publicLiteral(&l->suffix),
+      .numRequired   = l->numRequired,
+      .minLen        = l->minLen,
+      .maxLen        = l->maxLen,
+      .firstChars    = l->firstChars,
+      .firstAny      = l->firstAny,
+      .maxThreads    = threadsNeeded(l, regexlt_cfg->maxStrLen) };     // For the longest input.
+
+   for(c = 0; c < l->numRequired; c++)
+      { a->required[c] = publicLiteral(&l->required[c]); }
+
+   a->dfaStates = regexlt_dfaStates(l, &a->dfaFriendly);
+
+   a->programBytes =                                           // Same as RegexLT_Compile() got...
+      sizeof(S_Program) +
+      (size_t)p->chSegs.size  * sizeof(S_CharSegs) +
+      (size_t)l->size         * sizeof(S_Instr) +
+      (size_t)p->classes.size * sizeof(S_C8bag) +
+      engineBytes(l) +                                         // ...with what the optimizer got for its engine...
+      (p->simplified != NULL ? simplifyMem(p->simplified).kept : 0);    // ...and the rewrite it keeps, if any.
+
+   a->matchBytes   = matchListBytes(p->subExprs) + runMemRequired(a->maxThreads, l->groups + 1);
+   a->isMatchBytes = runMemRequired(a->maxThreads, 0);
+}
+
 /* ----------------------------------------- RegexLT_MatchProg -------------------------------------
 
    Match 'srcStr' against 'prog' which is a program made by RegexLT_Compile().  If 'ml' is not
-   NULL then put any matches in 'ml'.
+   NULL then put any matches in 'ml'. If 'ml' == NULL then the run is capture-free (see
+   RegexLT_IsMatch()).
 
    If 'ml' == NULL AND *ml == NULL then malloc() / create a new match list. If *ml != NULL
    then presumes that 'ml' is an existing match list and, if '*(ml)->listSize' is legal, then
@@ -211,6 +379,19 @@ PUBLIC T_RegexRtn RegexLT_FreeProgram(void *prog)
    to NULL OR it must be to an already made match-list. ******
 */
 PUBLIC T_RegexRtn RegexLT_MatchProg(void *prog, C8 const *srcStr, RegexLT_S_MatchList **ml, RegexLT_T_Flags flags)
+   { return RegexLT_MatchProgGroups(prog, srcStr, ml, flags, _RegexLT_Groups_All); }
+
+/* ----------------------------------------- RegexLT_MatchProgGroups -------------------------------------
+
+   Same as RegexLT_MatchProg(), but record only the capture 'groups' the caller will read; bit
+   'n' for group 'n' (see _RegexLT_Group()). Groups not asked for are run as if they were
+   non-capturing; threads hold no slot for them, and they are empty in 'ml'. The list is still
+   by group number; matches[n] is group 'n'.
+
+   Parentheses often just group alternatives. Then _RegexLT_Groups_None makes the match one
+   pass, with a single slot per thread.
+*/
+PUBLIC T_RegexRtn RegexLT_MatchProgGroups(void *prog, C8 const *srcStr, RegexLT_S_MatchList **ml, RegexLT_T_Flags flags, RegexLT_T_Groups groups)
 {
    S_StrChkRtns strChk = inputOK(srcStr, regexlt_cfg->maxStrLen);    // Check for a legal source string.
 
@@ -220,7 +401,10 @@ PUBLIC T_RegexRtn RegexLT_MatchProg(void *prog, C8 const *srcStr, RegexLT_S_Matc
    {
       #define _prog ((S_Program*)(prog))
                                                                      // Compile 'regexStr'...
-      _prog->instrs.maxRunCnt = strChk.len + 10;                     // Thread run-limit is string size plus for some anchors.
+      _prog->instrs.maxRunCnt =                                      // Thread run-limit is string size plus for some anchors...
+         (_prog->instrs.anchoredStart && _prog->instrs.maxLen < strChk.len
+            ? _prog->instrs.maxLen                                   // ...or, if it's anchored at the start, the longest match.
+            : strChk.len) + 10;
 
       // First, if caller supplies a hook to a match-list use the existing list in 'ml' or make a new new if necessary.
 
@@ -235,13 +419,52 @@ PUBLIC T_RegexRtn RegexLT_MatchProg(void *prog, C8 const *srcStr, RegexLT_S_Matc
 		       return E_RegexRtn_OutOfMemory; }}}                      // Oops! Heap fail.
 
       /* Run the compiled program 'prog.instrs' on 'srcStr' with matches written to 'ml', if this is supplied.
-         Any thread may have up to a global match plus a match for each sub-expression. So reserve 'subExprs'+1.
+         Each thread has a slot for the global match plus one for each of 'groups' (see S_Instr.group).
       */
-      U8  matchesPerThread = _prog->subExprs+2;
-      return runCompiledRegex( &_prog->instrs, srcStr, ml, matchesPerThread, flags);
+      return runCompiledRegex( &_prog->instrs, srcStr, ml, groups, flags);
    }
 }
 
+/* ----------------------------------------- RegexLT_MatchProgStats -------------------------------------
+
+   Same as RegexLT_MatchProg(), but also count, into 'stats', what the match cost; thread-list
+   steps, threads made, merged and dropped, and getMem()s and free()s. So slow patterns can be
+   spotted without the debug prints.
+
+   Counts are from this call only; 'stats' is cleared first. If 'stats' is NULL it's just
+   RegexLT_MatchProg().
+*/
+PUBLIC T_RegexRtn RegexLT_MatchProgStats(void *prog, C8 const *srcStr, RegexLT_S_MatchList **ml, RegexLT_T_Flags flags, RegexLT_S_Stats *stats)
+{
+   if(stats != NULL)
+      { *stats = (RegexLT_S_Stats){0}; }
+
+   regexlt_stats = stats;                                            // Count into here for this call...
+   T_RegexRtn rtn = RegexLT_MatchProg(prog, srcStr, ml, flags);
+   regexlt_stats = NULL;                                             // ...and only this call.
+
+   if(stats != NULL && ml != NULL && *ml != NULL)
+      { stats->matches = (*ml)->put; }
+   return rtn;
+}
+
+/* ----------------------------------------- RegexLT_IsMatch -------------------------------------
+
+   Return E_RegexRtn_Match if 'srcStr' matches 'prog' anywhere, else E_RegexRtn_NoMatch or an
+   error code.
+
+   This is the capture-free path. Threads carry no capture sets, so no slab is malloc()ed for
+   them, and the run quits as soon as any thread reaches 'Match'. Use this when just yes/no is
+   wanted; it's the same as RegexLT_MatchProg() with 'ml' == NULL.
+*/
+PUBLIC T_RegexRtn RegexLT_IsMatch(void *prog, C8 const *srcStr)
+{
+   if(regexlt_cfg == NULL)                                           // User did not supply a cfg with RegexLT_Init().
+      { return E_RegexRtn_BadCfg; }                                  // then go no further.
+   else
+      { return RegexLT_MatchProg(prog, srcStr, NULL, _RegexLT_Flags_None); }
+}
+
 /* -------------------------------- RegexLT_Match --------------------------------------
 
    Match 'srcStr' against 'regexStr', If 'ml' is not NULL then put any matches in 'ml'.
@@ -290,7 +513,7 @@ PRIVATE C8 escCharToASCII(C8 ch)
 
 PRIVATE C8 * appendMatch(C8 *out, RegexLT_S_MatchList const *ml, U8 matchIdx)
 {
-   if(matchIdx < ml->put)
+   if(matchIdx < ml->put && ml->matches[matchIdx].at != NULL)       // That group captured something?
    {
       memcpy(out, ml->matches[matchIdx].at, ml->matches[matchIdx].len);
       out += ml->matches[matchIdx].len;
@@ -368,10 +591,11 @@ PUBLIC T_RegexRtn RegexLT_Replace(C8 const *regexStr, C8 const *inStr, C8 const
       RegexLT_S_MatchList *ml = NULL;                                   // Handle for match list. Must be NULL to signal a new match list to be malloc()ed.
 
       if( (rtn = RegexLT_Match(regexStr, inStr, &ml, _RegexLT_Flags_None)) != E_RegexRtn_Match )      // No match?
-         { return rtn; }                                                // then return 'E_RegexRtn_NoMatch' or some error code.
+         { RegexLT_FreeMatches(ml); return rtn; }                       // then return 'E_RegexRtn_NoMatch' or some error code.
       else                                                              // else matched; so now replace.
       {
          rtn = replace(ml, replaceStr, out);
+         RegexLT_FreeMatches(ml);                                       // Done with the matches.
          return rtn == E_RegexRtn_OK ? E_RegexRtn_Match : rtn;          // Replace succeeded? then return 'E_RegexRtn_Match' else some error code.
       }}
 }
@@ -385,13 +609,14 @@ PUBLIC T_RegexRtn RegexLT_ReplaceProg(void *prog, C8 const *inStr, C8 const *rep
    if(regexlt_cfg == NULL)                                              // User did not supply a cfg with RegexLT_Init().
       { return E_RegexRtn_BadCfg; }                                     // then go no further.
    else {
-      T_RegexRtn rtn;   RegexLT_S_MatchList *ml;                        // Handle for match list. Must be NULL to signal a new match list to be malloc()ed.
+      T_RegexRtn rtn;   RegexLT_S_MatchList *ml = NULL;                 // Handle for match list. Must be NULL to signal a new match list to be malloc()ed.
 
       if( (rtn = RegexLT_MatchProg(prog, inStr, &ml, _RegexLT_Flags_None)) != E_RegexRtn_Match )      // No match?
-         { return rtn; }                                                // then return 'E_RegexRtn_NoMatch' or some error code.
+         { RegexLT_FreeMatches(ml); return rtn; }                       // then return 'E_RegexRtn_NoMatch' or some error code.
       else                                                              // else matched; so now replace.
       {
          rtn = replace(ml, replaceStr, out);
+         RegexLT_FreeMatches(ml);                                       // Done with the matches.
          return rtn == E_RegexRtn_OK ? E_RegexRtn_Match : rtn;          // Replace succeeded? then return 'E_RegexRtn_Match' else some error code.
       }}
 }
@@ -0,0 +1,136 @@
+/* ------------------------------------------------------------------------------
+|
+| Non-backtracking Lite Regex - Public exports in addition to those in 'util.h'.
+|
+--------------------------------------------------------------------------------*/
+
+#ifndef REGEXLT_H
+#define REGEXLT_H
+
+#include "util.h"
+
+/* Leftmost-first, as Perl; of the matches which start first, the one the regex prefers e.g 'a|ab'
+   on "ab" is 'a'. Threads are run in order of preference and those behind a match are dropped.
+   (The other _RegexLT_Flags_ are in 'util.h'.)
+*/
+#define _RegexLT_Flags_MatchFirst 0x04
+
+/* _RegexLT_Flags_MatchLast gives the match which starts last; the search runs from the end of
+   the input back. So it may overlap an earlier match e.g '[0-9]{4}' on "98372" is '8372'. Before,
+   it was the last of the matches a forward search, resuming after each one, found; '9837'.
+*/
+
+// Instructions in a compiled program; as compiled and after optimizing. See RegexLT_ProgramSize().
+typedef struct { U16 compiled, optimized; } RegexLT_S_ProgSize;
+
+PUBLIC RegexLT_S_ProgSize RegexLT_ProgramSize(void const *prog);
+
+/* What RegexLT_Analyze() finds in a compiled program; to choose how to run it, and to vet a
+   pattern before it goes to a target e.g that a match fits the heap there.
+*/
+typedef struct { C8 const *chars; U16 len; } RegexLT_S_Literal;      // 'len' chars at 'chars' (not '\0'-terminated), held by the program.
+
+#define _RegexLT_MaxRequired              4     // Most literals RegexLT_S_Analysis.required[] holds.
+#define _RegexLT_DFAFriendly_MaxStates    256   // More estimated DFA states than this isn't 'dfaFriendly'.
+
+typedef struct {
+   RegexLT_S_ProgSize   instrs;              // Instructions, as compiled and optimized.
+   U8                   classes,             // Char classes.
+                        groups;              // Capture groups.
+   BOOL                 anchoredStart,       // Every match starts with '^'...
+                        anchoredEnd;         // ...ends with '$'.
+   RegexLT_S_Literal    prefix,              // Literals every match starts with...
+                        suffix,              // ...and ends with; 'len' 0 if none.
+                        required[_RegexLT_MaxRequired];     // Literals every match holds...
+   U8                   numRequired;                        // ...this many.
+   U16                  minLen, maxLen;      // Fewest and most chars in a match; 'maxLen' is MAX_U16 if there's no most.
+   S_C8bag              firstChars;          // Chars a match may start with...
+   BOOL                 firstAny;            // ...unless TRUE; then it may start with any, or match nothing.
+   BOOL                 dfaFriendly;         // Could run as a DFA of about...
+   U16                  dfaStates;           // ...this many states.
+   U16                  maxThreads;          // Most threads in a thread list, for the longest input.
+   size_t               programBytes,        // Heap the program holds.
+                        matchBytes,          // Most heap RegexLT_MatchProg() adds, with a new match list...
+                        isMatchBytes;        // ...and RegexLT_IsMatch().
+} RegexLT_S_Analysis;
+
+PUBLIC void RegexLT_Analyze(void const *prog, RegexLT_S_Analysis *a);
+
+// Does 'srcStr' match 'prog' (from RegexLT_Compile())? Capture-free; returns E_RegexRtn_Match, E_RegexRtn_NoMatch or an error.
+PUBLIC T_RegexRtn RegexLT_IsMatch(void *prog, C8 const *srcStr);
+
+// Most heap compiling and running 'regex' can hold at once; 0 if it won't compile. See RegexLT_MemRequired().
+PUBLIC size_t RegexLT_MemRequired(C8 const *regex, U16 maxInputLen, RegexLT_T_Flags flags);
+
+/* Counts from one match; see RegexLT_MatchProgStats(). A match may run the program more than
+   once (see regexlt_runCompiledRegex()); these are the totals over all runs.
+*/
+typedef struct {
+   U32   cycles,              // Steps of the thread list; about one per input char, per run.
+         threads,             // Threads added to the thread lists.
+         peakThreads,         // Most threads in one list at once.
+         merges,              // Duplicate threads folded into others.
+         overflows,           // Threads dropped because their list was full; the match then fails 'RanTooLong'.
+         copies,              // Capture sets copied because a thread wrote to one it shared.
+         pruned,              // Threads cut off early; by a possessive repeat or, for _RegexLT_Flags_MatchFirst, by a match ahead of them.
+         getMems, frees;      // Calls to the getMem() and free() from RegexLT_Init()...
+   size_t getMemBytes;        // ...and the bytes got. (free() isn't told how many it frees).
+   U8    matches;             // Matches put in the match list.
+} RegexLT_S_Stats;
+
+// Same as RegexLT_MatchProg() but also fills 'stats'.
+PUBLIC T_RegexRtn RegexLT_MatchProgStats(void *prog, C8 const *srcStr, RegexLT_S_MatchList **ml, RegexLT_T_Flags flags, RegexLT_S_Stats *stats);
+
+/* Which capture groups to record; bit 'n' for group 'n', 1..31. See RegexLT_MatchProgGroups().
+   Groups past 31 are recorded only with _RegexLT_Groups_All.
+*/
+typedef U32 RegexLT_T_Groups;
+
+#define _RegexLT_MaskGroups   31
+#define _RegexLT_Group(n)     ((RegexLT_T_Groups)1 << (n))
+#define _RegexLT_Groups_None  0
+#define _RegexLT_Groups_All   0xFFFFFFFFUL
+
+// Same as RegexLT_MatchProg() but records only the capture 'groups'; others are left empty.
+PUBLIC T_RegexRtn RegexLT_MatchProgGroups(void *prog, C8 const *srcStr, RegexLT_S_MatchList **ml, RegexLT_T_Flags flags, RegexLT_T_Groups groups);
+
+/* Heap use, by what it's for; see RegexLT_TrackMem(). For sizing a static pool for a pattern
+   from real runs.
+*/
+typedef enum {
+   E_RegexMem_Other = 0,
+   E_RegexMem_Program,        // The program trunk, S_Program.
+   E_RegexMem_Instrs,         // Compiled instructions.
+   E_RegexMem_CharSegs,       // Chars, escapes and classes in the Char-Boxes.
+   E_RegexMem_Classes,        // Char classes.
+   E_RegexMem_Simplify,       // The parse tree and rewritten regex, from regexlt_simplifyRegex().
+   E_RegexMem_ThreadLists,    // The thread lists in runOnce().
+   E_RegexMem_ThreadMatches,  // The capture sets which runOnce()'s threads share.
+   E_RegexMem_MatchLists,     // Match lists returned to the caller.
+   _RegexMem_NumPurposes
+} RegexLT_T_MemFor;
+
+typedef struct {
+   size_t   live, peak;       // Bytes held now, and the most held at once.
+   U32      getMems, frees;
+} RegexLT_S_MemCnts;
+
+typedef struct {
+   RegexLT_S_MemCnts all,                          // Everything, and...
+                     by[_RegexMem_NumPurposes];    // ...broken down by purpose.
+} RegexLT_S_MemUse;
+
+// Account heap use into 'use' (NULL to stop). Only when RegexLT_ holds no memory; FALSE if not.
+PUBLIC BOOL RegexLT_TrackMem(RegexLT_S_MemUse *use);
+
+// A static pool, to use instead of the heap; see regexlt_pool.c.
+PUBLIC BOOL    RegexLT_PoolInit(void *buf, size_t size);
+PUBLIC void *  RegexLT_PoolGetMem(size_t numBytes);      // For RegexLT_S_Cfg.getMem...
+PUBLIC void    RegexLT_PoolFree(void *p);                 // ...and .free.
+PUBLIC void    RegexLT_PoolMark(void);                    // After compiling...
+PUBLIC void    RegexLT_PoolReset(void);                   // ...then back to the mark after each match.
+PUBLIC size_t  RegexLT_PoolHighWater(void);
+
+#endif // REGEXLT_H
+
+// ----------------------------------------- eof --------------------------------------------
@@ -0,0 +1,652 @@
+/* ------------------------------------------------------------------------------
+|
+| Non-backtracking Lite Regex - Analyze a compiled program.
+|
+| regexlt_optimizeProgram() leaves a program which runs as before, with fewer steps. The
+| passes here don't change it; they work out what any match of it must look like, so the
+| run-time can pass over input which can't hold one.
+|
+|     - Required literals: literals any match must hold, to look for before running.
+|     - Match lengths:     the fewest and most chars a match can have.
+|     - Prefix, suffix:    literals every match starts and ends with.
+|     - First chars:       the chars a match can start with.
+|     - Engine:            the thread VM; or shift-and for a short fixed run of chars, or
+|                          a substring search for a plain string.
+|
+| And, for RegexLT_Analyze(), about how many states a DFA for the program would have.
+|
+|  Public:
+|     regexlt_analyzeProgram()
+|     regexlt_boxChars()
+|     regexlt_dfaStates()
+|
+--------------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include "libs_support.h"
+#include "util.h"
+#include "regexlt_private.h"
+
+/* ---------------------------------- reachesMatch -----------------------------------
+
+   Return TRUE if there's a path from 'l->buf[i]' to 'Match' which doesn't pass 'skip'. This
+   goes by the program's jumps alone; so it may find a path which the repeat counts wouldn't
+   let a thread take, but never misses one. 'seen' marks the instructions tried already.
+*/
+PRIVATE BOOL reachesMatch(S_InstrList const *l, T_InstrIdx i, T_InstrIdx skip, U8 *seen)
+{
+   if(i >= l->put || i == skip || (seen[i/8] & (1 << (i%8))) != 0)
+      { return FALSE; }
+   seen[i/8] |= 1 << (i%8);
+
+   S_Instr const *ins = &l->buf[i];
+   switch(ins->opcode)
+   {
+      case OpCode_Match:   return TRUE;
+      case OpCode_Jmp:
+      case OpCode_Span:    return reachesMatch(l, ins->left, skip, seen);
+      case OpCode_Split:   return reachesMatch(l, ins->left, skip, seen) || reachesMatch(l, ins->right, skip, seen);
+      default:             return reachesMatch(l, i+1, skip, seen);    // NOP, CharBox.
+   }
+}
+
+/* ---------------------------------- hasAnchor -----------------------------------
+
+   Return TRUE if any 'Char-Box' in 'l' holds the anchor or control 'ch'.
+*/
+PRIVATE BOOL hasAnchor(S_InstrList const *l, C8 ch)
+{
+   T_InstrIdx i;
+   U16 j;
+
+   for(i = 0; i < l->put; i++) {
+      S_CharsBox const *cb = &l->buf[i].charBox;
+      if(l->buf[i].opcode == OpCode_CharBox) {
+         for(j = 0; j < cb->put; j++) {
+            if(cb->segs[j].opcode == OpCode_Anchor && cb->segs[j].payload.anchor.ch == ch) {
+               return TRUE; }}}}
+   return FALSE;
+}
+
+// A program with '(?i)' may ignore case; so its literals are not the chars it matches.
+PRIVATE BOOL mayIgnoreCase(S_InstrList const *l)
+   { return hasAnchor(l, 'i'); }
+
+/* ---------------------------------- addRequired -----------------------------------
+
+   Add the 'len' literals at 'start' to 'l->required'. If that's full, they replace the
+   shortest held, if they are longer; a longer literal is less likely to be in the input.
+*/
+PRIVATE void addRequired(S_InstrList *l, C8 const *start, T_CharSegmentLen len)
+{
+   U8 c, shortest = 0;
+
+   if(len == 0)
+      { return; }
+
+   if(l->numRequired < _MaxRequired)
+      { l->required[l->numRequired++] = (S_Literals){.start = start, .len = len}; }
+   else
+   {
+      for(c = 1; c < _MaxRequired; c++) {
+         if(l->required[c].len < l->required[shortest].len) {
+            shortest = c; }}
+
+      if(len > l->required[shortest].len)
+         { l->required[shortest] = (S_Literals){.start = start, .len = len}; }
+   }
+}
+
+/* ---------------------------------- requiredLiterals -----------------------------------
+
+   Fill 'l->required' with literals every match must hold e.g the '@' in '\w+@\w+' or the ','
+   in '\d+,\d+'. The run-time looks for these in the input before it makes any threads.
+
+   A 'Char-Box' which can't be passed by, i.e without which there's no path to 'Match', is
+   in every match. Its literals are its escaped chars and the runs in its 'Chars' segments
+   between any '.'. A program which may ignore case, from '(?i)', gets none; nor does one
+   whose '|' the jumps don't model (see S_InstrList).
+*/
+PRIVATE void requiredLiterals(S_InstrList *l)
+{
+   T_InstrIdx i;
+   U16 j, k;
+
+   l->numRequired = 0;
+
+   if(mayIgnoreCase(l) || l->alternates)                             // Any '(?i)'? or a '|' with repeats? then none.
+      { return; }
+
+   for(i = 0; i < l->put; i++)
+   {
+      S_Instr const *ins = &l->buf[i];
+      U8 seen[(MAX_U8+1)/8] = {0};
+
+      if(ins->opcode != OpCode_CharBox ||
+         (ins->repeats.cntsValid && ins->repeats.min == 0) ||       // May be had zero times? or...
+         reachesMatch(l, 0, i, seen) == TRUE)                       // ...a match can go round it?
+         { continue; }                                              // then it's not required.
+
+      for(j = 0; j < ins->charBox.put; j++)
+      {
+         S_CharSegs const *seg = &ins->charBox.segs[j];
+
+         if(seg->opcode == OpCode_EscCh)
+            { addRequired(l, &seg->payload.esc.ch, 1); }
+         else if(seg->opcode == OpCode_Chars)
+         {
+            S_Literals const *lit = &seg->payload.literals;
+            for(k = 0; k <= lit->len; k++) {                         // Each run up to a '.', which matches anything.
+               U16 from = k;
+               while(k < lit->len && lit->start[k] != '.')
+                  { k++; }
+               addRequired(l, &lit->start[from], k - from); }
+         }
+      }
+   }
+}
+
+/* ---------------------------------- regexlt_boxChars -----------------------------------
+
+   The number of chars 'cb' reads; each char, escape and class is one, an anchor none.
+*/
+PUBLIC U16 regexlt_boxChars(S_CharsBox const *cb)
+{
+   U16 j, n = 0;
+
+   for(j = 0; j < cb->put && cb->segs[j].opcode != OpCode_Match; j++)
+   {
+      switch(cb->segs[j].opcode)
+      {
+         case OpCode_Chars:   n += cb->segs[j].payload.literals.len;  break;
+         case OpCode_EscCh:
+         case OpCode_Class:   n++;                                    break;
+         default:                                                     break;   // Anchor.
+      }
+   }
+   return n;
+}
+
+/* ---------------------------------- pathChars -----------------------------------
+
+   The fewest, or if 'longest' the most, chars read on a path from 'l->buf[from]' to 'to'; or
+   to any 'Match' if 'to' is past the program. '_NoPath' if there's none. If 'longest' and
+   a path can loop round reading chars then there's no most; that's '_MatchLen_Unbounded'.
+
+   Paths go by the program's jumps. For the fewest, a counted 'Split' is left only after
+   going round its loop 'min' times; so e.g '(ab){2,3}' reads at least 4. Loops inside that
+   are followed to a 'depth' of _LoopDepth; past that their 'min' is taken as 0.
+*/
+#define _NoPath     MAX_U32
+#define _LoopDepth  3
+
+PRIVATE U32 pathChars(S_InstrList const *l, T_InstrIdx from, U16 to, BOOL longest, U8 depth)
+{
+   U32 chars[MAX_U8+1];
+   T_InstrIdx i;
+   U16 pass;
+   BOOL changed;
+   U32 best = _NoPath;
+
+   for(i = 0; i < l->put; i++)
+      { chars[i] = _NoPath; }
+   chars[from] = 0;
+
+   for(pass = 0, changed = TRUE; changed; pass++)              // Until no path gets fewer (or more) chars.
+   {
+      if(pass > l->put)                                        // Still more after a pass for each instruction?
+         { return _MatchLen_Unbounded; }                       // then a path goes round reading chars; there's no most.
+
+      changed = FALSE;
+      for(i = 0; i < l->put; i++)
+      {
+         S_Instr const *ins = &l->buf[i];
+         T_InstrIdx next[2];
+         U32 reads[2] = {0, 0};
+         U8 n = 0, c;
+
+         if(chars[i] == _NoPath || i == to)                    // Not reached yet? or reached 'to'?
+            { continue; }                                      // then nothing follows from here.
+
+         switch(ins->opcode)
+         {
+            case OpCode_NOP:     next[n++] = i+1;                                                   break;
+            case OpCode_CharBox: reads[n] = regexlt_boxChars(&ins->charBox);  next[n++] = i+1;             break;
+            case OpCode_Jmp:     next[n++] = ins->left;                                             break;
+            case OpCode_Span:
+               if(longest && ins->repeats.max == _Repeats_Unlimited)
+                  { return _MatchLen_Unbounded; }
+               reads[n] = (U32)regexlt_boxChars(&ins->charBox) * (longest ? ins->repeats.max : ins->repeats.min);
+               next[n++] = ins->left;
+               break;
+            case OpCode_Split:
+               next[n++] = ins->left;
+               if(!longest && ins->repeats.cntsValid && ins->repeats.min > 0 && depth < _LoopDepth)   // A counted loop, which must go round 'min' times?
+               {
+                  U32 loop = pathChars(l, ins->left, i, FALSE, depth+1);
+                  reads[n] = loop == _NoPath ? 0 : (loop > MAX_U16 ? MAX_U16+1 : loop * ins->repeats.min);
+               }
+               next[n++] = ins->right;
+               break;
+            default:             break;                                                             // Match.
+         }
+
+         for(c = 0; c < n; c++)
+         {
+            U32 got = chars[i] + reads[c];
+            if(got > MAX_U16+1)                                // Too many to count? (it's then too long for any input)
+               { got = MAX_U16+1; }
+            if(next[c] < l->put &&
+               (chars[next[c]] == _NoPath || (longest ? got > chars[next[c]] : got < chars[next[c]])))
+               { chars[next[c]] = got; changed = TRUE; }
+         }
+      }
+   }
+
+   for(i = 0; i < l->put; i++) {
+      if(chars[i] != _NoPath && (to < l->put ? i == to : l->buf[i].opcode == OpCode_Match) &&
+         (best == _NoPath || (longest ? chars[i] > best : chars[i] < best))) {
+         best = chars[i]; }}
+   return best;
+}
+
+/* ---------------------------------- matchLengths -----------------------------------
+
+   Set 'l->minLen' and 'l->maxLen', the fewest and most chars a match can have. The run-time
+   passes over input which is too short for 'minLen'. With a '|' and repeats these are 0 and
+   unbounded; pathChars() can't follow it's 'Split's (see S_InstrList).
+*/
+PRIVATE void matchLengths(S_InstrList *l)
+{
+   U32 n;
+
+   if(l->alternates)
+   {
+      l->minLen = 0;
+      l->maxLen = _MatchLen_Unbounded;
+      return;
+   }
+
+   l->minLen = (n = pathChars(l, 0, MAX_U8+1, FALSE, 0)) == _NoPath || n > MAX_U16 ? 0 : n;
+   l->maxLen = (n = pathChars(l, 0, MAX_U8+1, TRUE, 0)) == _NoPath || n > MAX_U16 ? _MatchLen_Unbounded : n;
+}
+
+/* ---------------------------------- edgeLiterals -----------------------------------
+
+   The literals 'cb' starts with, or if 'fromEnd' ends with; past any anchors and up to any
+   '.'. 'len' 0 if it starts (or ends) with a class. '*endAnchor' <- TRUE if, from the end,
+   a '$' is passed.
+*/
+PRIVATE S_Literals edgeLiterals(S_CharsBox const *cb, BOOL fromEnd, BOOL *endAnchor)
+{
+   U16 n, j;
+   S_Literals none = {.start = NULL, .len = 0};
+
+   for(n = 0; n < cb->put && cb->segs[n].opcode != OpCode_Match; n++) {}     // 'n' segs, before the terminator.
+
+   for(j = 0; j < n; j++)
+   {
+      S_CharSegs const *seg = &cb->segs[fromEnd ? n-1-j : j];
+
+      switch(seg->opcode)
+      {
+         case OpCode_Anchor:                                   // Reads nothing; so look past it.
+            if(seg->payload.anchor.ch == '$')
+               { *endAnchor = TRUE; }
+            continue;
+
+         case OpCode_EscCh:
+            return (S_Literals){.start = &seg->payload.esc.ch, .len = 1};
+
+         case OpCode_Chars:
+         {
+            S_Literals const *lit = &seg->payload.literals;
+            T_CharSegmentLen k;
+
+            for(k = 0; k < lit->len && lit->start[fromEnd ? lit->len-1-k : k] != '.'; k++) {}  // Up to a '.', which matches anything.
+            return (S_Literals){.start = fromEnd ? lit->start + lit->len - k : lit->start, .len = k};
+         }
+
+         default:                                              // Class.
+            return none;
+      }
+   }
+   return none;
+}
+
+/* ---------------------------------- literalAffixes -----------------------------------
+
+   Set 'l->prefix' and 'l->suffix', the literals every match starts and ends with, 'len' 0
+   if none; and 'l->anchoredEnd' if every match ends with '$'.
+
+   A 'Char-Box' at 'l->buf[0]' is read first on every path; its leading literals are the
+   prefix. A 'Char-Box' just before the only 'Match', when nothing jumps to that 'Match' (and
+   there's no '|' with repeats; see S_InstrList), is read last; its trailing literals are the suffix.
+*/
+PRIVATE void literalAffixes(S_InstrList *l)
+{
+   T_InstrIdx i, end = l->put-1;
+   BOOL lastBox, endAnchor = FALSE;
+
+   l->prefix = l->suffix = (S_Literals){.start = NULL, .len = 0};
+   l->anchoredEnd = FALSE;
+
+   if(l->put < 2 || mayIgnoreCase(l))
+      { return; }
+
+   if(l->buf[0].opcode == OpCode_CharBox)
+      { l->prefix = edgeLiterals(&l->buf[0].charBox, FALSE, &endAnchor); }
+
+   lastBox = l->buf[end].opcode == OpCode_Match && l->buf[end-1].opcode == OpCode_CharBox &&
+             !l->alternates;                                         // (An alternative may end some other way.)
+
+   for(i = 0; i < end && lastBox; i++)                               // Is 'end' the only 'Match', and reached only from 'end'-1?
+   {
+      S_Instr const *ins = &l->buf[i];
+      if(ins->opcode == OpCode_Match ||
+         ((ins->opcode == OpCode_Jmp || ins->opcode == OpCode_Span) && ins->left == end) ||
+         (ins->opcode == OpCode_Split && (ins->left == end || ins->right == end)))
+         { lastBox = FALSE; }
+   }
+
+   if(lastBox)
+   {
+      endAnchor = FALSE;
+      l->suffix = edgeLiterals(&l->buf[end-1].charBox, TRUE, &endAnchor);
+      l->anchoredEnd = endAnchor;
+   }
+}
+
+/* ---------------------------------- firstChars -----------------------------------
+
+   Add to 'fc' the chars which a path from 'l->buf[i]' can read first. Return FALSE if that
+   may be any char, i.e a '.' or a char past 0x7F, or none, i.e the path reaches 'Match'
+   without reading; then 'fc' says nothing. 'seen' marks the instructions tried already.
+*/
+#define _FirstCharsTop 0x7F
+
+PRIVATE BOOL segFirstChars(S_CharSegs const *seg, S_C8bag *fc)
+{
+   U16 ch;
+
+   switch(seg->opcode)
+   {
+      case OpCode_Chars:   ch = (U8)seg->payload.literals.start[0];  break;
+      case OpCode_EscCh:   ch = (U8)seg->payload.esc.ch;             break;
+      case OpCode_Class:
+         for(ch = 1; ch <= MAX_U8; ch++) {
+            if(C8bag_Contains(seg->payload.charClass, ch) == TRUE) {
+               if(ch > _FirstCharsTop) {
+                  return FALSE; }
+               C8bag_AddOne(fc, ch); }}
+         return TRUE;
+      default:             return FALSE;
+   }
+
+   if(ch == '.' && seg->opcode == OpCode_Chars)                      // '.' is any char.
+      { return FALSE; }
+   if(ch > _FirstCharsTop)
+      { return FALSE; }
+   C8bag_AddOne(fc, ch);
+   return TRUE;
+}
+
+PRIVATE BOOL firstChars(S_InstrList const *l, T_InstrIdx i, S_C8bag *fc, U8 *seen)
+{
+   if(i >= l->put || (seen[i/8] & (1 << (i%8))) != 0)
+      { return TRUE; }
+   seen[i/8] |= 1 << (i%8);
+
+   S_Instr const *ins = &l->buf[i];
+   U16 j;
+
+   switch(ins->opcode)
+   {
+      case OpCode_NOP:     return firstChars(l, i+1, fc, seen);
+      case OpCode_Jmp:     return firstChars(l, ins->left, fc, seen);
+      case OpCode_Split:   return firstChars(l, ins->left, fc, seen) && firstChars(l, ins->right, fc, seen);
+
+      case OpCode_Span:
+         return
+            segFirstChars(&ins->charBox.segs[0], fc) &&
+            (ins->repeats.min > 0 || firstChars(l, ins->left, fc, seen));      // May be had zero times? then what follows too.
+
+      case OpCode_CharBox:
+         for(j = 0; j < ins->charBox.put && ins->charBox.segs[j].opcode != OpCode_Match; j++) {
+            if(ins->charBox.segs[j].opcode != OpCode_Anchor) {                 // Anchors read nothing.
+               return segFirstChars(&ins->charBox.segs[j], fc); }}
+         return firstChars(l, i+1, fc, seen);                                  // All anchors; so the next reads first.
+
+      default:             return FALSE;                                       // Match.
+   }
+}
+
+PRIVATE void startChars(S_InstrList *l)
+{
+   U8 seen[(MAX_U8+1)/8] = {0};
+
+   memset(&l->firstChars, 0, sizeof(S_C8bag));
+   l->firstAny = l->put == 0 || mayIgnoreCase(l) || firstChars(l, 0, &l->firstChars, seen) == FALSE;
+}
+
+/* ------------------------------- regexlt_dfaStates ----------------------------------
+
+   About how many states a DFA made from 'l' would have; for RegexLT_Analyze(). That's one
+   for each char a match can read, with counted repeats unrolled e.g 'a{2,5}' is 5, plus one
+   to start; as for a DFA made from the positions in the regex. A DFA for a search may need
+   more, up to 2 to the power of that, but rarely does. At most MAX_U16.
+
+   '*friendly' <- FALSE if 'l' holds what a DFA can't do, a possessive repeat, '\b' or '\B';
+   or if it needs more than _RegexLT_DFAFriendly_MaxStates.
+*/
+PRIVATE U32 loopTimes(S_RepeatSpec const *r)
+{
+   return !r->cntsValid || r->max == 0
+      ? 1
+      : (r->max == _Repeats_Unlimited ? (U32)r->min + 1 : r->max);   // e.g 'a{2,}' is 'aaa*'.
+}
+
+PUBLIC U16 regexlt_dfaStates(S_InstrList const *l, BOOL *friendly)
+{
+   U32 n = 1, reads;
+   T_InstrIdx i, j;
+
+   *friendly = !hasAnchor(l, 'b') && !hasAnchor(l, 'B');
+
+   for(i = 0; i < l->put && n <= MAX_U16; i++)
+   {
+      S_Instr const *ins = &l->buf[i];
+
+      if(ins->repeats.possessive)
+         { *friendly = FALSE; }
+
+      if(ins->opcode == OpCode_CharBox)
+         { reads = regexlt_boxChars(&ins->charBox); }
+      else if(ins->opcode == OpCode_Span)
+         { reads = regexlt_boxChars(&ins->charBox) * loopTimes(&ins->repeats); }
+      else
+         { continue; }
+
+      for(j = i; j < l->put && reads <= MAX_U16; j++)                // Times round each loop it's in.
+      {
+         S_Instr const *lp = &l->buf[j];
+
+         if(lp->opcode == OpCode_Jmp && lp->left <= i)                // Loop back from a 'Jmp'; the 'Split' it goes to counts.
+            { reads *= loopTimes(&l->buf[lp->left].repeats); }
+         else if(lp->opcode == OpCode_Split && lp->left <= i && lp->left < j)  // Loop back from the 'Split' itself.
+            { reads *= loopTimes(&lp->repeats); }
+      }
+      n += reads;
+   }
+
+   if(n > MAX_U16)
+      { n = MAX_U16; }
+   if(n > _RegexLT_DFAFriendly_MaxStates)
+      { *friendly = FALSE; }
+   return n;
+}
+
+/* ---------------------------------- chooseEngine -----------------------------------
+
+   Pick how regexlt_runCompiledRegex() runs 'l', into 'l->engine'. The thread VM runs anything.
+   But a program which is just a run of chars, escapes and classes, of fixed length no more
+   than _ShiftAnd_MaxLen and without anchors, can be run bit-parallel by shift-and; a bit for
+   each char of a match, one step for each char of input and no threads. Its masks, a U32
+   for each char, are got here along with the program. If they can't be, it's left on the VM.
+
+   A plain string, one 'Chars' segment without a '.', is better still; a substring search
+   (Horspool) which, on a mismatch, skips ahead by as much as the string's length. Its
+   skips, one for each char, are got likewise.
+*/
+PRIVATE BOOL shiftAndSeg(S_CharSegs const *seg)
+{
+   U16 ch;
+   T_CharSegmentLen k;
+
+   switch(seg->opcode)
+   {
+      case OpCode_Chars:
+         for(k = 0; k < seg->payload.literals.len; k++) {
+            if((U8)seg->payload.literals.start[k] >= _ShiftAnd_Chars) {
+               return FALSE; }}
+         return TRUE;
+
+      case OpCode_EscCh:
+         return (U8)seg->payload.esc.ch < _ShiftAnd_Chars;
+
+      case OpCode_Class:
+         for(ch = _ShiftAnd_Chars; ch <= MAX_U8; ch++) {
+            if(C8bag_Contains(seg->payload.charClass, ch) == TRUE) {
+               return FALSE; }}
+         return TRUE;
+
+      default:                                                       // Anchor.
+         return FALSE;
+   }
+}
+
+PRIVATE BOOL shiftAndFits(S_InstrList const *l)
+{
+   T_InstrIdx i;
+   U16 j;
+
+   if(l->put < 2 || l->buf[l->put-1].opcode != OpCode_Match ||
+      l->minLen == 0 || l->minLen != l->maxLen || l->maxLen > _ShiftAnd_MaxLen)
+      { return FALSE; }
+
+   for(i = 0; i < l->put-1; i++)
+   {
+      S_Instr const *ins = &l->buf[i];
+
+      if(ins->opcode != OpCode_CharBox && ins->opcode != OpCode_Span)   // Any 'Split', 'Jmp'?
+         { return FALSE; }                                             // then it's not a straight run.
+
+      for(j = 0; j < ins->charBox.put && ins->charBox.segs[j].opcode != OpCode_Match; j++) {
+         if(shiftAndSeg(&ins->charBox.segs[j]) == FALSE) {
+            return FALSE; }}
+   }
+   return TRUE;
+}
+
+// Set bit 'pos' in the masks of the chars matching 'ch', a char from a 'Chars' segment.
+PRIVATE void shiftAndChar(U32 *masks, C8 ch, U32 bit)
+{
+   U16 c;
+
+   if(ch == '.')                                                     // Any char, even those past the table.
+      { for(c = 0; c <= _ShiftAnd_Chars; c++) { masks[c] |= bit; } }
+   else
+      { masks[(U8)ch] |= bit; }
+}
+
+// A plain string? Then it's all prefix; see literalAffixes().
+PRIVATE BOOL isLiteral(S_InstrList const *l)
+{
+   return
+      l->put == 2 && l->buf[0].opcode == OpCode_CharBox && l->buf[1].opcode == OpCode_Match &&
+      l->buf[0].charBox.segs[0].opcode == OpCode_Chars &&
+      l->buf[0].charBox.segs[1].opcode == OpCode_Match &&            // One 'Chars' segment...
+      l->prefix.len > 0 && l->prefix.len == l->minLen;               // ...with no '.' in it.
+}
+
+PRIVATE void chooseEngine(S_InstrList *l)
+{
+   T_InstrIdx i;
+   U16 j, c, pos = 0;
+   T_RepeatCnt r;
+   T_CharSegmentLen k;
+
+   l->engine = E_Engine_NFA;
+   l->masks = NULL;
+   l->skips = NULL;
+
+   if(isLiteral(l) &&
+      (l->skips = regexlt_getMem(_Literal_SkipBytes, E_RegexMem_Program)) != NULL)
+   {
+      memset(l->skips, l->prefix.len, _Literal_SkipBytes);           // A char not in the string skips all of it...
+      for(k = 0; k < l->prefix.len-1; k++)                           // ...one in it, to line up its last place, bar the end.
+         { l->skips[(U8)l->prefix.start[k]] = l->prefix.len-1-k; }
+      l->engine = E_Engine_Literal;
+      return;
+   }
+
+   if(shiftAndFits(l) == FALSE ||
+      (l->masks = regexlt_getMem(_ShiftAnd_MaskBytes, E_RegexMem_Program)) == NULL)
+      { return; }
+
+   memset(l->masks, 0, _ShiftAnd_MaskBytes);
+
+   for(i = 0; i < l->put-1; i++)
+   {
+      S_Instr const *ins = &l->buf[i];
+
+      for(r = 0; r < (ins->opcode == OpCode_Span ? ins->repeats.min : 1); r++)      // A 'Span' is its char 'min' (= 'max') times.
+      {
+         for(j = 0; j < ins->charBox.put && ins->charBox.segs[j].opcode != OpCode_Match; j++)
+         {
+            S_CharSegs const *seg = &ins->charBox.segs[j];
+
+            switch(seg->opcode)
+            {
+               case OpCode_Chars:
+                  for(k = 0; k < seg->payload.literals.len; k++)
+                     { shiftAndChar(l->masks, seg->payload.literals.start[k], 1UL << pos++); }
+                  break;
+
+               case OpCode_EscCh:
+                  l->masks[(U8)seg->payload.esc.ch] |= 1UL << pos++;
+                  break;
+
+               default:                                              // Class.
+                  for(c = 0; c < _ShiftAnd_Chars; c++) {
+                     if(C8bag_Contains(seg->payload.charClass, c) == TRUE) {
+                        l->masks[c] |= 1UL << pos; }}
+                  pos++;
+                  break;
+            }
+         }
+      }
+   }
+   l->engine = E_Engine_ShiftAnd;
+}
+
+/* ------------------------------- regexlt_analyzeProgram ----------------------------------
+
+   Find, for the run-time, the literals any match of 'l' must hold, how long it can be and how
+   it starts and ends; then choose the engine to run it. 'l' is finished; i.e
+   regexlt_optimizeProgram() has made all its changes.
+*/
+PUBLIC void regexlt_analyzeProgram(S_InstrList *l)
+{
+   requiredLiterals(l);
+   matchLengths(l);
+   literalAffixes(l);
+   startChars(l);
+   chooseEngine(l);
+}
+
+// ---------------------------------------------- eof --------------------------------------------------
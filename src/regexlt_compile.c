@@ -131,7 +131,7 @@ PRIVATE BOOL bumpIfEmpty(S_CharsBox *cb)
    to the next S_CharSegs slot, which is written to 'OpCode_Null'
 */
 
-PRIVATE C8 const escapedChars[] = "\\|.*?{}()^$";
+PRIVATE C8 const escapedChars[] = "\\|.*?+{}()[]^$";
 PRIVATE C8 const escapedAnchors[] = "bBIi";              // Word boundaries 'Bb' and case/no-case 'iI'
 
 PRIVATE BOOL handleEscapedNonWhtSpc(S_ClassesList *cl, S_CharsBox *cb, C8 ch)
@@ -187,10 +187,6 @@ PRIVATE BOOL isaRepeat(C8 const *rgx)
          : (ch == '?' || ch == '*' || ch == '+');  // Not a range; is it a single char?
 }
 
-// ----------- Advance to ']'.
-PRIVATE C8 const * toClosesClass(C8 const *p)
-   { for(; *p != ']' && *p != '\0'; p++) {} return p-1; }
-
 // ----------- Advance to '}'.
 PRIVATE C8 const * toClosesRpt(C8 const *p)
    { for(; *p != '}' && *p != '\0'; p++) {} return p; }
@@ -210,6 +206,83 @@ PRIVATE BOOL gotAtLeast1Char(S_CharsBox const *cb)
 }
 
 
+/* --------------------------- Stack of open groups -------------------------------------
+
+   Each group gets a capture slot, numbered 1.. in the order of its '('. The CharBox which
+   closes a group is given the slot of the innermost group still open; the run-time records
+   the capture straight into that slot (see regexlt_run.c/addCapture()). '(?:...)' and
+   '(?>...)' capture nothing; they are stacked as slot 0, which records nothing.
+
+   Each group also notes the instruction it starts at, 'at'; so a repeat of the whole group
+   e.g '(ab*)+' can loop back there. 'closedAt' is where the group closed last started.
+*/
+#define _GroupStackSize 8
+#define _NoGroupAt 0xFF
+typedef struct { U8 s[_GroupStackSize]; T_InstrIdx at[_GroupStackSize], closedAt; U8 put, cnt; } S_Groups;
+PRIVATE S_Groups grps;
+
+PRIVATE void grps_Init(void)
+   { grps.put = 0; grps.cnt = 0; grps.closedAt = _NoGroupAt; }
+
+PRIVATE BOOL grps_Open(BOOL capture) {
+   if(grps.put >= _GroupStackSize || grps.cnt >= MAX_U8) {
+      return FALSE; }
+   else {
+      grps.at[grps.put] = _NoGroupAt;        // Until regexlt_compileRegex() says where.
+      grps.s[grps.put++] = capture ? ++grps.cnt : 0;
+      return TRUE; }}
+
+PRIVATE U8 grps_Close(void) {
+   if(grps.put == 0) {
+      return 0; }
+   else {
+      grps.closedAt = grps.at[--grps.put];
+      return grps.s[grps.put]; }}
+
+/* --------------------------- Atomic groups -------------------------------------
+
+   A thread never backs up; so an atomic group '(?>...)' is compiled only where there's just one
+   thing in it which could give chars back; a repeat, and that last e.g '(?>ab+)'. Then the group
+   is the same as making that repeat possessive i.e 'ab++'. Anything else e.g '(?>a*ab)' or
+   '(?>a|ab)' doesn't compile.
+
+   'atomicRpt' says the repeat which ends the current '(?>...)' is to be possessive.
+*/
+PRIVATE BOOL atomicRpt;
+
+/* Check the body of '(?>...)', from 'p', just after the '?>'. Return FALSE if it's one which
+   can't be compiled, else TRUE and set 'atomicRpt' if it ends on a repeat.
+*/
+PRIVATE BOOL atomicBody(C8 const *p)
+{
+   BOOL inClass = FALSE;
+
+   for(atomicRpt = FALSE; *p != '\0'; p++)
+   {
+      if(atomicRpt && *p != ')')                         // Something after the repeat?
+         { return FALSE; }                               // then it's not the last; fail.
+      else if(*p == '\\' && p[1] != '\0')               // An escape?
+         { p++; }                                        // is one char or class, whatever it is.
+      else if(inClass)
+         { inClass = *p != ']'; }
+      else if(*p == '[')
+         { inClass = TRUE; }
+      else if(*p == ')')                                 // Reached the close.
+         { return TRUE; }
+      else if(*p == '(' || *p == '|')                    // A nested group or alternates?
+         { return FALSE; }                               // then fail.
+      else if(isaRepeat(p))                              // A repeat, the 1st?
+      {
+         if(*p == '{')                                   // Skip a '{n,m}'...
+            { p = toClosesRpt(p); }
+         if(p[1] == '+')                                 // ...and if it's possessive already, it's '+'.
+            { p++; }
+         atomicRpt = TRUE;
+      }
+   }
+   return FALSE;                                         // No close; fail.
+}
+
 /* ----------------------------- fillCharBox ---------------------------------
 
    Given an (empty) 'character box' and a location in the regex string, read at
@@ -233,6 +306,10 @@ PRIVATE BOOL fillCharBox(S_ClassesList *cl, S_CharsBox *cb, C8 const **regexStr)
    T_ParseRtn rtn;
 
    S_CharSegs * sgs = cb->segs;
+
+   if(cb->bufSize == 0)                   // Prescan under-counted; no room for even a terminator?
+      { return FALSE; }                   // then fail, rather than overrun.
+
    cb->put = 0;                           // Fill 'cb' starting at cb->buf[0].
    sgs[cb->put].opcode = OpCode_Null;      // Until we fill it this 1st segment has no opcode, and...
    sgs[cb->put].payload.literals.len = 0;     // and, for a chars-segment, no chars either.
@@ -242,8 +319,16 @@ PRIVATE BOOL fillCharBox(S_ClassesList *cl, S_CharsBox *cb, C8 const **regexStr)
    */
    if(**regexStr == '(')
    {
+      C8 const *opt = *regexStr + 1;
+      BOOL capture = !(opt[0] == '?' && (opt[1] == ':' || opt[1] == '>'));   // Not '(?:' or '(?>'?
+
+      if(!capture && opt[1] == '>' && atomicBody(opt+2) == FALSE)   // Atomic, but not one we can do?
+         { return FALSE; }          // then fail.
+
+      if(grps_Open(capture) == FALSE)  // Number the group; it's capture slot. Too deeply nested?
+         { return FALSE; }          // then fail.
       cb->opensGroup = TRUE;
-      (*regexStr)++;                // Goto next char.
+      *regexStr = capture ? opt : opt+2;   // Goto next char; past any '?:' or '?>'.
    }
 
    while(1)
@@ -293,11 +378,11 @@ PRIVATE BOOL fillCharBox(S_ClassesList *cl, S_CharsBox *cb, C8 const **regexStr)
                      return FALSE;
 
                   case '[':      // Opens a char class.
-                     // First, if this char-class is preceded by a chars-segment AND followed by a repeat-specifier,
-                     // then we must close out the current Chars-Box and start a new one for the (repeated)
-                     // char-class. This because the repeat binds only the preceding class.
-                     if( gotAtLeast1Char(cb) &&                      // Already got a partial chars-segment or whole segment(s), any type?
-                         isaRepeat( toClosesClass(*regexStr))+1 )    // ...repeat operator e.g follows this e.g [0-8]{1,4}.
+                     // First, if this char-class is preceded by a chars-segment then we close out the current Chars-Box
+                     // and start a new one for the char-class. A repeat e.g [0-8]{1,4} binds only the class. And, even
+                     // unrepeated, a group which is one box holding chars then a class e.g '(b[a-c]c)?' doesn't compile
+                     // right; so the class always starts a box.
+                     if( gotAtLeast1Char(cb) )                       // Already got a partial chars-segment or whole segment(s), any type?
                      {
                         if( !bumpIfEmpty(cb) )                       // If necessary, advance to an open 'Null' char-box.
                            { return FALSE; }                         // Return fail if didn't count and malloc() enuf S_CharSegs in prescan.
@@ -384,6 +469,13 @@ PRIVATE BOOL fillCharBox(S_ClassesList *cl, S_CharsBox *cb, C8 const **regexStr)
                               sgs[cb->put].payload.literals.len++;   // So add current char to segment; by incrementing segment length.
                            }
                         }
+                        else if( gotAtLeast1Char(cb) &&              // else this opcode is Null, after a class, escape or anchor? AND
+                                 isaRepeat((*regexStr)+1) )          // a repeat-operator follows the current char?
+                        {                                            // then, as above, it goes into a Box of it's own...
+                           sgs[cb->put].opcode = OpCode_Match;       // ...so terminate this one.
+                           cb->numSegs = cb->put+1;
+                           return TRUE;
+                        }
                         else                                         // else this opcode is Null, meaning empty.
                         {
                            sgs[cb->put].opcode = OpCode_Chars;                // so start a new chars segment in it.
@@ -428,10 +520,10 @@ PRIVATE BOOL fillCharBox(S_ClassesList *cl, S_CharsBox *cb, C8 const **regexStr)
    The 'put' is advanced to the next free instruction slot.
 */
 
-PRIVATE void clearRepeats(S_RepeatSpec *r) {r->min = r->max = 0; r->cntsValid = FALSE; r->always = FALSE; }
+PRIVATE void clearRepeats(S_RepeatSpec *r) {r->min = r->max = 0; r->cntsValid = FALSE; r->always = FALSE; r->possessive = FALSE; }
 
 PRIVATE S_CharsBox const emptyCharsBox =
-   {.segs = NULL, .put = 0, .numSegs = 0, .opensGroup = FALSE, .closesGroup = FALSE, .eatUntilMatch = FALSE };
+   {.segs = NULL, .put = 0, .numSegs = 0, .opensGroup = FALSE, .closesGroup = FALSE, .closesPastRpt = FALSE, .eatUntilMatch = FALSE };
 
 // -------- Room to append another instruction to pre-allocated instruction list.
 PRIVATE BOOL mayAppendInstr(S_Program const *p)
@@ -620,11 +712,13 @@ PRIVATE BOOL attachCharBox_wRepeats(S_Program *p, S_CharsBox *cb, S_RepeatSpec c
                { ins->repeats = *rpts; }
 
             // If this CharBox opens or closes a subgroup, then add that attribute to the instruction.
-            if(cb->opensGroup == TRUE)
-               { ins->opensGroup = TRUE; }
+            ins->opensGroup = cb->opensGroup;
+            ins->closesGroup = cb->closesGroup;
+            ins->rptInGroup = cb->opensGroup && cb->closesGroup && cb->closesPastRpt;
 
+            ins->group = 0;
             if(cb->closesGroup == TRUE)
-               { ins->closesGroup = TRUE; }
+               { ins->group = grps_Close(); }               // Captures go to the slot of the innermost open group.
 
             p->instrs.put++;                                // Advance 'Put' to next instruction
             p->chSegs.put += cb->numSegs;                    // Also bump 'put' for the chars-group store to next free.
@@ -644,15 +738,210 @@ PRIVATE BOOL attachCharBox(S_Program *p, S_CharsBox *cb)
 
 /* ----------------------------- lookaheadFor_GroupClose ------------------------------------
 
-   Mark if the next char from 'rs' closes a Group.
+   Mark if the next char from 'rs' closes a Group. Looks past the '+' of a possessive e.g 'a*+)'.
+   The repeat at 'rs' is then inside the group.
 */
 PRIVATE S_CharsBox * lookaheadFor_GroupClose(S_CharsBox *cb, C8 const *rs)
 {
-   if(*(rs + 1) == ')')
-      { cb->closesGroup = TRUE; }
+   if(*(rs + 1) == ')' || (*(rs + 1) == '+' && *(rs + 2) == ')'))
+      { cb->closesGroup = TRUE; cb->closesPastRpt = TRUE; }
    return cb;
 }
 
+/* ----------------------------- possessive ------------------------------------
+
+   A repeat just compiled, with it's 'Split' at 'split', is possessive if it's followed by '+'
+   e.g 'a*+', 'a{2,}+', or if it ends a '(?>...)'. If so, advance 'rgx' past any '+' and mark the
+   'Split' possessive. At run-time, if the CharBox it loops on matches next, the Split doesn't
+   take it's exit (see regexlt_run.c/runOnce()).
+
+   That works only where the loop is around a single CharBox. Return FALSE if it isn't; the regex
+   can't be compiled.
+*/
+PRIVATE BOOL possessive(S_Program *p, T_InstrIdx split, C8 const **rgx)
+{
+   BOOL poss = atomicRpt && ((*rgx)[0] == ')' || ((*rgx)[0] == '+' && (*rgx)[1] == ')'));
+
+   if(**rgx == '+')                                   // 'a*+' etc?
+      { (*rgx)++; poss = TRUE; }                      // then the '+' is taken.
+
+   if(poss == FALSE)
+      { return TRUE; }
+
+   atomicRpt = FALSE;                                 // (If it was the end of a '(?>...)' then that's done now.)
+
+   S_Instr *b = p->instrs.buf;
+   T_InstrIdx l = b[split].left;
+
+   if( split >= p->instrs.put || b[split].opcode != OpCode_Split ||
+       l >= p->instrs.put || b[l].opcode != OpCode_CharBox ||
+       !( l+1 == split ||                                                         // 'CharBox -> Split' i.e 'a+'? OR
+          (l == split+1 && b[split].right == split+2) ||                          // 'Split -> CharBox' i.e 'a?'? OR
+          (l == split+1 && b[split].right == split+3 &&                           // 'Split -> CharBox -> Jmp Split' i.e 'a*', 'a{2,5}'?
+           b[split+2].opcode == OpCode_Jmp && b[split+2].left == split)))
+      { return FALSE; }
+
+   b[split].repeats.possessive = TRUE;
+   return TRUE;
+}
+
+/* --------------------------------- Span peephole -----------------------------------------
+
+   A repeat of a single char or class e.g '\d+', '[a-z]*' or 'x{2,5}' compiles to a loop of
+   'Split -> CharBox -> Jmp' ('CharBox -> Split' for '+'). Run as-is the loop forks a thread
+   for every char it eats.
+
+   But if no char which the loop accepts can also start what follows the loop then there's
+   only one way for it to match; eat the longest run there is, up to the max repeats. That's
+   also all a possessive loop e.g '\d++' may do, whatever follows. Such loops are rewritten as
+   a single 'Span' which does just that. The instructions the loop
+   occupied after the 'Span' become NOPs, so no jumps elsewhere need to be moved.
+*/
+
+// Return TRUE if 'cb' holds just a single char (maybe '.'), escaped char or char class.
+PRIVATE BOOL oneCharBox(S_CharsBox const *cb)
+{
+   S_CharSegs const *sg = cb->segs;
+   return
+      cb->numSegs == 2 && sg[1].opcode == OpCode_EndCBox &&             // Just one segment? AND
+      cb->opensGroup == FALSE && cb->closesGroup == FALSE &&            // isn't the edge of a subgroup? AND
+      (sg->opcode == OpCode_EscCh || sg->opcode == OpCode_Class ||      // is an escaped char or class OR
+       (sg->opcode == OpCode_Chars && sg->payload.literals.len == 1));  // a single literal.
+}
+
+/* Return TRUE if 'sg' might match 'ch'. Literals are compared without case because a '\i' might
+   be in force at run time.
+*/
+PRIVATE BOOL segMayMatch(S_CharSegs const *sg, C8 ch)
+{
+   switch(sg->opcode)
+   {
+      case OpCode_Chars:
+         return sg->payload.literals.start[0] == '.' || toupper(sg->payload.literals.start[0]) == toupper(ch);
+
+      case OpCode_EscCh:   return sg->payload.esc.ch == ch;
+      case OpCode_Class:   return C8bag_Contains(sg->payload.charClass, ch);
+      default:             return TRUE;                     // Anything else, we can't tell; so may match.
+   }
+}
+
+// Return TRUE if no char can be matched by both 'a' and 'b'.
+PRIVATE BOOL segsDisjoint(S_CharSegs const *a, S_CharSegs const *b)
+{
+   U16 ch;
+   for(ch = 1; ch <= MAX_U8; ch++) {
+      if(segMayMatch(a, (C8)ch) && segMayMatch(b, (C8)ch)) {
+         return FALSE; }}
+   return TRUE;
+}
+
+/* Return the first instruction at or after 'at' which isn't a NOP. A loop which is followed by
+   (only) that instruction can't be confused with it if the instruction is 'Match', or '$', or a
+   CharBox whose 1st char/class shares no chars with 'sg'.
+*/
+PRIVATE T_InstrIdx skipNOPs(S_InstrList const *l, T_InstrIdx at)
+{
+   for(; at < l->put && l->buf[at].opcode == OpCode_NOP; at++) {}
+   return at;
+}
+
+PRIVATE BOOL endsCleanly(S_InstrList const *l, S_CharSegs const *sg, T_InstrIdx next)
+{
+   S_Instr const *ins = &l->buf[next];
+
+   if(next >= l->put)
+      { return FALSE; }
+   else if(ins->opcode == OpCode_Match)
+      { return TRUE; }
+   else if(ins->opcode == OpCode_CharBox)
+      { return ins->charBox.segs[0].opcode == OpCode_Anchor
+                  ? ins->charBox.segs[0].payload.anchor.ch == '$'
+                  : segsDisjoint(sg, &ins->charBox.segs[0]); }
+   else
+      { return FALSE; }
+}
+
+// Return TRUE if any Jmp or Split outside 'first' to 'last' lands after 'first' and up to 'last'.
+PRIVATE BOOL jumpedInto(S_InstrList const *l, T_InstrIdx first, T_InstrIdx last)
+{
+   T_InstrIdx i;
+   for(i = 0; i < l->put; i++)
+   {
+      S_Instr const *ins = &l->buf[i];
+
+      if(i < first || i > last)
+      {
+         if( (ins->opcode == OpCode_Jmp || ins->opcode == OpCode_Split) && ins->left > first && ins->left <= last )
+            { return TRUE; }
+         if( ins->opcode == OpCode_Split && ins->right > first && ins->right <= last )
+            { return TRUE; }
+      }
+   }
+   return FALSE;
+}
+
+/* Rewrite the loop from 'first' to 'last' around CharBox 'box' as a 'Span' of 'r' repeats, if
+   it is one we can. Return TRUE if did so.
+*/
+PRIVATE BOOL toSpan(S_InstrList *l, T_InstrIdx first, T_InstrIdx last, T_InstrIdx box, S_RepeatSpec const *r)
+{
+   S_Instr *b = l->buf;
+   T_InstrIdx next = skipNOPs(l, last+1);
+
+   if( oneCharBox(&b[box].charBox) == FALSE ||                          // Loop isn't around a single char or class? OR
+       b[box].opensGroup || b[box].closesGroup ||                       // it's the edge of a subgroup? OR
+       (b[box].charBox.eatUntilMatch && r->min == 0) ||                 // eats leading mismatches but may also match nothing? OR
+       jumpedInto(l, first, last) ||                                    // something jumps into the middle of the loop? OR
+       !(endsCleanly(l, b[box].charBox.segs, next) ||                   // what follows might be confused with the loop...
+         (r->possessive && !b[box].charBox.eatUntilMatch)))             // ...and the loop may give chars back?
+      { return FALSE; }                                                 // then leave the loop as-is.
+   else
+   {
+      S_CharsBox cb = b[box].charBox;
+      T_InstrIdx i;
+
+      for(i = first; i <= last; i++) {                                  // Clear out the loop.
+         b[i].opcode = OpCode_NOP;
+         b[i].charBox = emptyCharsBox;
+         b[i].left = 0; b[i].right = 0;
+         clearRepeats(&b[i].repeats); }
+
+      b[first].opcode = OpCode_Span;                                    // and put the 'Span' where the loop started.
+      b[first].charBox = cb;
+      b[first].repeats = *r;
+      b[first].left = next;                                             // It continues to whatever follows the loop.
+      return TRUE;
+   }
+}
+
+PRIVATE void makeSpans(S_InstrList *l)
+{
+   S_Instr const *b = l->buf;
+   T_InstrIdx i;
+
+   for(i = 0; i+2 < l->put; i++)
+   {
+      S_Instr const *ins = &b[i];
+
+      // 'x*' or 'x{n,m}' is 'Split(i+1, i+3) -> CharBox -> Jmp i'
+      if(ins->opcode == OpCode_Split && ins->left == i+1 && ins->right == i+3 &&
+         (ins->repeats.always || ins->repeats.cntsValid) &&
+         b[i+1].opcode == OpCode_CharBox && b[i+2].opcode == OpCode_Jmp && b[i+2].left == i)
+      {
+         S_RepeatSpec r = ins->repeats.always
+            ? (S_RepeatSpec){.min = 0, .max = _Repeats_Unlimited, .cntsValid = TRUE, .possessive = ins->repeats.possessive}
+            : ins->repeats;
+         toSpan(l, i, i+2, i+1, &r);
+      }
+      // 'x+' is 'CharBox -> Split(i, i+2)'
+      else if(ins->opcode == OpCode_CharBox &&
+              b[i+1].opcode == OpCode_Split && b[i+1].left == i && b[i+1].right == i+2)
+      {
+         toSpan(l, i, i+1, i, &(S_RepeatSpec){.min = 1, .max = _Repeats_Unlimited, .cntsValid = TRUE, .possessive = b[i+1].repeats.possessive});
+      }
+   }
+}
+
 /* ------------------------------ Stack for Split closures -------------------------------------
 
    For e.g  '\\d{5}(-\\d{4})?'. This stack holds an instruction slot for a Split at the opening
@@ -698,6 +987,10 @@ PUBLIC BOOL regexlt_compileRegex(S_Program *prog, C8 const *regexStr)
    prog->instrs.put = 0;               // Zero 'put's for the instruction and character buffers.
    prog->chSegs.put = 0;
    prog->classes.put = 0;
+   prog->instrs.engine = E_Engine_NFA;  // Until regexlt_analyzeProgram() chooses another.
+   prog->instrs.alternates = FALSE;     // Until we meet a '|', with repeats (see S_InstrList).
+   prog->instrs.masks = NULL;
+   prog->instrs.skips = NULL;
    C8 firstOp = 0;
 
    /* A new zero-length Chars-Box. Attach to the malloced 'prog.chars.buf'. Copy in 'bufSize'; used
@@ -709,8 +1002,11 @@ PUBLIC BOOL regexlt_compileRegex(S_Program *prog, C8 const *regexStr)
    S_RepeatSpec   rpt;
    T_InstrIdx     rightFork;
    T_InstrIdx m;
+   T_InstrIdx     split;               // The 'Split' of the repeat just compiled; in case it's possessive.
 
    nops_Init();
+   grps_Init();
+   atomicRpt = FALSE;
 
    while(1)                            // Until end-of-regex or there's a compile error.
    {
@@ -731,14 +1027,19 @@ PUBLIC BOOL regexlt_compileRegex(S_Program *prog, C8 const *regexStr)
                {
                   if(!attachCharBox(prog, &cb)) {        // Attach the last CharBox we made (below)
                      return FALSE; }
-                  return addFinalMatch(prog);            // 'Match' terminates the program. Success! (if there was room to add it).
+                  if(!addFinalMatch(prog)) {             // 'Match' terminates the program. Success! (if there was room to add it).
+                     return FALSE; }
+                  makeSpans(&prog->instrs);              // Swap simple loops for 'Span's, where we can.
+                  prog->instrs.groups = grps.cnt;
+                  return TRUE;
                }
                break;
 
             case '?':                                 // --- Zero or one
                if( (m = nops_Pop()) != _NotANOP)            // The 'open' for this '?' was back somewhere. We left a NOP, ready to fill
-                  { addSplitAbs(prog, m, m+1, prog->instrs.put); }   // so fill that NOP; either try succeeding Chars-Boxes or skip them.
+                  { addSplitAbs(prog, split = m, m+1, prog->instrs.put); }   // so fill that NOP; either try succeeding Chars-Boxes or skip them.
                else {                                       // else the open for this '?' is just the Chars_box we are about to attach.
+                  split = prog->instrs.put;
                   if(!addSplit(prog, +1, +2)) {             // so either try next or skip it..
                      return FALSE; }}                       // Couldn't add; Bail!
 
@@ -750,9 +1051,12 @@ PUBLIC BOOL regexlt_compileRegex(S_Program *prog, C8 const *regexStr)
                   prog->instrs.buf[0].charBox.eatUntilMatch == TRUE)  // that CBox was an 'eatUntilMatch'?
                   { eatYet = TRUE; }                        // then the CBox to right of '*' will be too. - because it's a 'zero-or'.
                rgxP++;
+               if(!possessive(prog, split, &rgxP)) {        // '?+'? Only if that's a single CharBox.
+                  return FALSE; }
                break;
 
             case '*':                                 // --- Zero or more
+               split = prog->instrs.put;
                if(cb.numSegs == 0) {                        // No CBox to add? (was closed out by a preceding group)
                   if(!addSplit_wMore(prog, +1, +2)) {       // Either try next JMP or skip it
                      return FALSE; }}                       // Couldn't add; Bail!
@@ -779,14 +1083,26 @@ PUBLIC BOOL regexlt_compileRegex(S_Program *prog, C8 const *regexStr)
                   prog->instrs.buf[0].charBox.eatUntilMatch == TRUE)  // that 1st CBox was an 'eatUntilMatch'?
                   { eatYet = TRUE; }                        // then the one right of '*' will be too. - because it's a 'zero-or'.
                rgxP++;
+               if(!possessive(prog, split, &rgxP)) {        // '*+'?
+                  return FALSE; }
                break;
 
             case '+':                                 // --- One or more
+            {
+               BOOL ofGroup = cb.numSegs == 0 || cb.closesGroup;  // A ')' came before the '+'? then it repeats the whole group.
+
                attachCharBox(prog,                          // Always try this once...
                   lookaheadFor_GroupClose(&cb, rgxP));      // If ')' after the '+' then close current subgroup at the CharBox.
-               addSplit(prog, -1, +1);                      // then either move on or retry.
+               split = prog->instrs.put;
+               if(ofGroup && grps.closedAt != _NoGroupAt)   // Repeats a group?
+                  { addSplitAbs(prog, split, grps.closedAt, split+1); }   // then either move on or retry from the start of the group...
+               else
+                  { addSplit(prog, -1, +1); }               // ...else just the CharBox.
                rgxP++;
+               if(!possessive(prog, split, &rgxP)) {        // '++'?
+                  return FALSE; }
                break;
+            }
 
             case '|':                                 // --- Alternates
                if( (m = nops_Pop()) != _NotANOP)            // The 'open' for the right of this '|' was back somewhere. We left a NOP, ready to fill
@@ -798,6 +1114,8 @@ PUBLIC BOOL regexlt_compileRegex(S_Program *prog, C8 const *regexStr)
                if(!attachCharBox(prog, &cb)) {              // Attach fork-left ... which we parsed before reaching '|'. Goto next free bytecode slot.
                   return FALSE; }
                forked = TRUE;                               // Mark that we forked; so we know when we finally get code-right.
+               if(strpbrk(regexStr, "*+?{") != NULL)        // Any repeats, anywhere? (or maybe just escaped chars; no matter)
+                  { prog->instrs.alternates = TRUE; }       // then tell regexlt_analyzeProgram(); see S_InstrList.
                boxesToRight = 0;                            // Will count CharBoxes to right of '|' which are arguments or that '|'. So can JMP past them.
                rgxP++;                                      // Goto next char past '|'.
                break;
@@ -813,14 +1131,15 @@ PUBLIC BOOL regexlt_compileRegex(S_Program *prog, C8 const *regexStr)
                else                                         // else got a repeat specifier intp 'rpt'
                {
                   if( (m = nops_Pop()) != _NotANOP)
-                     { addSplitAbs_wRepeats(prog, m, m+1, prog->instrs.put+2, &rpt); } // so fill that NOP; either try succeeding Chars-Boxes or skip them.
+                     { addSplitAbs_wRepeats(prog, split = m, m+1, prog->instrs.put+2, &rpt); } // so fill that NOP; either try succeeding Chars-Boxes or skip them.
                   else {
+                     split = prog->instrs.put;
                      if(!addSplit_wRepeats(prog, +1, +3, &rpt)) { // Write a 'Split' ('zero-or-more') with 'rpt' attached.
                         return FALSE; }}                        // Couldn't add; Bail!
 
                   // If e.g '(ab{3,5})' then the ')' closes the group which started at the preceding CBox.
-                  if(*rgxP == ')') {
-                     cb.closesGroup = TRUE;}
+                  if(*rgxP == ')' || (*rgxP == '+' && *(rgxP+1) == ')')) {
+                     cb.closesGroup = TRUE; cb.closesPastRpt = TRUE; }
 
                   /* Attach the CBox, but also clone the repeat-specifier which was placed in the preceding
                      Split. When executing the compiled regex (regexlt_run.c/runOnce()) if the CBox has no
@@ -833,6 +1152,8 @@ PUBLIC BOOL regexlt_compileRegex(S_Program *prog, C8 const *regexStr)
                      return FALSE; }
                   if(!addJump(prog, -2)) {                  // then back to retry or move on.
                      return FALSE; }
+                  if(!possessive(prog, split, &rgxP)) {     // '{n,m}+'?
+                     return FALSE; }
                   break;
                }
 
@@ -869,6 +1190,7 @@ PUBLIC BOOL regexlt_compileRegex(S_Program *prog, C8 const *regexStr)
                   we reach the close ')' for this open. Then we can fill the Split to execute or bypass
                   everything between the '(' and the ')'.
                */
+               T_InstrIdx groupAt = prog->instrs.put;          // A group opened here starts here; before any Split for it (below).
 #if 1
                if(*rgxP == '(')                                // Next chars segment starts a group? ... which may have multiple sub-clauses.
                {                                               // If next operator is '|' or '?' then we must leave a placegolder for a 'Split'...
@@ -891,6 +1213,9 @@ PUBLIC BOOL regexlt_compileRegex(S_Program *prog, C8 const *regexStr)
                {
                   gotCharBox = TRUE;                           // Mark that there's an assembled Box.
 
+                  if(cb.opensGroup)                            // Opened a group?
+                     { grps.at[grps.put-1] = groupAt; }        // then a repeat of the whole of it loops back to here.
+
                   if(firstOp == 0)                             // Didn't already get the 1st right operator?
                      { firstOp = rightOperator(segStart); }    // then find it now.
 
@@ -2,10 +2,17 @@
 |
 | Non-backtracking Lite Regex - Memory Management
 |
+| All of RegexLT_'s heap comes and goes through here, from and to the getMem() and free()
+| supplied to RegexLT_Init().
+|
+|  Public:
+|     RegexLT_TrackMem()
+|
 --------------------------------------------------------------------------------*/
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdarg.h>
 #include "libs_support.h"
 #include "regexlt_private.h"
@@ -14,12 +21,113 @@
 #define dbgPrint     regexlt_dbgPrint
 #define br           regexlt_cfg
 
+PUBLIC RegexLT_S_Stats *regexlt_stats = NULL;
+
+#define countStat    regexlt_countStat
+
+/* ------------------------------------ Accounting --------------------------------------
+
+   free() isn't told the size of what it frees. So, while accounting, each block is got with a
+   tag ahead of it, saying how big it is and what it's for. The tag is sized to keep the block
+   after it aligned.
+
+   Blocks are tagged or not, depending on whether accounting was on when they were got. So it
+   can be switched only when none are out; 'blocksOut' counts them, always.
+*/
+typedef union {
+   struct { size_t numBytes; RegexLT_T_MemFor purpose; } is;
+   max_align_t align;
+} U_MemTag;
+
+PRIVATE RegexLT_S_MemUse *memUse = NULL;
+PRIVATE U32 blocksOut = 0;
+
+PRIVATE void countGot(RegexLT_S_MemCnts *c, size_t numBytes)
+{
+   c->getMems++;
+   if( (c->live += numBytes) > c->peak)
+      { c->peak = c->live; }
+}
+
+PRIVATE void countFreed(RegexLT_S_MemCnts *c, size_t numBytes)
+   { c->frees++; c->live -= numBytes; }
+
+/* ----------------------------- RegexLT_TrackMem --------------------------------------
+
+   Account, into 'use', for all the heap RegexLT_ gets and frees from now; live and peak bytes
+   and getMem()s and free()s, in all and for each purpose. 'use' is cleared. To restart the
+   peaks, set them to 'live'. NULL stops accounting.
+
+   Accounting can be started or stopped only when RegexLT_ holds no memory, i.e all programs
+   and match lists have been freed. Return FALSE if it holds some, and leave things as they were.
+*/
+PUBLIC BOOL RegexLT_TrackMem(RegexLT_S_MemUse *use)
+{
+   if(blocksOut > 0)
+      { return FALSE; }
+   else
+   {
+      if( (memUse = use) != NULL)
+         { *memUse = (RegexLT_S_MemUse){0}; }
+      return TRUE;
+   }
+}
+
+/* ----------------------------- regexlt_getMem --------------------------------------
+
+   getMem() 'numBytes' for 'purpose'.
+*/
+PUBLIC void * regexlt_getMem(size_t numBytes, RegexLT_T_MemFor purpose)
+{
+   void *p;
+
+   if(memUse == NULL)                                             // Not accounting?
+   {
+      if( (p = br->getMem(numBytes)) == NULL)
+         { return NULL; }
+   }
+   else                                                           // else get a tag too and fill it in.
+   {
+      U_MemTag *tag;
+      if( (tag = br->getMem(numBytes + sizeof(U_MemTag))) == NULL)
+         { return NULL; }
+
+      tag->is.numBytes = numBytes;
+      tag->is.purpose = purpose < _RegexMem_NumPurposes ? purpose : E_RegexMem_Other;
+      countGot(&memUse->all, numBytes);
+      countGot(&memUse->by[tag->is.purpose], numBytes);
+      p = tag + 1;
+   }
+
+   blocksOut++;
+   if(regexlt_stats != NULL)
+   {
+      regexlt_stats->getMems++;
+      regexlt_stats->getMemBytes += numBytes;
+   }
+   return p;
+}
+
+#define getMem       regexlt_getMem
 
 /* ----------------------------- regexlt_safeFree(List) -------------------------------------- */
 
 PUBLIC void regexlt_safeFree(void *p)
-   { if(br->free != NULL && p != NULL)
-      { br->free(p); }}
+{
+   if(br->free != NULL && p != NULL)
+   {
+      if(memUse != NULL)                                          // Accounting? then 'p' has a tag.
+      {
+         U_MemTag *tag = (U_MemTag*)p - 1;
+         countFreed(&memUse->all, tag->is.numBytes);
+         countFreed(&memUse->by[tag->is.purpose], tag->is.numBytes);
+         p = tag;
+      }
+      br->free(p);
+      blocksOut--;
+      countStat(frees);
+   }
+}
 
 #define safeFree           regexlt_safeFree
 
@@ -49,12 +157,12 @@ PUBLIC BOOL regexlt_getMemMultiple(S_TryMalloc *lst, U8 listSize)
             *tgt = NULL;
          }
          else {
-            if( (*tgt = br->getMem(lst[c].numBytes)) == NULL) {
-               do {                          // For this malloc and each previous one
-                  safeFree(*tgt);            // free()
-                  *tgt = NULL;               // and NULL the mem ptr.
+            if( (*tgt = getMem(lst[c].numBytes, lst[c].purpose)) == NULL) {
+               while(c > 0) {                // For each previous malloc
                   c--;
-               } while(c > 0);
+                  if(lst[c].mem != NULL) {
+                     safeFree(*lst[c].mem);  // free()
+                     *lst[c].mem = NULL; }}  // and NULL the mem ptr.
                return FALSE; } }}             // Return failure.
    }
    return TRUE;                           // else all mallocs done. Success!
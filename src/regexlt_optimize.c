@@ -0,0 +1,559 @@
+/* ------------------------------------------------------------------------------
+|
+| Non-backtracking Lite Regex - Optimize a compiled program.
+|
+| regexlt_compileRegex() emits instructions as it parses and never goes back over them.
+| So NOPs from '(' which no 'Split' filled, or left by the 'Span' peephole, Jmps onto Jmps
+| and CharBoxes split apart with no operator between them all reach the run-time.
+|
+| The passes here are each exact; the program runs as before, just with fewer steps.
+|
+|     - Jump threading:    Jmp -> Jmp -> X  becomes  Jmp -> X; and a Jmp to the next
+|                          instruction is dropped.
+|     - Split to Jmp:      Split(x, x)      becomes  Jmp x
+|     - CharBox concat:    CharBox 'ab' -> CharBox 'cd'  becomes  CharBox 'abcd'
+|     - Compaction:        NOPs and instructions which can't be reached are removed and
+|                          the program renumbered.
+|
+| Then the finished program is marked up for the run-time:
+|
+|     - Idle counts:       where a thread's repeat count can no longer be read.
+|     - Thread bound:      the most threads a thread list can hold at once.
+|     - Anchored start:    every path starts with '^'.
+|
+| And what a match must look like is worked out by regexlt_analyzeProgram().
+|
+|  Public:
+|     regexlt_optimizeProgram()
+|
+--------------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include "libs_support.h"
+#include "util.h"
+#include "regexlt_private.h"
+
+// Private to RegexLT_'.
+#define dbgPrint           regexlt_dbgPrint
+
+PRIVATE void clearRepeats(S_RepeatSpec *r) {r->min = r->max = 0; r->cntsValid = FALSE; r->always = FALSE; r->possessive = FALSE; }
+
+PRIVATE S_CharsBox const emptyCharsBox =
+   {.segs = NULL, .put = 0, .numSegs = 0, .opensGroup = FALSE, .closesGroup = FALSE, .eatUntilMatch = FALSE };
+
+PRIVATE void toNOP(S_Instr *ins)
+{
+   ins->opcode = OpCode_NOP;
+   ins->charBox = emptyCharsBox;
+   ins->left = 0; ins->right = 0;
+   ins->opensGroup = FALSE; ins->closesGroup = FALSE; ins->group = 0;
+   clearRepeats(&ins->repeats);
+}
+
+/* ---------------------------------- Jump threading -----------------------------------
+
+   A jump or fork onto a 'Jmp' is sent straight on to where that 'Jmp' goes. But the run-time
+   bumps a thread's repeat count on each jump backwards (and a Split's right fork and a Span
+   start the count afresh). So only thread where the count comes out the same. And not through
+   a 'Jmp' which sits before 'Match', or which goes to 'Match'. The run-time notes a minimal
+   match on the one and the order threads reach 'Match' decides which match is kept.
+
+   A counted Split is left alone; it's 'left' also says which CharBox it counts.
+*/
+PRIVATE BOOL mayThreadThru(S_InstrList const *l, T_InstrIdx t)
+{
+   return
+      l->buf[t].opcode == OpCode_Jmp &&                     // Lands on a Jmp? AND
+      t+1 < l->put && l->buf[t+1].opcode != OpCode_Match && // that Jmp doesn't end the regex? AND
+      l->buf[l->buf[t].left].opcode != OpCode_Match;        // doesn't go to 'Match'?
+}
+
+PRIVATE BOOL threadJumps(S_InstrList *l)
+{
+   BOOL changed = FALSE;
+   T_InstrIdx i;
+
+   for(i = 0; i < l->put; i++)
+   {
+      S_Instr *ins = &l->buf[i];
+      T_InstrIdx t, u;
+
+      if(ins->opcode == OpCode_Jmp ||                                      // A Jmp? OR
+         (ins->opcode == OpCode_Split && !ins->repeats.cntsValid))        // an uncounted Split?
+      {                                                                    // then 'left' is bumped if it jumps back.
+         while( mayThreadThru(l, t = ins->left) && (u = l->buf[t].left) != i && u != t &&
+                (t < i) + (u < t) == (u < i) )                             // Bumps the same whether thru the Jmp or not?
+            { ins->left = u; changed = TRUE; }
+
+         if(ins->opcode == OpCode_Jmp && ins->left == i+1 &&              // Jmp to the very next instruction? AND
+            l->buf[i+1].opcode != OpCode_Match)                           // not at the end of the regex? (see above)
+            { toNOP(ins); changed = TRUE; }                               // then it does nothing.
+      }
+
+      if(ins->opcode == OpCode_Split && !ins->repeats.cntsValid)          // Right fork of a Split?...
+      {                                                                    // ...starts counts afresh; so only thread thru a Jmp forward.
+         while( mayThreadThru(l, t = ins->right) && (u = l->buf[t].left) > t )
+            { ins->right = u; changed = TRUE; }
+      }
+      else if(ins->opcode == OpCode_Span)                                 // Span continues with fresh counts too.
+      {                                                                    // But it also treats a continuation to 'Match' specially, so don't make one.
+         while( mayThreadThru(l, t = ins->left) && (u = l->buf[t].left) > t && l->buf[u].opcode != OpCode_Match )
+            { ins->left = u; changed = TRUE; }
+      }
+   }
+   return changed;
+}
+
+/* ---------------------------------- splitsToJmps -----------------------------------
+
+   A 'Split' whose forks go to the same place is a 'Jmp'. Except the forks carry different
+   repeat counts; that matters only if the program counts repeats somewhere. And two threads
+   into 'Match' aren't the same as one, so leave those.
+*/
+PRIVATE BOOL hasCountedSplits(S_InstrList const *l)
+{
+   T_InstrIdx i;
+   for(i = 0; i < l->put; i++) {
+      if(l->buf[i].opcode == OpCode_Split && l->buf[i].repeats.cntsValid) {
+         return TRUE; }}
+   return FALSE;
+}
+
+PRIVATE BOOL splitsToJmps(S_InstrList *l)
+{
+   BOOL changed = FALSE;
+
+   if(hasCountedSplits(l) == FALSE)
+   {
+      T_InstrIdx i;
+      for(i = 0; i < l->put; i++)
+      {
+         S_Instr *ins = &l->buf[i];
+
+         if(ins->opcode == OpCode_Split && ins->left == ins->right &&     // Both forks to the same place? AND
+            l->buf[ins->left].opcode != OpCode_Match) {                    // not to the end? (see threadJumps())
+            ins->opcode = OpCode_Jmp;
+            ins->right = 0;
+            clearRepeats(&ins->repeats);
+            changed = TRUE; }
+      }
+   }
+   return changed;
+}
+
+/* ---------------------------------- concatCharBoxes -----------------------------------
+
+   Two CharBoxes, one after the other, with no operator, group edge or eat-leading between
+   them and no jump into the 2nd, match just as one CharBox holding both lists. If the 2nd list
+   follows on right after the 1st in 'chSegs' then join them by sliding the 1st up over it's own
+   terminator. The joined list ends where the 2nd did; so it may be joined again to a 3rd. The
+   2nd CharBox becomes a NOP.
+*/
+PRIVATE BOOL jumpedTo(S_InstrList const *l, T_InstrIdx at)
+{
+   T_InstrIdx i;
+   for(i = 0; i < l->put; i++)
+   {
+      S_Instr const *ins = &l->buf[i];
+
+      if( ((ins->opcode == OpCode_Jmp || ins->opcode == OpCode_Split || ins->opcode == OpCode_Span) && ins->left == at) ||
+          (ins->opcode == OpCode_Split && ins->right == at) )
+         { return TRUE; }
+   }
+   return FALSE;
+}
+
+PRIVATE BOOL plainBox(S_Instr const *ins)
+{
+   return
+      ins->opcode == OpCode_CharBox &&
+      !ins->repeats.cntsValid && !ins->repeats.always &&
+      !ins->opensGroup && !ins->closesGroup &&
+      !ins->charBox.opensGroup && !ins->charBox.closesGroup;
+}
+
+PRIVATE BOOL concatCharBoxes(S_InstrList *l)
+{
+   BOOL changed = FALSE;
+   T_InstrIdx i;
+
+   for(i = 0; i+1 < l->put; i++)
+   {
+      S_Instr *a = &l->buf[i];
+      S_Instr *b = &l->buf[i+1];
+
+      if( plainBox(a) && plainBox(b) &&                                          // Both are plain CharBoxes? AND
+          b->charBox.eatUntilMatch == FALSE &&                                   // 2nd doesn't eat leading mismatches? AND
+          a->charBox.segs + a->charBox.numSegs == b->charBox.segs &&             // 2nd list follows on from the 1st? AND
+          a->charBox.segs[a->charBox.numSegs-1].opcode == OpCode_EndCBox &&      // 1st list is properly terminated? AND
+          jumpedTo(l, i+1) == FALSE )                                            // nothing but the 1st leads to the 2nd?
+      {
+         S_CharsBox *ca = &a->charBox;
+
+         memmove(ca->segs+1, ca->segs, (ca->numSegs-1) * sizeof(S_CharSegs));      // 1st list up over it's terminator, to abut the 2nd.
+         ca->segs++;
+         ca->numSegs += b->charBox.numSegs - 1;
+         ca->put = ca->numSegs - 1;
+         toNOP(b);
+         changed = TRUE;
+      }
+   }
+   return changed;
+}
+
+/* ---------------------------------- compact -----------------------------------
+
+   Remove NOPs and any instruction which can't be reached from the start; renumber all
+   jumps to match. The final 'Match' always stays; it terminates the program.
+
+   A jump onto a NOP goes to the 1st instruction after it that stays. Instructions keep their
+   order, so backward jumps stay backward and the run-time counts repeats the same.
+
+   Return FALSE if nothing was removed - or if the program has something unexpected in it,
+   in which case it's left as-is.
+*/
+PRIVATE BOOL compact(S_InstrList *l)
+{
+   BOOL        reached[_Max_T_InstrIdx+1];
+   T_InstrIdx  newIdx[_Max_T_InstrIdx+1];
+   T_InstrIdx  i, put;
+   BOOL        more;
+
+   memset(reached, 0, sizeof(reached));
+
+   for(i = 0; i < l->put; i++) {                                  // Check for unexpected instructions, and jumps off the end.
+      S_Instr const *ins = &l->buf[i];
+      switch(ins->opcode) {
+         case OpCode_NOP: case OpCode_CharBox: case OpCode_Match:
+            break;
+         case OpCode_Split:
+            if(ins->right >= l->put) {
+               return FALSE; }
+            // Fall through - to check 'left' too.
+         case OpCode_Jmp: case OpCode_Span:
+            if(ins->left >= l->put) {
+               return FALSE; }
+            break;
+         default:
+            return FALSE; }}
+
+   if(l->put == 0 || l->buf[l->put-1].opcode != OpCode_Match)        // Not terminated by 'Match'?
+      { return FALSE; }
+
+   // Mark whatever can be reached from the start. Repeat until no more are marked.
+   reached[0] = TRUE;
+   do {
+      more = FALSE;
+      for(i = 0; i < l->put; i++)
+      {
+         if(reached[i] == TRUE)
+         {
+            S_Instr const *ins = &l->buf[i];
+            T_InstrIdx to[2]; U8 n = 0, c;
+
+            switch(ins->opcode) {
+               case OpCode_NOP: case OpCode_CharBox:  to[n++] = i+1;                             break;
+               case OpCode_Jmp: case OpCode_Span:     to[n++] = ins->left;                       break;
+               case OpCode_Split:                     to[n++] = ins->left; to[n++] = ins->right; break;
+               default:                                                                          break; }
+
+            for(c = 0; c < n; c++) {
+               if(to[c] < l->put && reached[to[c]] == FALSE) {
+                  reached[to[c]] = TRUE;
+                  more = TRUE; }}
+         }
+      }
+   } while(more);
+
+   // Number those that stay. A removed one takes the number of the next that stays.
+   BOOL *stays = reached;                                         // (re-use)
+
+   for(i = 0; i < l->put; i++)
+      { stays[i] = (reached[i] && l->buf[i].opcode != OpCode_NOP) || i == l->put-1; }
+
+   /* But a Jmp or Split right before 'Match' tells the run-time there's a minimal match (see runOnce()).
+      So don't close up a gap between one of these and 'Match'; keep a NOP there instead.
+   */
+   for(i = 0; i+1 < l->put; i++)
+   {
+      if(stays[i] && (l->buf[i].opcode == OpCode_Jmp || l->buf[i].opcode == OpCode_Split) && l->buf[i+1].opcode != OpCode_Match)
+      {
+         T_InstrIdx j;
+         for(j = i+1; stays[j] == FALSE; j++) {}                  // Next which stays (there's always the final 'Match')
+         if(j > i+1 && l->buf[j].opcode == OpCode_Match) {        // is 'Match', with a gap between?
+            stays[i+1] = TRUE;                                    // then keep the 1st in the gap...
+            toNOP(&l->buf[i+1]); }                                // ...as a NOP; it was either a NOP or never reached anyway.
+      }
+   }
+
+   for(i = 0, put = 0; i < l->put; i++)
+   {
+      newIdx[i] = put;
+      if(stays[i])
+         { put++; }
+   }
+
+   if(put == l->put)                                              // Keeps everything?
+      { return FALSE; }                                           // then nothing to do.
+
+   for(i = 0; i < l->put; i++)
+   {
+      S_Instr ins = l->buf[i];
+
+      if(stays[i])
+      {
+         if(ins.opcode == OpCode_Jmp || ins.opcode == OpCode_Split || ins.opcode == OpCode_Span)
+            { ins.left = newIdx[ins.left]; }
+         if(ins.opcode == OpCode_Split)
+            { ins.right = newIdx[ins.right]; }
+         l->buf[newIdx[i]] = ins;                                 // Never moves up, so won't overwrite one still to be moved.
+      }
+   }
+   dbgPrint("Optimizer removed %d instructions\r\n", l->put - put);
+
+   for(i = put; i < l->put; i++)                                  // Tidy the now-unused tail.
+      { toNOP(&l->buf[i]); l->buf[i].opcode = OpCode_Null; }
+   l->put = put;
+   return TRUE;
+}
+
+/* ---------------------------------- markIdleCounts -----------------------------------
+
+   A thread's repeat count is read only by a counted 'Split'. It's carried along a CharBox,
+   Jmp or uncounted Split's left fork, and started afresh by an uncounted Split's right fork
+   and by a Span. So from some instructions no counted 'Split' can be reached with the count
+   a thread has there; mark those 'idleCount'. The run-time may then treat threads there which
+   differ only in their counts as the same thread (see threadsEquivalent()).
+*/
+PRIVATE BOOL countRead(S_InstrList const *l, T_InstrIdx i)
+   { return i < l->put && !l->buf[i].idleCount; }
+
+PRIVATE void markIdleCounts(S_InstrList *l)
+{
+   T_InstrIdx i;
+   BOOL changed;
+
+   for(i = 0; i < l->put; i++)                                    // Start with every count idle...
+      { l->buf[i].idleCount = TRUE; }
+
+   do {                                                           // ...and un-mark those which may be read, until no change.
+      changed = FALSE;
+      for(i = 0; i < l->put; i++)
+      {
+         S_Instr const *ins = &l->buf[i];
+         BOOL read;
+
+         switch(ins->opcode)
+         {
+            case OpCode_NOP:
+            case OpCode_CharBox:    read = countRead(l, i+1);                                  break;
+            case OpCode_Jmp:        read = countRead(l, ins->left);                            break;
+            case OpCode_Split:      read = ins->repeats.cntsValid || countRead(l, ins->left);  break;
+            default:                read = FALSE;                                              break;  // Span, Match.
+         }
+         if(read && l->buf[i].idleCount)
+            { l->buf[i].idleCount = FALSE; changed = TRUE; }
+      }
+   } while(changed);
+}
+
+/* ---------------------------------- leadsTo -----------------------------------
+
+   Return TRUE if a path from 'l->buf[i]' comes to 'to'; by the program's jumps alone, as
+   reachesMatch() in regexlt_analyze.c. 'seen' marks the instructions tried already.
+*/
+PRIVATE BOOL leadsTo(S_InstrList const *l, T_InstrIdx i, T_InstrIdx to, U8 *seen)
+{
+   if(i >= l->put || (seen[i/8] & (1 << (i%8))) != 0)
+      { return FALSE; }
+   if(i == to)
+      { return TRUE; }
+   seen[i/8] |= 1 << (i%8);
+
+   S_Instr const *ins = &l->buf[i];
+   switch(ins->opcode)
+   {
+      case OpCode_Match:   return FALSE;
+      case OpCode_Jmp:
+      case OpCode_Span:    return leadsTo(l, ins->left, to, seen);
+      case OpCode_Split:   return leadsTo(l, ins->left, to, seen) || leadsTo(l, ins->right, to, seen);
+      default:             return leadsTo(l, i+1, to, seen);    // NOP, CharBox.
+   }
+}
+
+// Return TRUE if 'l->buf[i]' is on a loop; a path from it comes back to it.
+PRIVATE BOOL onLoop(S_InstrList const *l, T_InstrIdx i)
+{
+   U8 seen[(MAX_U8+1)/8] = {0};
+   S_Instr const *ins = &l->buf[i];
+
+   switch(ins->opcode)
+   {
+      case OpCode_Jmp:
+      case OpCode_Span:    return leadsTo(l, ins->left, i, seen);
+      case OpCode_Split:   return leadsTo(l, ins->left, i, seen) || leadsTo(l, ins->right, i, seen);
+      case OpCode_Match:   return FALSE;
+      default:             return leadsTo(l, i+1, i, seen);
+   }
+}
+
+/* ---------------------------------- threadPlaces -----------------------------------
+
+   A thread moves on a CharBox or a Span each cycle. If each of those reads just one char then
+   the threads in a list are all at the same place in the input, in step with the thread eating
+   leading mismatches. But a wider CharBox, or a Span, takes a thread further in one cycle, and
+   a CharBox holding just anchors takes it nowhere. Return the most places the threads in a list
+   can be at; or 0 if that's bounded only by the input.
+
+   A CharBox or Span which is on a loop could put a thread out of step again and again; so then
+   it's the input. Otherwise each adds as many places as it can put a thread ahead, or behind.
+   But a Span with no most, or one which eats leading mismatches, may jump a thread any distance.
+   In a loop that's bounded only by the input, as above. Otherwise it's 1 place more; for the
+   thread eating mismatches, which the jump leaves one ahead of the threads it started. Should
+   a list fill anyway, the run says so (see addThread()).
+*/
+PRIVATE U16 threadPlaces(S_InstrList const *l)
+{
+   T_InstrIdx i;
+   U32 n = 1;
+   U16 boxes = 0;                                                 // CharBoxes and Spans.
+   BOOL jumps = FALSE, loops = FALSE;
+
+   for(i = 0; i < l->put; i++)
+   {
+      S_Instr const *ins = &l->buf[i];
+      U16 d = 0;                                                  // Places this can put a thread out of step...
+      BOOL jump = FALSE;                                          // ...or any number.
+
+      switch(ins->opcode)
+      {
+         case OpCode_CharBox:
+         {
+            U16 w = regexlt_boxChars(&ins->charBox);
+            d = w == 0 ? 1 : w - 1;
+            boxes++;
+            break;
+         }
+         case OpCode_Span:
+            if(ins->charBox.eatUntilMatch || ins->repeats.max == _Repeats_Unlimited)
+               { jump = jumps = TRUE; }
+            else if(ins->repeats.max > 1)
+               { d = ins->repeats.max - 1; }
+            boxes++;
+            break;
+
+         case OpCode_Jmp:
+         case OpCode_Split:
+            loops = loops || onLoop(l, i);
+            break;
+
+         default:
+            break;
+      }
+      if((d > 0 || jump == TRUE) && onLoop(l, i))                // Could put a thread out of step again and again?
+         { return 0; }                                            // then it's bounded only by the input.
+      n += d;
+   }
+
+   if(jumps == TRUE)
+   {
+      if(loops == TRUE)                                           // A thread may live as long as the input?
+         { return 0; }
+      n += 1;
+   }
+   return n > MAX_U16 ? 0 : (U16)n;
+}
+
+/* ---------------------------------- boundThreads -----------------------------------
+
+   The run-time keeps no two equivalent threads in a list (see addThread()). Threads at the
+   same instruction and place in the input differ only in whether they are still eating leading
+   mismatches and, where it's not idle, in their repeat count. So an instruction holds at most 2
+   threads at each place, or 2 for each count it may see; plus 1 for the thread which starts the
+   run. The run-time multiplies this by the places its threads may be at (see threadPlaces() and
+   regexlt_threadsNeeded()).
+
+   A counted loop makes a thread for each count, up to its 'max'. But threads on the same loop
+   are folded into ranges of counts (see countsMergeable()), so no more than '_CountStates' are
+   allowed for. Should a list fill anyway, the run says so (see runOnce()).
+*/
+#define _CountStates 8
+
+PRIVATE U16 boundThreads(S_InstrList const *l)
+{
+   T_InstrIdx i;
+   T_RepeatCnt maxCnt = 0;
+   U16 n = 0;
+
+   for(i = 0; i < l->put; i++)                                    // The most counts any counted 'Split' allows.
+   {
+      S_Instr const *ins = &l->buf[i];
+      if(ins->opcode == OpCode_Split && ins->repeats.cntsValid && ins->repeats.max > maxCnt)
+         { maxCnt = ins->repeats.max; }
+   }
+   if(maxCnt > _CountStates)
+      { maxCnt = _CountStates; }
+
+   for(i = 0; i < l->put; i++)
+      { n += l->buf[i].idleCount ? 1 : maxCnt + 1; }
+
+   return 2 * n + 1;
+}
+
+/* ---------------------------------- startsAnchored -----------------------------------
+
+   Return TRUE if every path from 'l->buf[i]' meets a '^' before it reads a char; i.e each
+   'Char-Box' reached through 'Split's and 'Jmp's leads with that anchor. 'hops' stops a
+   path which loops without reading; that's taken as not anchored.
+*/
+PRIVATE BOOL startsAnchored(S_InstrList const *l, T_InstrIdx i, T_InstrIdx hops)
+{
+   S_Instr const *ins = &l->buf[i];
+
+   if(hops > l->put)
+      { return FALSE; }
+
+   switch(ins->opcode)
+   {
+      case OpCode_NOP:     return startsAnchored(l, i+1, hops+1);
+      case OpCode_Jmp:     return startsAnchored(l, ins->left, hops+1);
+      case OpCode_Split:   return startsAnchored(l, ins->left, hops+1) && startsAnchored(l, ins->right, hops+1);
+      case OpCode_CharBox: return ins->charBox.segs[0].opcode == OpCode_Anchor && ins->charBox.segs[0].payload.anchor.ch == '^';
+      default:             return FALSE;                    // Span, Match.
+   }
+}
+
+/* ------------------------------- regexlt_optimizeProgram ----------------------------------
+
+   Run the passes over 'prog', which regexlt_compileRegex() just made, until none makes a
+   change. The instruction count before is kept in 'prog->unoptimized'. Then mark the idle
+   counts, bound the thread lists and note if the program is anchored at the start. Then find
+   what a match must hold, how long it can be and how it starts and ends, and choose the engine
+   to run it; see regexlt_analyzeProgram().
+*/
+PUBLIC void regexlt_optimizeProgram(S_Program *prog)
+{
+   S_InstrList *l = &prog->instrs;
+   BOOL changed;
+
+   prog->unoptimized = l->put;
+
+   do {
+      changed = threadJumps(l);
+      changed = splitsToJmps(l) || changed;
+      changed = concatCharBoxes(l) || changed;
+      changed = compact(l) || changed;
+   } while(changed);
+
+   markIdleCounts(l);
+   l->maxThreads = boundThreads(l);
+   l->threadPlaces = threadPlaces(l);
+   l->anchoredStart = l->put > 0 && startsAnchored(l, 0, 0);
+   regexlt_analyzeProgram(l);
+}
+
+// ---------------------------------------------- eof --------------------------------------------------
@@ -0,0 +1,177 @@
+/* ------------------------------------------------------------------------------
+|
+| Non-backtracking Lite Regex - A static pool, to use instead of the heap.
+|
+| For targets which may not use the heap once running. Give the pool a buffer with
+| RegexLT_PoolInit(), then supply RegexLT_PoolGetMem() and RegexLT_PoolFree() to
+| RegexLT_Init().
+|
+| Blocks are carved from the buffer, bottom up. A block freed from the top goes back to the
+| buffer. Others are kept by size, for reuse; a match gets and frees blocks of the same few
+| sizes, e.g the thread lists and capture sets of each run. So a match needs no more of the
+| pool than it has live at once, whatever the length of the input.
+|
+| RegexLT_PoolMark(), after compiling, and RegexLT_PoolReset(), after each match, give back
+| everything since the mark in one go.
+|
+|  Public:
+|     RegexLT_PoolInit()
+|     RegexLT_PoolGetMem()
+|     RegexLT_PoolFree()
+|     RegexLT_PoolMark()
+|     RegexLT_PoolReset()
+|     RegexLT_PoolHighWater()
+|
+--------------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libs_support.h"
+#include "regexlt_private.h"
+
+/* Each block has a tag ahead of it saying how big it is. Blocks, and so tags, are rounded to
+   _PoolAlign, enough for anything RegexLT_ puts in them. A freed block holds the link to the
+   next free block of its size, so it's at least a pointer long.
+*/
+#define _PoolAlign   sizeof(void*)
+#define _PoolTag     _PoolAlign
+#define _PoolBins    8                    // Kinds of block which are kept for reuse.
+
+typedef struct { size_t numBytes; U8 *head; } S_Bin;    // Free blocks of 'numBytes', linked from 'head'.
+
+PRIVATE struct {
+   U8       *buf, *end,                   // The pool is here.
+            *top,                         // Next block goes here.
+            *mark;                        // RegexLT_PoolReset() goes back to here.
+   size_t   highWater;                    // Most of 'buf' ever used.
+   S_Bin    bins[_PoolBins];
+} pool = {0};
+
+PRIVATE size_t roundUp(size_t n)
+   { return (n + _PoolAlign - 1) / _PoolAlign * _PoolAlign; }
+
+PRIVATE size_t * tagOf(void *p)
+   { return (size_t*)((U8*)p - _PoolTag); }
+
+PRIVATE void emptyBins(void)
+   { memset(pool.bins, 0, sizeof(pool.bins)); }
+
+/* ----------------------------- RegexLT_PoolInit --------------------------------------
+
+   Use 'size' bytes at 'buf' as the pool, empty. Return FALSE if there's not enough to be
+   of any use; then there's no pool.
+*/
+PUBLIC BOOL RegexLT_PoolInit(void *buf, size_t size)
+{
+   U8 *start = (U8*)roundUp((size_t)buf);                            // Align the 1st block.
+
+   if(buf == NULL || size < (size_t)(start - (U8*)buf) + _PoolTag + _PoolAlign)
+      { pool.buf = NULL; return FALSE; }
+
+   pool.buf = pool.top = pool.mark = start;
+   pool.end = (U8*)buf + size;
+   pool.highWater = 0;
+   emptyBins();
+   return TRUE;
+}
+
+/* ----------------------------- RegexLT_PoolGetMem --------------------------------------
+
+   For RegexLT_S_Cfg.getMem. Return 'numBytes', zeroed, from the pool; a kept block of the
+   same size if there's one, else from the top. NULL if the pool is full.
+*/
+PUBLIC void * RegexLT_PoolGetMem(size_t numBytes)
+{
+   size_t n = roundUp(numBytes < _PoolAlign ? _PoolAlign : numBytes);
+   U8 *p;
+   U8 c;
+
+   if(pool.buf == NULL)                                              // No RegexLT_PoolInit()?
+      { return NULL; }
+
+   for(c = 0; c < _PoolBins; c++) {                                  // Kept a block this size?
+      if(pool.bins[c].numBytes == n && pool.bins[c].head != NULL) {
+         p = pool.bins[c].head;                                      // then take it...
+         pool.bins[c].head = *(U8**)p;                               // ...off its list.
+         return memset(p, 0, n); }}
+
+   if( (size_t)(pool.end - pool.top) < _PoolTag + n)                 // else no room at the top?
+      { return NULL; }
+
+   p = pool.top + _PoolTag;                                          // else carve a new block.
+   *tagOf(p) = n;
+   pool.top = p + n;
+
+   if( (size_t)(pool.top - pool.buf) > pool.highWater)
+      { pool.highWater = pool.top - pool.buf; }
+   return memset(p, 0, n);
+}
+
+/* ----------------------------- RegexLT_PoolFree --------------------------------------
+
+   For RegexLT_S_Cfg.free. If 'p' is the top block it goes back to the pool. Otherwise it's
+   kept for the next RegexLT_PoolGetMem() of its size. If there's no room to keep it, it's
+   not used again until RegexLT_PoolReset().
+*/
+PUBLIC void RegexLT_PoolFree(void *p)
+{
+   if(p == NULL || pool.buf == NULL)
+      { return; }
+
+   size_t n = *tagOf(p);
+
+   if((U8*)p + n == pool.top)                                        // Top block?
+   {
+      pool.top = (U8*)tagOf(p);                                      // then give it straight back.
+      return;
+   }
+
+   S_Bin *spare = NULL;
+   U8 c;
+
+   for(c = 0; c < _PoolBins; c++)
+   {
+      S_Bin *b = &pool.bins[c];
+
+      if(b->numBytes == n)                                           // Already keep this size?
+      {
+         *(U8**)p = b->head;                                         // then add 'p' to those.
+         b->head = p;
+         return;
+      }
+      else if(b->head == NULL && spare == NULL)                      // else note the 1st bin which is free...
+         { spare = b; }
+   }
+
+   if(spare != NULL)                                                 // ...and keep this size there.
+   {
+      spare->numBytes = n;
+      *(U8**)p = NULL;
+      spare->head = p;
+   }
+}
+
+/* ----------------------------- RegexLT_PoolMark / Reset --------------------------------------
+
+   RegexLT_PoolMark() after compiling; RegexLT_PoolReset() after each match, once the match
+   list is freed. The reset gives back, at once, all got since the mark, keeping the program(s)
+   below it.
+*/
+PUBLIC void RegexLT_PoolMark(void)
+   { pool.mark = pool.top; }
+
+PUBLIC void RegexLT_PoolReset(void)
+{
+   pool.top = pool.mark;
+   emptyBins();                           // Kept blocks may be above the mark; so forget all.
+}
+
+/* ----------------------------- RegexLT_PoolHighWater --------------------------------------
+
+   Most of the pool ever used, since RegexLT_PoolInit(); including tags and rounding.
+*/
+PUBLIC size_t RegexLT_PoolHighWater(void)
+   { return pool.highWater; }
+
+// --------------------------------------------- eof -----------------------------------------------
@@ -44,7 +44,7 @@ PRIVATE BOOL isClassSpecifier(C8 ch)
    error in the regex, else E_Continue, meaning continue counting.
 */
 
-typedef enum {E_ContinuePrescan = 0, E_PrescanOK, E_EndsOnOpen, E_NestedClass, E_MissingOpenClass } T_RegexParts_Rtn;
+typedef enum {E_ContinuePrescan = 0, E_PrescanOK, E_EndsOnOpen, E_NestedClass, E_MissingOpenClass, E_BadGroup } T_RegexParts_Rtn;
 
 PRIVATE T_RegexParts_Rtn countRegexParts(S_CntRegexParts *ctx, C8 ch)
 {
@@ -84,6 +84,7 @@ PRIVATE T_RegexParts_Rtn countRegexParts(S_CntRegexParts *ctx, C8 ch)
       {
          ctx->inClass = TRUE;                   // we are now in-class.
          ctx->charSeg = FALSE;                  // and likely leaving a char-segment.
+         ctx->charSegs++;                       // A class starts a CharBox; the one before it, if any, needs a slot for its terminator.
       }
       else if(ch == '\\' && !ctx->inClass)     // Escape AND outside a char-class?
       {
@@ -115,6 +116,10 @@ PRIVATE T_RegexParts_Rtn countRegexParts(S_CntRegexParts *ctx, C8 ch)
          }
          else if(ch == '(')                     // Opens a subgroup?
          {
+            ctx->charSeg = FALSE;               // If we were in a char segment we have left it now.
+            ctx->charSegs++;                    // The CharBox before the '(', even an empty one, needs a slot for its terminator.
+            ctx->leftCnt = 0;                   // Closed out a segment, so reset the count of free-left chars
+
             if(ctx->inGroup == TRUE)            // But we are already in a subgroup?
             {
                return FALSE;                    // ... which is illegal. Fail.
@@ -122,17 +127,14 @@ PRIVATE T_RegexParts_Rtn countRegexParts(S_CntRegexParts *ctx, C8 ch)
             else
             {
                ctx->inGroup = TRUE;             // else mark
-
-               if(ctx->charSeg)                 // Opened this group inside a char segment? ...we have left that segment now
-               {
-                  ctx->charSeg = FALSE;         // then we have left it now...
-                  ctx->charSegs++;                // and we have one more chars segment.
-                  ctx->leftCnt = 0;             // Closed out a segment, so reset the count of free-left chars
-               }
             }
          }
          else if(ch == ')')                     // Closes a subgroup?
          {
+            ctx->charSeg = FALSE;               // If we were in a char segment we have left it now...
+            ctx->charSegs++;                    // ...and the CharBox which closes the group needs a slot for its terminator.
+            ctx->leftCnt = 0;
+
             if(ctx->inGroup == FALSE)           // But we weren't in a subgroup.
             {
                return FALSE;                    // ... again illegal. Fail
@@ -141,7 +143,11 @@ PRIVATE T_RegexParts_Rtn countRegexParts(S_CntRegexParts *ctx, C8 ch)
             {
                ctx->inGroup = FALSE;            // else mark that we are out of the group.
                ctx->uneatenSubGrp = TRUE;       // and that there's to be consumed by an operator.
-               ctx->subExprs++;                 // A completed subgroup is an additional sub expression.
+
+               if(ctx->noCapture)               // Was '(?:...)' or '(?>...)'?
+                  { ctx->noCapture = FALSE; }   // then it captures nothing.
+               else
+                  { ctx->subExprs++; }          // else a completed subgroup is an additional sub expression.
             }
          }
          else                                   // else some other char.
@@ -206,6 +212,7 @@ PRIVATE C8 const *prescanErrName(T_RegexParts_Rtn err)
       case E_EndsOnOpen:         return "Ends on open";
       case E_NestedClass:        return "Nested Class";
       case E_MissingOpenClass:   return "Missing Class open";
+      case E_BadGroup:           return "Unknown group";
       default:                   return "";
    }
 }
@@ -229,7 +236,7 @@ PUBLIC S_RegexStats regexlt_prescan(C8 const *regex)
    T_RegexParts_Rtn rtn;
 
    S_CntRegexParts ctx = {
-      .inClass = FALSE, .inRange = FALSE, .charSeg = FALSE, .esc = FALSE,
+      .inClass = FALSE, .inRange = FALSE, .charSeg = FALSE, .esc = FALSE, .noCapture = FALSE,
       .classCnt = 0, .charSegs = 0, .leftCnt = 0, .escCnt = 0, .repeats = 0,
       .subExprs = 1 };                                            // There's always at least one sub-expression, which is the whole regex.
 
@@ -237,6 +244,8 @@ PUBLIC S_RegexStats regexlt_prescan(C8 const *regex)
 
    for(c = 0, p = regex; c < regexlt_cfg->maxRegexLen; c++, p++)  // Until the end of the regex...
    {
+      BOOL opens = ctx.inGroup == FALSE;                          // If this char is '(' it will open a group.
+
       if( (rtn = countRegexParts(&ctx, *p)) == E_PrescanOK)       // Reached '\0' AND no errors?
       {
          s.legal = TRUE;                                          // then regex is (probably) legal
@@ -255,6 +264,16 @@ PUBLIC S_RegexStats regexlt_prescan(C8 const *regex)
       else if( rtn != E_ContinuePrescan)                          // else there's some error
       {
          break;                                                   // so break with tagging regex as legal.
+      }
+      else if(opens && ctx.inGroup && p[1] == '?')                // else just opened a group with '(?'?
+      {
+         if(p[2] != ':' && p[2] != '>')                           // but not '(?:' or '(?>'?
+         {
+            rtn = E_BadGroup;                                     // then we don't know it.
+            break;
+         }
+         ctx.noCapture = TRUE;                                    // else it's a group which captures nothing...
+         p += 2; c += 2;                                          // ...and the '?:' or '?>' is not regex chars.
       }                    // else continue, examine next char(s)
    }
 
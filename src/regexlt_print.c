@@ -50,6 +50,7 @@ PUBLIC C8 const *opcodeNames(T_OpCode op)
       case OpCode_CharBox: return "CBox ";
       case OpCode_Jmp:     return "Jmp  ";
       case OpCode_Split:   return "Split";
+      case OpCode_Span:    return "Span ";
 
       // Chars-Box (CBox) contents.
       case OpCode_Chars:   return "Chars";
@@ -112,6 +113,9 @@ PRIVATE void printAnyRepeats(S_RepeatSpec const *rpts)
          dbgPrint(" {*}"); }
       else {
          dbgPrint(" {_}"); }
+
+      if(rpts->possessive == TRUE) {                                 // e.g 'a*+'
+         dbgPrint("+"); }
    }
 }
 
@@ -324,7 +328,7 @@ PUBLIC void regexlt_printProgram(S_Program *prog)
    S_Instr *instr = prog->instrs.buf;
    S_RepeatSpec const *rpts;
 
-   dbgPrint("------ Compiled Regex:\r\n");
+   dbgPrint("------ Compiled Regex: %d instructions (%d before optimizing)\r\n", prog->instrs.put, prog->unoptimized);
 
    // Limit the number of lines in case compile produced an unterminated program.
    #define _MaxProgLines 40
@@ -362,10 +366,19 @@ PUBLIC void regexlt_printProgram(S_Program *prog)
                ref now to use later with the 'case OpCode_CharBox:'.
             */
             rpts = &instr->repeats;
+            break;
+
+         case OpCode_Span:                                           // Span?
+            dbgPrint("(%d) ", instr->left);                          // then show where it goes after the run...
+            printCharsBox(&instr->charBox, &instr->repeats);         // ...and the char or class it runs over, with the repeats.
+            break;
       }
-      if(instr->opcode != OpCode_CharBox) { dbgPrint("\r\n"); }
+      if(instr->opcode != OpCode_CharBox && instr->opcode != OpCode_Span) { dbgPrint("\r\n"); }
    }
-   dbgPrint("\r\n");
+   dbgPrint("Runs on: %s\r\n\r\n",
+      prog->instrs.engine == E_Engine_Literal
+         ? "literal search"
+         : (prog->instrs.engine == E_Engine_ShiftAnd ? "shift-and" : "thread VM"));
 }
 
 /* --------------------------------- RegexLT_PrintMatchList ------------------------------ */
@@ -376,6 +389,9 @@ PRIVATE void printOneMatch(RegexLT_S_Match const *m)
    C8 buf[_MaxChars+1];
    U8 len;
 
+   if(m->at == NULL)                               // Group took no part in the match?
+      { printf(" [- -]"); return; }
+
    memcpy(buf, m->at, len = MinU8(m->len, _MaxChars));
    buf[len] = '\0';
    printf(" [%d %d] \'%s\'", m->idx, m->len, buf);
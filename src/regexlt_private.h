@@ -13,6 +13,7 @@
 #include "libs_support.h"
 #include "arith.h"
 #include "util.h"
+#include "regexlt.h"
 
 #ifndef REGEXLT_PRIVATE_H
 #define REGEXLT_PRIVATE_H
@@ -32,6 +33,7 @@ typedef struct {
          charSeg,    // In a character-segment e.g '...cdef...'
          inGroup,    // Inside '(....  )'
          uneatenSubGrp,// A preceding group has not yet been consumed by an operator.
+         noCapture,  // This group is '(?:...)' or '(?>...)'; so it's not a sub-expression.
          esc;        // Preceding char was '\'
 
    U8    classCnt,      // Numbers of character class definitions so far
@@ -71,14 +73,19 @@ PUBLIC BOOL       regexlt_classParser_AddDef(S_ParseCharClass *p, S_C8bag *cc, C
 PUBLIC T_ParseRtn regexlt_classParser_AddCh(S_ParseCharClass *p, S_C8bag *cc, C8 const *src);
 PUBLIC C8 const * regexlt_getCharClassByKey(C8 key);
 
-typedef U8 T_RepeatCnt;    // Regex repeat counts e.g [Ha ]{3} = 'Ha Ha Ha '
-#define _Repeats_Unlimited MAX_U8   // If the max repeats was left open, i.e '{3,}
-#define _MaxRepeats (_Repeats_Unlimited - 1)
+typedef U16 T_RepeatCnt;   // Regex repeat counts e.g [Ha ]{3} = 'Ha Ha Ha '
+#define _Repeats_Unlimited MAX_U16  // If the max repeats was left open, i.e '{3,}
+
+/* Largest count allowed in e.g {n,m}. A count of 65535 runs as 'unlimited'. Because an
+   input string can be no longer than MAX_U16 there's no input which could tell the two apart.
+*/
+#define _MaxRepeats _Repeats_Unlimited
 
 typedef struct {
    T_RepeatCnt min, max;      // min and max repeats
    BOOL        cntsValid,     // If TRUE then 'min' and 'max' are valid.
-               always;        // If TRUE, then upper limit only i.e '*' or '+'.
+               always,        // If TRUE, then upper limit only i.e '*' or '+'.
+               possessive;    // e.g 'a*+'. Once the loop can take another char it must; never gives any back.
    } S_RepeatSpec;            // Only one of 'cntsValid' and 'always' may be TRUE;
 
 PUBLIC T_ParseRtn regexlt_parseRepeat(S_RepeatSpec *r, C8 const **ch);
@@ -110,6 +117,7 @@ enum eOpCode {
    OpCode_Anchor,             // '^','$'.
    OpCode_Jmp,                // Jump relative
    OpCode_Split,              // Split into 2 simultaneous threads of execution.
+   OpCode_Span,               // Eat a run of a single char or class e.g '\d+' then go to 'left'. Replaces a simple 'Split' loop.
    OpCode_Match,
    OpCode_EndCBox = OpCode_Match // Terminates both character box list and compiled regex instructions list.
    };
@@ -144,7 +152,8 @@ typedef struct {                    // A box of one or more character segments o
                put,                 // when filling 'segs'.
                numSegs;             // Number of chars-segments in 'buf'
    BOOL        opensGroup,
-               closesGroup;
+               closesGroup,
+               closesPastRpt;       // The ')' which closes the group comes after this box's repeat e.g '(ab+)', not before e.g '(ab)+'.
    BOOL        eatUntilMatch;       // Eat source string until 1st match with chars or class in 'buf'[0].
 } S_CharsBox;
 
@@ -155,6 +164,9 @@ typedef struct {                    // A (compiled) instruction. Contains:
    S_RepeatSpec   repeats;          // Match zero of more repeats of 'charBox'
    BOOL           opensGroup,       //  This instruction opens of closes a group.
                   closesGroup;
+   U8             group;            // If 'closesGroup', the capture slot, 1.., of the group it closes; 0 if none.
+   BOOL           rptInGroup;       // Opens and closes a group, which holds it's repeat e.g '([ab]+)'; so a loop on it goes on with the capture, rather than start it anew.
+   BOOL           idleCount;        // No counted 'Split' can read the repeat count of a thread here. Set by regexlt_optimizeProgram().
 } S_Instr;
 
 typedef struct {                    // List of character-segments and char-classes from the match string...
@@ -163,11 +175,44 @@ typedef struct {                    // List of character-segments and char-class
                put;                 // 'put' to add another segment / number of S_Instr in 'buf'.
 } S_CharsList;
 
+#define _MaxRequired _RegexLT_MaxRequired   // Most literals S_InstrList.required[] holds.
+
+typedef enum {                      // How regexlt_runCompiledRegex() runs a program. Chosen by regexlt_analyzeProgram().
+   E_Engine_NFA = 0,                // The thread VM, runOnce(); runs anything.
+   E_Engine_ShiftAnd,               // Bit-parallel; a short fixed run of chars and classes, when no groups are wanted.
+   E_Engine_Literal                 // Substring search; a plain string, when no groups are wanted.
+} T_Engine;
+
+#define _ShiftAnd_MaxLen      32    // Longest match shift-and can run; a bit for each char, in a U32.
+#define _ShiftAnd_Chars       0x80  // S_InstrList.masks[] for each char below this, and one for all others.
+#define _ShiftAnd_MaskBytes   ((_ShiftAnd_Chars + 1) * sizeof(U32))
+#define _Literal_SkipBytes    (MAX_U8 + 1)   // S_InstrList.skips[], a shift for each char.
+#define _MatchLen_Unbounded MAX_U16   // S_InstrList.maxLen, if there's no most.
+#define _MaxThreadList  ((MAX_U16 - 2) / 2)   // Longest thread list; so the capture sets for 2 such lists are counted in a U16.
+
 typedef struct {                    // List of instructions...
    S_Instr     *buf;                // ...which are here.
    T_InstrIdx  size,                // Size of S_Instr malloced() based on pre-scan.
                put;                 // 'put' to add another one / number of S_Instr in 'buf'.
    U16         maxRunCnt;           // Max iterations of the threads-list. Usually a bit longer than the input string.
+   U16         maxThreads,          // Most threads a thread-list can hold at once, at one place in the input...
+               threadPlaces;        // ...and the most places it's threads can be at; 0 if any. Set by regexlt_optimizeProgram().
+   U8          groups;              // Capture groups, numbered 1.. in the order of their '('. So a match has 'groups'+1 slots.
+   BOOL        anchoredStart;       // Every path starts with '^'; so a match is tried at the start only. Set by regexlt_optimizeProgram().
+   BOOL        alternates;          // Has a '|' and a repeat e.g '.?c*|c{1,4}.c'. Its 'Split's may then jump into a loop part way; so the
+                                    // analysis can't tell what a match holds. Set by regexlt_compileRegex().
+   S_Literals  required[_MaxRequired];    // Literals any match must hold e.g the '@' in '\w+@\w+'...
+   U8          numRequired;               // ...this many of them. Set by regexlt_analyzeProgram().
+   U16         minLen,              // Fewest chars a match can have...
+               maxLen;              // ...and most, or '_MatchLen_Unbounded'. Set by regexlt_analyzeProgram().
+   BOOL        anchoredEnd;         // Every match ends with '$'. Set by regexlt_analyzeProgram().
+   S_Literals  prefix,              // Literals every match starts with...
+               suffix;              // ...and ends with; 'len' 0 if none. Set by regexlt_analyzeProgram().
+   S_C8bag     firstChars;          // Chars a match may start with...
+   BOOL        firstAny;            // ...unless it may start with any, or none. Set by regexlt_analyzeProgram().
+   T_Engine    engine;              // Runs on this...
+   U32         *masks;              // ...which, if 'E_Engine_ShiftAnd', has these...
+   U8          *skips;              // ...or if 'E_Engine_Literal', these. Set by regexlt_analyzeProgram().
 } S_InstrList;
 
 // A compiled regex is...
@@ -176,18 +221,35 @@ typedef struct {
    S_CharsList    chSegs;           // One or more lists of chars and char classes, each attached to a 'Char' instruction, terminated by 'Match'.
    S_ClassesList  classes;          // Zero or more character classes, each a part or all of a S_CharsList
    U16            subExprs;         // 1 + number of possible sub-matches, Used to size the match-list.
+   T_InstrIdx     unoptimized;      // Instructions as compiled, before regexlt_optimizeProgram(). 'instrs.put' is after.
+   C8             *simplified;      // If regexlt_simplifyRegex() rewrote the regex, the rewrite; 'chSegs' literals point into it. Else NULL.
 } S_Program;
 
+PUBLIC C8 * regexlt_simplifyRegex(C8 const *regex);
+
+typedef struct { size_t working, kept; } S_SimplifyMem;
+PUBLIC S_SimplifyMem regexlt_simplifyMem(C8 const *regex);
 PUBLIC BOOL regexlt_compileRegex(S_Program *prog, C8 const *regexStr);
+PUBLIC void regexlt_optimizeProgram(S_Program *prog);
+PUBLIC void regexlt_analyzeProgram(S_InstrList *l);
+PUBLIC U16 regexlt_boxChars(S_CharsBox const *cb);
+PUBLIC U16 regexlt_dfaStates(S_InstrList const *l, BOOL *friendly);
 PUBLIC void regexlt_printProgram(S_Program *prog);
 
-typedef struct { void **mem; size_t numBytes; } S_TryMalloc;
+typedef struct { void **mem; size_t numBytes; RegexLT_T_MemFor purpose; } S_TryMalloc;
 
+PUBLIC void * regexlt_getMem(size_t numBytes, RegexLT_T_MemFor purpose);
 PUBLIC void regexlt_safeFree(void *p);
 PUBLIC void regexlt_safeFreeList(void **lst, U8 listSize);
 PUBLIC BOOL regexlt_getMemMultiple(S_TryMalloc *lst, U8 listSize);
 
-PUBLIC T_RegexRtn regexlt_runCompiledRegex(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList **ml, U8 maxMatches, RegexLT_T_Flags flags);
+extern RegexLT_S_Stats *regexlt_stats;    // If not NULL, the current match counts into here. See RegexLT_MatchProgStats().
+
+#define regexlt_countStat(field)  if(regexlt_stats != NULL) { regexlt_stats->field++; }
+
+PUBLIC T_RegexRtn regexlt_runCompiledRegex(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList **ml, RegexLT_T_Groups groups, RegexLT_T_Flags flags);
+PUBLIC U16 regexlt_threadsNeeded(S_InstrList const *prog, size_t inputLen);
+PUBLIC size_t regexlt_runMemRequired(U16 maxThreads, U8 maxMatches);
 
 extern RegexLT_S_Cfg const *regexlt_cfg;
 
@@ -14,6 +14,29 @@
 #include "arith.h"
 #include "regexlt_private.h"
 
+/* ------------------------------- readRepeatCnt -------------------------------------
+
+   Read a repeat count from 'p'. Skips a leading '{' or ',' and any whitespace before the
+   digits. Counts may be up to 65535, more than fits the S16 from ReadDirtyASCIIInt(); larger
+   numbers are clipped to MAX_U32 so they fail the range-check in regexlt_parseRepeat().
+
+   Return the char after the last digit, or NULL if there was no number.
+*/
+PRIVATE C8 const * readRepeatCnt(C8 const *p, U32 *n)
+{
+   U8 c;
+   for(c = 0; (*p == '{' || *p == ',' || isspace(*p)) && c < 10; c++, p++) {}   // Skip opening '{' or ',' and up to 10 whitespace.
+
+   if(!isdigit(*p))                                      // Not at a number?
+      { return NULL; }                                   // then fail.
+   else
+   {
+      for(*n = 0; isdigit(*p); p++)                      // Accumulate digits...
+         { *n = *n > MAX_U16 ? MAX_U32 : (*n * 10) + (*p - '0'); }   // ...but stop growing once beyond any legal count.
+      return p;
+   }
+}
+
 /* ----------------------------- regexlt_parseRepeat ----------------------------------
 
    Parses a regex repeat specifier from 'ch' into 'r'. 'ch' starts past the
@@ -24,9 +47,11 @@
         chars             min      max
         ------------------------------------
          {3}               3        3
-         {4,}              4        _MaxRepeats
+         {4,}              4        _Repeats_Unlimited
          {4,6}             4        6
 
+   Counts may be 0 - 65535 (_MaxRepeats).
+
    The parser ignores up to 10 whitespace i.e {7,10} == {7, 10} == { 7 , 10   }  etc
 
    Return E_Fail if can't parse OR if min > max; else returns E_Complete. If
@@ -38,15 +63,15 @@
 
 PUBLIC T_ParseRtn regexlt_parseRepeat(S_RepeatSpec *r, C8 const **ch)
 {
-   S16 n;
+   U32 n;
    U8 c;
    C8 const *p = *ch;
 
-   if( (p = (C8*)ReadDirtyASCIIInt((U8 const*)p, &n)) == NULL)    // Didn't snag 1st number?
+   if( (p = readRepeatCnt(p, &n)) == NULL)                        // Didn't snag 1st number?
       { goto Fail; }                                              // then we fail rightaway.
    else                                                           // else we got a number
    {
-      if( n < 0 || n > _MaxRepeats)                               // But number isn't legal? ( ReadDirtyASCIIInt() will parse e.g '-45')
+      if( n > _MaxRepeats)                                        // But number isn't legal?
          { goto Fail; }                                           // then fail
       else                                                        // else got a legal 1st number...
       {
@@ -64,9 +89,9 @@ PUBLIC T_ParseRtn regexlt_parseRepeat(S_RepeatSpec *r, C8 const **ch)
                r->min = n;                                        // then 1st number we got is 'min'
 
                // Got 1st number and ','. Look for 2nd number.
-               C8 *p1;
+               C8 const *p1;
 
-               if( (p1 = (C8*)ReadDirtyASCIIInt( (U8 const*)p, &n)) == NULL)   // No 2nd number?
+               if( (p1 = readRepeatCnt(p, &n)) == NULL)           // No 2nd number?
                {                                                  // so must close with '}'
                   for(c = 0, p++; c < 10; c++, p++)               // Starting beyond the ',', try up to 10 chars
                   {
@@ -81,7 +106,7 @@ PUBLIC T_ParseRtn regexlt_parseRepeat(S_RepeatSpec *r, C8 const **ch)
                {
                   p = p1;                                         //  Set current ptr to the provisional 'p1', now we know it's after the number we snagged.
 
-                  if( n < 0 || n > _MaxRepeats)                   // 2nd number not legal?
+                  if( n > _MaxRepeats)                            // 2nd number not legal?
                      { goto Fail;}
                   else                                            // else 2nd number is legal
                   {
@@ -113,11 +138,13 @@ Fail:
    r->min = 0; r->max = 0;             // ... so set them both to zero...
    r->cntsValid = FALSE;
    r->always = FALSE;                  // Not '*' or '+'
+   r->possessive = FALSE;
    return E_Fail;                      // ...and fail.
 
 Success:
    r->cntsValid = TRUE;
    r->always = FALSE;                  // Not '*' or '+'.
+   r->possessive = FALSE;              // Unless a '+' follows; the compiler sees to that.
    *ch = p+1;                          // We succeeded so 'p' is at closing '}'. Advance source ptr to one-past that.
    return E_Complete;
 }
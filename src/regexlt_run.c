@@ -25,6 +25,8 @@
 #define safeFree           regexlt_safeFree
 #define safeFreeList       regexlt_safeFreeList
 #define getMemMultiple     regexlt_getMemMultiple
+#define getMem             regexlt_getMem
+#define countStat          regexlt_countStat
 
 #define br regexlt_cfg
 
@@ -169,49 +171,191 @@ PRIVATE BOOL matchCharsList(S_CharSegs *chs, C8 const **in, C8 const *start, C8
 }
 
 
-/* ----------------------------- recordSubMatch ------------------------------ */
+/* ------------------------------------ spanRun ----------------------------------------
 
-PRIVATE void wrRecordAt(RegexLT_S_Match *m, C8 const *at, RegexLT_T_MatchLen idx, RegexLT_T_MatchLen len)
-   { m->at = at; m->idx = idx; m->len = len; }
-
-#define _IgnoreShorter  FALSE
-#define _ReplaceShorter TRUE
-
-PRIVATE BOOL recordSubMatch(RegexLT_S_MatchList *ml, C8 const *at, RegexLT_T_MatchLen idx, RegexLT_T_MatchLen len, BOOL replaceShorterSubmatch)
+   Return the number of chars from 'in' which match the single char, escape or class 'sg',
+   up to 'max'. Stops at '\0' or at 'end'.
+*/
+PRIVATE BOOL matchOneSeg(S_CharSegs const *sg, C8 ch, E_CaseRule cr)
 {
-   if(ml != NULL) {
+   switch(sg->opcode)
+   {
+      case OpCode_Chars:   return matchedRegexCh(sg->payload.literals.start[0], ch, cr);
+      case OpCode_EscCh:   return ch == sg->payload.esc.ch;
+      case OpCode_Class:   return C8bag_Contains(sg->payload.charClass, ch);
+      default:             return FALSE;
+   }
+}
 
-      if(replaceShorterSubmatch) {
-         U8 c;
-         for(c = 1; c < ml->put; c++) {                     // matches[0] is the global match. Do not replace that; start at [1].
-            if(ml->matches[c].idx == idx && ml->matches[c].len < len) {
-               wrRecordAt(&ml->matches[c], at, idx, len);
-               return TRUE; }}}
+PRIVATE U16 spanRun(S_CharSegs const *sg, C8 const *in, C8 const *end, T_RepeatCnt max, E_CaseRule cr)
+{
+   U16 n;
+   for(n = 0; n < max && in+n < end && in[n] != '\0' && matchOneSeg(sg, in[n], cr); n++) {}
+   return n;
+}
 
-      if(ml->put < ml->listSize) {
-         wrRecordAt(&ml->matches[ml->put], at, idx, len);
-         ml->put++;
-         return TRUE; }}
+/* ------------------------------- loopTakesMore --------------------------------------
 
-   return FALSE;
+   Return TRUE if the CharBox which the possessive 'Split' 'ip' loops on would match at 'in'.
+   Then the loop must take it; the Split's exit is a thread which can never win.
+*/
+PRIVATE BOOL loopTakesMore(S_InstrList *prog, S_Instr const *ip, C8 const *in, C8 const *start, C8 const *end, E_CaseRule cr)
+{
+   S_Instr *loop = &prog->buf[ip->left];
+   return loop->opcode == OpCode_CharBox && matchCharsList(loop->charBox.segs, &in, start, end, &cr);
 }
 
+
 typedef struct {
    RegexLT_T_MatchIdx start;     // 1st char of matched segment, relative to start of input string
    RegexLT_T_MatchLen len;       // This many bytes long.
 } S_Match;
 
+/* A thread's matches. ms[0] is the global match and ms[n] the capture for group 'n', as numbered
+   by the compiler (see S_Instr.group). Slots below 'put' which have no capture are 'noCapture'.
+*/
 typedef struct {
-   S_Match     *ms;              // To a buffer of matches.
+   S_Match     *ms;              // To a capture set; may be shared with other threads (see ownMatches()).
    U8          bufSize,          // Buffer is this long
-               put;              // Next free, from zero upwards.
-   T_InstrIdx  latestPC;         // Instruction counter at the most recent match.
-   BOOL        isOwner;          // This 'S_MatchList' malloced the ms[]; if FALSE then it is referencing ms[]...
-} S_MatchList;                   // ...which were malloced by another 'S_MatchList'.
+               put;              // Slots used, from zero upwards.
+} S_MatchList;
+
+#define _NoCapture MAX_U16
+PRIVATE S_Match const noCapture = {.start = _NoCapture, .len = 0};
 
-PRIVATE BOOL copyInMatch(RegexLT_S_MatchList *ml, S_Match const *m, C8 const *str)
+PRIVATE BOOL hasCapture(S_MatchList const *l, U8 slot)
+   { return slot < l->put && l->ms[slot].start != _NoCapture; }
+
+/* ---------------------------------- Capture mask -------------------------------------
+
+   The groups a match records (see RegexLT_MatchProgGroups()). Each recorded group gets a slot
+   in the threads' capture sets, packed in group order after the global match; the rest aren't
+   recorded at all. The caller's list is still by group number (see copySlotsToList()).
+*/
+typedef struct {
+   BOOL  all;                                // Record every group; then slot == group.
+   U8    slotOf[_RegexLT_MaskGroups+1];      // else the slot of each group; 0 if it's not recorded.
+} S_GroupSlots;
+
+PRIVATE S_GroupSlots grpSlots = {.all = TRUE};
+
+// Map the groups of 'prog' in 'mask' to capture slots. Return the slots a thread needs.
+PRIVATE U8 mapGroups(S_InstrList const *prog, RegexLT_T_Groups mask)
+{
+   if( (grpSlots.all = mask == _RegexLT_Groups_All) == TRUE)
+      { return prog->groups + 1; }
+
+   U8 g, slots = 1;                                          // Slot 0 is the global match.
+   grpSlots.slotOf[0] = 0;
+   for(g = 1; g <= _RegexLT_MaskGroups; g++)
+      { grpSlots.slotOf[g] = g <= prog->groups && (mask & _RegexLT_Group(g)) ? slots++ : 0; }
+   return slots;
+}
+
+// The slot which records 'group'; 0 if none.
+PRIVATE U8 slotOf(U8 group)
 {
-   return recordSubMatch(ml, str+m->start, m->start, m->len, _ReplaceShorter);
+   return grpSlots.all
+            ? group
+            : (group <= _RegexLT_MaskGroups ? grpSlots.slotOf[group] : 0);
+}
+
+/* ---------------------------------- Capture sets -------------------------------------
+
+   Each thread's matches are held in a capture set, from a slab which runOnce() gets once per
+   run. A thread which forks shares it's set with the new thread; most forks never record a
+   match, so most never need their own. A thread which would write to a set it shares first
+   takes a copy (ownMatches()). Sets are counted; the last thread to let go of one returns it
+   to the slab.
+
+   A thread holds at most one set. So a set for each thread in both lists, plus one for a
+   thread being made and one for a copy being made, is as many as a run can need.
+*/
+typedef struct {
+   S_Match  *ms;                 // 'num' sets of 'size' matches each.
+   U16      *refs,               // Threads sharing each set.
+            *free,               // Stack of the unused sets...
+            freePut,             // ...this many.
+            num;
+   U8       size;
+} S_CaptureSlab;
+
+PRIVATE S_CaptureSlab caps = {0};   // For the current runOnce().
+
+PRIVATE U16 capsNeeded(U16 maxThreads)
+   { return 2 * maxThreads + 2; }
+
+PRIVATE size_t capsBytes(U16 num, U8 size)
+   { return (size_t)num * (size * sizeof(S_Match) + 2 * sizeof(U16)); }
+
+PRIVATE BOOL capsInit(U16 num, U8 size)
+{
+   caps = (S_CaptureSlab){.num = num, .size = size, .freePut = num};
+
+   S_TryMalloc toMalloc[] = {
+      { (void**)&caps.ms,   (size_t)num * size * sizeof(S_Match), E_RegexMem_ThreadMatches },
+      { (void**)&caps.refs, (size_t)num * sizeof(U16),            E_RegexMem_ThreadMatches },
+      { (void**)&caps.free, (size_t)num * sizeof(U16),            E_RegexMem_ThreadMatches }};
+
+   if(getMemMultiple(toMalloc, RECORDS_IN(toMalloc)) == FALSE)
+      { caps = (S_CaptureSlab){0}; return FALSE; }
+
+   for(U16 c = 0; c < num; c++)
+      { caps.free[c] = num - 1 - c; }     // Hand out from the bottom of the slab.
+   return TRUE;
+}
+
+PRIVATE void capsUnInit(void)
+{
+   void *toFree[] = { caps.ms, caps.refs, caps.free };
+   safeFreeList(toFree, RECORDS_IN(toFree));
+   caps = (S_CaptureSlab){0};
+}
+
+PRIVATE U16 setIdx(S_Match const *ms)
+   { return (ms - caps.ms) / caps.size; }
+
+PRIVATE S_Match * newSet(void)
+{
+   if(caps.freePut == 0)
+      { return NULL; }
+
+   U16 i = caps.free[--caps.freePut];
+   caps.refs[i] = 1;
+   return &caps.ms[(size_t)i * caps.size];
+}
+
+PRIVATE void shareSet(S_Match *ms)
+   { if(ms != NULL) { caps.refs[setIdx(ms)]++; }}
+
+PRIVATE void dropSet(S_Match *ms)
+{
+   if(ms != NULL) {
+      U16 i = setIdx(ms);
+      if(--caps.refs[i] == 0) {
+         caps.free[caps.freePut++] = i; }}
+}
+
+/* Make the set held by 'm' it's own, copying it if it's shared, before it's written. Return FALSE
+   if there's no set to write to.
+*/
+PRIVATE BOOL ownMatches(S_MatchList *m)
+{
+   if(m->ms == NULL)
+      { return FALSE; }
+
+   if(caps.refs[setIdx(m->ms)] > 1)
+   {
+      S_Match *cpy;
+      if( (cpy = newSet()) == NULL)
+         { return FALSE; }
+
+      memcpy(cpy, m->ms, m->put * sizeof(S_Match));
+      dropSet(m->ms);
+      m->ms = cpy;
+      countStat(copies);
+   }
+   return TRUE;
 }
 
 PRIVATE void copyMatchToList(RegexLT_S_Match *dest, S_Match const *src, C8 const *srcStr)
@@ -221,12 +365,68 @@ PRIVATE void copyMatchToList(RegexLT_S_Match *dest, S_Match const *src, C8 const
    dest->at = srcStr + src->start;
 }
 
+/* Return TRUE if global match 'm' displaces 'was'. A real (non-empty) match beats an empty one
+   found elsewhere, e.g 'c*' on "bbcb" is the 'c', not the nothing before the first 'b'. Otherwise
+   the leftmost wins; at the same start, leftmost-first ('byPriority') the later-found match, as
+   it's from a preferred thread, else the longer.
+*/
+PRIVATE BOOL displaces(S_Match const *m, RegexLT_S_Match const *was, BOOL byPriority)
+{
+   if(m->start != was->idx)                                          // Start at different places?
+   {
+      if((m->len == 0) != (was->len == 0))                           // One is empty?
+         { return m->len > 0; }                                      // then the real match wins.
+      return m->start < was->idx;                                    // else the leftmost.
+   }
+   return byPriority || m->len > was->len;
+}
+
+/* Copy the captures of thread matches 'from' into the caller's 'ml'; group 'n' into matches[n].
+   If 'replace' then 'from' holds the new global match and it's captures overwrite those in 'ml',
+   and clear those it didn't capture. Otherwise, if 'from' reached the same global match as 'ml'
+   holds, they fill slots of 'ml' which are still empty; captures of some other match are left
+   out. 'ml' slots which no thread filled have 'at' == NULL.
+*/
+PRIVATE void copySlotsToList(RegexLT_S_MatchList *ml, S_MatchList const *from, C8 const *srcStr, BOOL replace)
+{
+   if(replace == FALSE &&
+      (ml->put == 0 || hasCapture(from, 0) == FALSE ||                                        // Nothing to compare with? OR
+       from->ms[0].start != ml->matches[0].idx || from->ms[0].len != ml->matches[0].len))    // not the match 'ml' holds?
+      { return; }                                                                             // then none of 'from' belongs in 'ml'.
+
+   U8 g, s;
+   for(g = 0; g < ml->listSize; g++)
+   {
+      s = slotOf(g);
+      if((g == 0 || s > 0) && hasCapture(from, s))                  // Global, or a recorded group, which 'from' captured?
+      {
+         while(ml->put <= g)                                         // 'ml' slots not used yet?
+            { ml->matches[ml->put++] = (RegexLT_S_Match){.at = NULL, .idx = 0, .len = 0}; }   // then they are empty.
+
+         if(replace || ml->matches[g].at == NULL)
+            { copyMatchToList(&ml->matches[g], &from->ms[s], srcStr); }
+      }
+      else if(replace == TRUE && g < ml->put)                        // New global match didn't capture a group the old one did?
+         { ml->matches[g] = (RegexLT_S_Match){.at = NULL, .idx = 0, .len = 0}; }   // then it's empty now.
+   }
+}
+
 /* ---------------------- Regex engine threads support --------------------------------- */
 
+/* A counting-set of repeat counts; every count from 'lo' to 'hi' is live. Threads which sit on the
+   same counted loop, e.g [0-9A-F]{512}, but which entered it on successive chars differ only by
+   their counts. Rather than run one thread per count, removeDuplicateThreads() folds them into
+   a single thread holding the range. 'hi' is the count of the oldest (earliest-started) member,
+   which is the one whose matches the thread carries.
+*/
+typedef struct {
+   T_RepeatCnt lo, hi;
+} S_RptCnts;
+
 typedef struct {
    T_InstrIdx  pc;              // Program counter
    C8 const   *sp;              // Source (input string) pointer.
-   T_RepeatCnt rptCnt;          // A run-count for the character set in this thread. For repeats e.g (Ha){3}
+   S_RptCnts   rptCnt;          // Run-count(s) for the character set in this thread. For repeats e.g (Ha){3}
    C8 const   *subgroupStart;   // If a subgroup was opened in this thread, then this is the 1st char of the subgroup.
    T_InstrIdx  lastOpensSub;    // Instruction (PC) which opened the most recent sub-group / sub-expression.
    S_MatchList matches;         // Matches which this thread has found - so far.
@@ -239,11 +439,18 @@ typedef struct {
 #define _EatMismatches   TRUE
 #define _StopAtMismatch  FALSE
 
-typedef U8 T_ThrdListIdx;
+typedef U16 T_ThrdListIdx;
 
 typedef struct {
-   S_Thread       *ts;
-   T_ThrdListIdx   len, put;
+   S_Thread          *ts;
+   T_ThrdListIdx     len, put,
+                     ran,           // These many, from the start, have run this cycle.
+                     ins;           // byPriority: forks of the running thread go here, ahead of the threads it outranks.
+   T_ThrdListIdx     variants,      // Threads here equivalent to another but for their captures (see addThread())...
+                     maxVariants;   // ...and the most there may be.
+   S_InstrList const *prog;         // Threads here run this.
+   BOOL              overflowed,    // A thread was dropped because the list was full.
+                     byPriority;    // Threads are in order of preference; for _RegexLT_Flags_MatchFirst.
 } S_ThreadList;
 
 
@@ -253,84 +460,83 @@ typedef struct {
 
 #define _EatLeads          TRUE
 #define _NoEatLeads        FALSE
-PRIVATE void addMatchSub(S_Thread *t, C8 const *inStr, C8 const *start, C8 const *end, BOOL eatLeads, U16 line, C8 const *tag)
+
+/* Write 'm' to capture 'slot' of 'l', which 'l' owns. Slots below 'slot' not yet used are
+   marked empty.
+*/
+PRIVATE void setSlot(S_MatchList *l, U8 slot, S_Match const *m)
+{
+   for(; l->put <= slot; l->put++)
+      { l->ms[l->put] = noCapture; }
+   l->ms[slot] = *m;
+}
+
+/* Record [start, end] into capture 'slot' of 't'; slot 0 is the global match. A capture is a
+   direct write to its slot; so a group which repeats keeps its latest. If 'eatLeads' then
+   an existing global match is replaced only by one which starts earlier.
+*/
+PRIVATE void addMatchSub(S_Thread *t, U8 slot, C8 const *inStr, C8 const *start, C8 const *end, BOOL eatLeads, U16 line, C8 const *tag)
 {
    #define _MatchHdr "      --- " _LineNumberFmt
    #define _MatchTag "  \t\t\t<%s>"
 
-   if(start < inStr || end < start)                                     // 'start' before start of source string? OR 'end' before 'start'?
-      { errPrint(_MatchHdr "AddM m[%d] <- &(?,?) (%d:) Illegal 'start' or 'end' ptr" _MatchTag "\r\n", line, t->matches.put, t->matches.latestPC, tag); }   // then illegal match interval.
+   if(slot >= t->matches.bufSize)                                       // No slot for this? e.g running capture-free for RegexLT_IsMatch(), or global-only.
+      { return; }                                                       // then there's nothing to record.
+
+   if(ownMatches(&t->matches) == FALSE)                                 // Couldn't get a set of our own to write to?
+      { errPrint(_MatchHdr "AddM no capture set" _MatchTag "\r\n", line, tag); }
+
+   else if(start < inStr || end < start)                                // 'start' before start of source string? OR 'end' before 'start'?
+      { errPrint(_MatchHdr "AddM m[%d] <- &(?,?) Illegal 'start' or 'end' ptr" _MatchTag "\r\n", line, slot, tag); }   // then illegal match interval.
    else                                                                 // else match interval is fine. Continue...
    {
-      // then the interval is this.
-      RegexLT_T_MatchIdx startIdx = ClipU32toU16(start - inStr);
-      RegexLT_T_MatchIdx len = ClipU32toU16(end - start + 1);
+      S_Match m = {.start = ClipU32toU16(start - inStr), .len = ClipU32toU16(end - start + 1)};
 
-      if(eatLeads && t->matches.put > 0)                                // Eating leading mismatches? AND the list has at least 1 match?
-      {
-         S_Match *m = &t->matches.ms[0];                                // 1st match is the global.
-         if(startIdx < m->start) {                                      // This new match starts earlier than the global on the list?
-            m->start = startIdx; m->len = len;                          // then the new match replaces the existing one.
-                             dbgPrint(_MatchHdr "LeadM m[0] <- @(%d,%d) (%d:)" _MatchTag "\r\n", line, m->start, m->len, t->matches.latestPC, tag); }
-         t->matches.latestPC = t->pc;
-         if(t->matches.put == 0)
-            { t->matches.put = 1; }
-      }
-      else                                                              // otherwise don't compare global match. Add 1st global or a sub-match.
-      {
-         /* If there's already a sub-match and the new match AND this new match is to the same sub-expression as the
-            most recent existing match AND it starts at the same point as the previous sub-match but is longer (it should be)
-            then lengthen the existing sub-match.
-
-            Otherwise it's a minimal new sub-match and we append it to the match-list.
-         */
-         BOOL dup = FALSE;
-
-         if(t->matches.put > 1 &&                                       // There's a sub-match? AND
-            t->pc == t->matches.latestPC) {                             // it's on the same regex sub-expression as the most recent?
-            if(t->matches.ms[t->matches.put-1].start == startIdx &&     // New match starts at same place in source string? AND
-               len > t->matches.ms[t->matches.put-1].len ) {            // it's longer?
-               dup = TRUE; }}                                           // then we have an extension of the most recent sub-match.
-
-         if( dup == FALSE && t->matches.put < t->matches.bufSize) {     // NOT an extension? must add... Enuf room to add another match?
-
-            S_Match *m = &t->matches.ms[t->matches.put];                // then add new match.
-            m->start = startIdx; m->len = len;
-            t->matches.latestPC = t->pc;
-                              dbgPrint(_MatchHdr "AddM m[%d] <- @(%d,%d) (%d:)" _MatchTag "\r\n", line, t->matches.put, m->start, m->len, t->matches.latestPC, tag);
-            t->matches.put++;
-            }                                         // and we have one more (match)
-         else {                                                         // else not adding a new match
-            if(dup == TRUE) {                                           // Extending existing match?
-               t->matches.ms[t->matches.put-1].len = len;               // Just replace existing length with new.
-                              dbgPrint(_MatchHdr "DupM m[%d] @(%d,%d) -> (%d,%d) (%d:)" _MatchTag "\r\n",
-                                  line, t->matches.put-1, startIdx,  t->matches.ms[t->matches.put-1].len, startIdx, len, t->matches.latestPC, tag );
-            }
-            else
-               { dbgPrint(_MatchHdr "No room for match @(%d,%d) capacity = %d" _MatchTag "\r\n", line, start-inStr, end-start, t->matches.bufSize, tag);  }
-         }
-      }
+      if(eatLeads && slot < t->matches.put && t->matches.ms[slot].start <= m.start)   // Eating leading mismatches? AND already have a match which starts no later?
+         { return; }                                                    // then keep that one.
+
+      setSlot(&t->matches, slot, &m);
+                              dbgPrint(_MatchHdr "%sM m[%d] <- @(%d,%d)" _MatchTag "\r\n", line, eatLeads ? "Lead" : "Add", slot, m.start, m.len, tag);
    }
 }
 
 PRIVATE void addMatch(S_Thread *t, C8 const *inStr, C8 const *start, C8 const *end, U16 line, C8 const *tag)
-   { addMatchSub(t, inStr, start, end, _NoEatLeads, line, tag); }
+   { addMatchSub(t, 0, inStr, start, end, _NoEatLeads, line, tag); }
 
 PRIVATE void addLeadMatch(S_Thread *t, C8 const *inStr, C8 const *start, C8 const *end, U16 line, C8 const *tag)
-   { addMatchSub(t, inStr, start, end, _EatLeads, line, tag); }
+   { addMatchSub(t, 0, inStr, start, end, _EatLeads, line, tag); }
+
+// Record a capture for 'group', if it's one the caller wants; 0 is no group.
+PRIVATE void addCapture(S_Thread *t, U8 group, C8 const *inStr, C8 const *start, C8 const *end, U16 line, C8 const *tag)
+{
+   U8 slot;
+   if( (slot = slotOf(group)) > 0)
+      { addMatchSub(t, slot, inStr, start, end, _NoEatLeads, line, tag); }
+}
+
+/* Close the group which 'ip' closes, in 't', at 'sp'; captured from the 'subgroupStart'. Unless
+   'ip' loops on itself inside the group e.g '([ab]+)', the group is now shut; so if 't' loops
+   back to the CharBox which opens it e.g for '(ab)+' or '(ab*)+', that starts a new capture.
+*/
+PRIVATE void closeGroup(S_Thread *t, S_Instr const *ip, S_InstrList const *prog, C8 const *str, C8 const *sp, U16 line)
+{
+   addCapture(t, ip->group, str, t->subgroupStart, sp-1, line, "closeGroup");    // (sp-1, cuz src pointer is one-past subgroup close)
+   if(ip->rptInGroup == FALSE)
+      { t->lastOpensSub = prog->put; }                                          // i.e at no instruction.
+}
 
 /* --------------------------- threadList -----------------------------------------
 
-   Returns a list to hold/run 'len' threads. NULL if malloc() failed.
+   Returns a list to hold/run 'len' threads of 'prog'. NULL if malloc() failed.
 */
-PRIVATE S_ThreadList * threadList(T_ThrdListIdx len)
+PRIVATE S_ThreadList * threadList(T_ThrdListIdx len, S_InstrList const *prog)
 {
    S_Thread     *thrd;
    S_ThreadList *lst;
 
    S_TryMalloc toMalloc[] = {
-      { (void**)&thrd, (size_t)len * (sizeof(S_Thread)+2)    },       // All these threads...
-      { (void**)&lst, 1            * sizeof(S_ThreadList) }};     // ...held in 1 list.
+      { (void**)&thrd, (size_t)len * (sizeof(S_Thread)+2), E_RegexMem_ThreadLists },    // All these threads...
+      { (void**)&lst, 1            * sizeof(S_ThreadList), E_RegexMem_ThreadLists }};  // ...held in 1 list.
 
    if( getMemMultiple(toMalloc, RECORDS_IN(toMalloc)) == FALSE)
       { return NULL; }        // ... but if a malloc() failed return NULL.
@@ -339,6 +545,13 @@ PRIVATE S_ThreadList * threadList(T_ThrdListIdx len)
       lst->ts = thrd;         // Attach thread holders to list
       lst->len = len;         // There are these many
       lst->put = 0;           // 1st thread will go here.
+      lst->ran = 0;
+      lst->ins = 0;
+      lst->variants = 0;
+      lst->maxVariants = 0;
+      lst->prog = prog;
+      lst->overflowed = FALSE;
+      lst->byPriority = FALSE;
       return lst;             // and return the list...
    }
 }
@@ -347,44 +560,215 @@ PRIVATE S_ThreadList * threadList(T_ThrdListIdx len)
 
 PRIVATE void unThreadList(S_ThreadList * lst) { safeFree(lst->ts); safeFree(lst); }
 
+/* ---------------------------- variantsRoom --------------------------------
+
+   A run of a program with capture groups has room in each list of 'len' for a quarter as many
+   threads again which are equivalent to another but for their captures; see addThread().
+*/
+PRIVATE U16 variantsRoom(U16 len, U8 maxMatches)
+{
+   if(maxMatches <= 1)                                   // Global match only, or capture-free?
+      { return 0; }                                      // then there are no variants.
+   len /= 4;                                             // Few states, in practice, have more than one set of captures.
+   return len < _MaxThreadList - len ? len : _MaxThreadList - len;
+}
+
 /* ---------------------------- addThread --------------------------------
 
    Add 'toAdd' to 'l'. Return NULL if no room to add; else return a reference to the 'S_Thread'
    added to 'l'.
+
+   If 'l' already holds a Thread equivalent to 'toAdd' (see threadsEquivalent()), with the same
+   captures (see capturesSame()), then 'toAdd' would take the same path and capture the same; so
+   just one goes on, with the matches of whichever started matching first; or, if 'l' is
+   'byPriority', of the one already there, which the regex prefers. Threads which differ only in
+   their captures both go on, while there's room for them (see variantsRoom()); after that they
+   are merged as above, rather than crowd out other states and fail the run. So 'l' holds no
+   more Threads than there are distinct states, and captures which may yet be wanted; see
+   boundThreads(). But if the one in 'l' has already run, its later match has gone on with the
+   threads it made; so it's retired and 'toAdd' runs in its place, and its threads replace those.
+
+   If 'l' is full then 'toAdd' is dropped and 'l' is marked 'overflowed'; runOnce() then gives up
+   rather than return a result which may be wrong. Either way, matches owned by 'toAdd' are freed.
+*/
+PRIVATE BOOL threadsEquivalent(S_Thread const *a, S_Thread const *b, S_InstrList const *prog);
+PRIVATE BOOL capturesSame(S_Thread const *a, S_Thread const *b);
+
+PRIVATE BOOL earlierMatch(S_MatchList const *a, S_MatchList const *b)
+   { return hasCapture(a, 0) && (!hasCapture(b, 0) || a->ms[0].start < b->ms[0].start); }
+
+PRIVATE void clearThreadMatches(S_Thread *t)
+   { t->matches = (S_MatchList){.ms = NULL, .bufSize = 0, .put = 0}; }
+
+PRIVATE void freeThreadMatches(S_Thread *t)
+{
+   dropSet(t->matches.ms);
+   clearThreadMatches(t);
+}
+
+/* 'to' lets go of its matches and takes over those of 'from', which is left with none. And the
+   subgroup 'from' has open; so the next capture is from where 'from' opened it.
+*/
+PRIVATE void takeMatches(S_Thread *to, S_Thread *from)
+{
+   dropSet(to->matches.ms);
+   to->matches = from->matches;
+   to->subgroupStart = from->subgroupStart;
+   to->lastOpensSub = from->lastOpensSub;
+   clearThreadMatches(from);
+}
+
+/* Return the index in 'l' of a thread equivalent to 'toAdd' with the same captures; or, if 'l'
+   has no room for another variant, of any equivalent, which 'toAdd' must then merge with.
+   'l->put' if none; then '*variant' says if 'toAdd' is a variant of one in 'l'.
 */
-PRIVATE S_Thread const * addThread(S_ThreadList *l, S_Thread const *toAdd)
+PRIVATE T_ThrdListIdx findEquivalent(S_ThreadList const *l, S_Thread const *toAdd, BOOL *variant)
+{
+   T_ThrdListIdx c, any = l->put;
+
+   for(c = 0; c < l->put; c++)
+   {
+      if(threadsEquivalent(&l->ts[c], toAdd, l->prog))
+      {
+         if(capturesSame(&l->ts[c], toAdd))
+            { return c; }
+         if(any == l->put)
+            { any = c; }
+      }
+   }
+   *variant = any < l->put;
+   return l->variants >= l->maxVariants || l->put >= l->len ? any : l->put;
+}
+
+PRIVATE S_Thread const * addThread(S_ThreadList *l, S_Thread *toAdd)
 {
+   if(toAdd == NULL)
+      { return NULL; }
+
+   T_ThrdListIdx c;
+   BOOL variant;
+   if( (c = findEquivalent(l, toAdd, &variant)) < l->put)  // Already have this state?
+   {
+      S_Thread *t = &l->ts[c];
+      BOOL earlier = !l->byPriority &&                      // Unless the one we have is preferred...
+         earlierMatch(&toAdd->matches, &t->matches);        // ...keep whichever's match started first...
+
+      if(earlier && c < l->ran)                             // ...but 't' has already run?
+         { t->deleted = TRUE; }                             // then retire it, and add 'toAdd' (below) to run instead.
+      else
+      {
+         if(earlier == TRUE)
+            { takeMatches(t, toAdd); }
+         freeThreadMatches(toAdd);                          // ...and drop 'toAdd'.
+         countStat(merges);
+         return t;
+      }
+   }
+
    if(l->put >= l->len)
    {
       errPrint("#%u ****** No Add put %d len %d\r\n ***********\r\n", tdd_TestNum, l->put, l->len);
+      countStat(overflows);
+      freeThreadMatches(toAdd);
+      l->overflowed = TRUE;
       return NULL;
    }
    else
    {
-      if(toAdd == NULL)
-         { return NULL; }
-      else {
-         l->ts[l->put] = *toAdd;
-         l->put++;
-         return &l->ts[l->put-1]; }
+      l->ts[l->put] = *toAdd;
+      l->put++;
+      if(variant == TRUE)
+         { l->variants++; }
+      countStat(threads);
+      if(regexlt_stats != NULL && l->put > regexlt_stats->peakThreads)
+         { regexlt_stats->peakThreads = l->put; }
+      return &l->ts[l->put-1];
    }
 }
 
-typedef struct {
-   S_MatchList const *lst;
-   BOOL              clone;
-   U8                newBufSize;
-} S_ThrdMatchCfg;
+/* ---------------------------- forkThread --------------------------------
+
+   Add 'toAdd', which goes on from the thread running now, to 'l'; see addThread(). (But a
+   thread which retries the regex from a later start is just added.)
+
+   If 'l' is 'byPriority' then 'toAdd' goes at 'l->ins'. In the current list that's right after
+   the running thread, and after any forks it already made; so it runs before the threads the
+   running one is preferred to. In the next list it's after the threads added so far but ahead
+   of any which start later, which are preferred least. An equivalent thread ahead of 'ins' is
+   preferred and 'toAdd' is dropped, unless 'toAdd' started first; leftmost beats preferred. One
+   behind 'ins' isn't preferred, and gives way to 'toAdd'.
+*/
+PRIVATE S_Thread const * forkThread(S_ThreadList *l, S_Thread *toAdd)
+{
+   if(toAdd == NULL || l->byPriority == FALSE)
+      { return addThread(l, toAdd); }
+
+   T_ThrdListIdx c;
+   BOOL variant;
+
+   if( (c = findEquivalent(l, toAdd, &variant)) < l->put)  // Already have this state? (as addThread())
+   {
+      S_Thread *t = &l->ts[c];
+
+      countStat(merges);
+      if(c < l->ins)                                        // and it's preferred?
+      {
+         if(earlierMatch(&toAdd->matches, &t->matches) == FALSE)    // 'toAdd' started no earlier?
+         {
+            freeThreadMatches(toAdd);                       // then drop 'toAdd'.
+            return t;
+         }
+         if(c >= l->ran)                                    // else leftmost beats preferred; 't' yet to run?
+         {
+            takeMatches(t, toAdd);                          // then it carries on with the match of 'toAdd'.
+            freeThreadMatches(toAdd);
+            return t;
+         }
+         t->deleted = TRUE;                                 // else retire it, and add 'toAdd' (below) to run instead.
+      }
+      else
+      {
+         freeThreadMatches(t);                              // else 't' has yet to run; remove it, for 'toAdd'.
+         memmove(t, t+1, (l->put - c - 1) * sizeof(S_Thread));
+         l->put--;
+         variant = FALSE;                                   // ('toAdd' takes it's place.)
+      }
+   }
+
+   if(l->put >= l->len)
+   {
+      countStat(overflows);
+      freeThreadMatches(toAdd);
+      l->overflowed = TRUE;
+      return NULL;
+   }
+   else
+   {
+      S_Thread *t = &l->ts[l->ins];
+      memmove(t+1, t, (l->put - l->ins) * sizeof(S_Thread));   // Make room, behind the running thread's forks.
+      *t = *toAdd;
+      l->put++;
+      l->ins++;
+      if(variant == TRUE)
+         { l->variants++; }
+      countStat(threads);
+      if(regexlt_stats != NULL && l->put > regexlt_stats->peakThreads)
+         { regexlt_stats->peakThreads = l->put; }
+      return t;
+   }
+}
 
 /* ------------------------------------------ newThread ------------------------------------------
 
-   Make and return a new thread with a match-list empty or no, specified by 'mcf'.
+   Make and return a new thread which shares the matches 'from' another thread; or, if 'from' is
+   NULL, has a new, empty, capture set. Captures are copied only when a thread writes to a set it
+   shares (see ownMatches()). A capture-free run (caps.size == 0) carries no matches.
 
    'src' is the current read of the input string. 'groupStart' and 'rpts' are copied from the
    thread which spawned this one.
 */
-PRIVATE S_Thread *newThread(S_Thread *t, T_InstrIdx pc, C8 const *src, T_RepeatCnt rpts, C8 const *groupStart,
-                            T_InstrIdx subStartIdx, S_ThrdMatchCfg const *mcf, BOOL eatMismatches, E_CaseRule caseRule)
+PRIVATE S_Thread *newThread(S_Thread *t, T_InstrIdx pc, C8 const *src, S_RptCnts rpts, C8 const *groupStart,
+                            T_InstrIdx subStartIdx, S_MatchList const *from, BOOL eatMismatches, E_CaseRule caseRule)
 {
    t->pc = pc;                          // Program counter
    t->sp = src;                         // input string read at...
@@ -395,34 +779,17 @@ PRIVATE S_Thread *newThread(S_Thread *t, T_InstrIdx pc, C8 const *src, T_RepeatC
    t->caseRule = caseRule;
    t->deleted = FALSE;
 
-   if(mcf->lst == NULL)                                                                // No existing matches to clone or reference?
+   if(caps.size == 0)                                                   // Capture-free run? (see RegexLT_IsMatch())
+      { t->matches = (S_MatchList){.ms = NULL, .bufSize = 0, .put = 0}; }   // then this thread carries no matches.
+   else if(from == NULL)                                                // No existing matches to share?
    {
-      t->matches.put = 0;                                                              // then match list for this thread starts empty
-      t->matches.latestPC = _Max_T_InstrIdx;                                           // this is 'no instruction'.
-
-      // Malloc() 'newBufSize' slots for this match-list
-      if( (t->matches.ms = br->getMem(mcf->newBufSize * sizeof(S_Match))) == NULL)     // Couldn't malloc for matches?
-         { t->matches.bufSize = 0; }                                                   // then say there's space for none.
-      else
-         { t->matches.bufSize = mcf->newBufSize; }                                     // else malloc success; we can hold these many matches.
-      t->matches.isOwner = TRUE;                                                       // Either way; we own the space/non-space for these matches.
+      t->matches = (S_MatchList){.ms = newSet(), .put = 0};             // then start an empty set.
+      t->matches.bufSize = t->matches.ms == NULL ? 0 : caps.size;       // No set to be had? then say there's space for none.
    }
-   else                                                                                // else there's and existing match list to clone or reference.
+   else                                                                 // else share the existing set.
    {
-      t->matches = *(mcf->lst);                                                        // Copy the 'shell' of the match list.
-      if(mcf->clone) {                                                                 // Are we cloning the match-list?, not just referencing the matches.
-         if( (t->matches.ms = br->getMem(mcf->newBufSize * sizeof(S_Match))) == NULL)  // Could not malloc for the matches we must clone?
-            { t->matches.bufSize = 0; }                                                // then we got a zero-sized match list
-         else {
-            t->matches.bufSize = mcf->newBufSize;                                      // else malloc success; can hold this many matches.
-            t->matches.isOwner = TRUE;                                                 // which we will clone, so we own them.
-
-            if(mcf->lst->put > 0) {                                                    // There are matches in the existing list?
-               memcpy(t->matches.ms, mcf->lst->ms, mcf->lst->put * sizeof(S_Match)); }} // then copy them into the new list we just made.
-         }
-      else {
-         t->matches.isOwner = FALSE;
-      }
+      t->matches = *from;
+      shareSet(t->matches.ms);
    }
    return t;
 }
@@ -431,24 +798,16 @@ PRIVATE S_Thread *newThread(S_Thread *t, T_InstrIdx pc, C8 const *src, T_RepeatC
 
 PRIVATE void clearThreadList(S_ThreadList *l)
 {
-   /* Before clearing the list free() any memory allocated for matches. Matches are
-      made by one thread and referenced by others which are created as the regex is
-      executed. We can't free the same memory twice; so must check.
+   /* Before clearing the list, each thread lets go of its capture set. Sets are shared, so
+      one goes back to the slab only when the last thread holding it lets go.
    */
-   U8 c;
+   T_ThrdListIdx c;
    for(c = 0; c < l->put; c++)               // For each thread...
-   {
-      S_MatchList *m = &l->ts[c].matches;
-
-      if(m->isOwner == TRUE) {               // This thread malloced the matches ms[]?
-         safeFree(m->ms);                    // then (this thread) free()s it.
-         m->ms = NULL; }                     // and null ptr cuz memory is gone.
-
-      m->bufSize = 0;                        // Park 'bufSize', 'put' & 'isOwner' tidy.
-      m->put = 0;
-      m->isOwner = FALSE;
-   }
+      { freeThreadMatches(&l->ts[c]); }      // ...let go of its matches.
    l->put = 0;       // Reset the 'put' ptr clears the thread list itself; we don't bother to zero the actual Thread contents.
+   l->ran = 0;
+   l->ins = 0;
+   l->variants = 0;
 }
 
 /* ----------------------------------- swapPtr ---------------------------------------- */
@@ -539,26 +898,102 @@ PRIVATE C8 const * printRegexSample(S_CharsBox const *cb)
 /* ----------------------------------------- prntRpts --------------------------------------
 
     Print the repeats-spec 'r' (for a thread) and the current repeat-count (of that thread)
-    Same-ish format as printAnyRepeats() in regexlt_print.c
+    Same-ish format as printAnyRepeats() in regexlt_print.c. If the thread holds a range of
+    counts then print that range e.g '{3,9}2-5'.
 */
-PRIVATE C8 const * prntRpts( S_RepeatSpec const *r, T_RepeatCnt cnt )
+PRIVATE C8 const * prntRpts( S_RepeatSpec const *r, S_RptCnts cnt )
 {
-   static C8 buf[20];
+   static C8 buf[40];
+   C8 cb[14];
+
+   if(cnt.lo == cnt.hi)
+      { sprintf(cb, "%u", cnt.hi); }
+   else
+      { sprintf(cb, "%u-%u", cnt.lo, cnt.hi); }
 
    if(r->cntsValid)
       if(r->min == r->max)
-         { sprintf(buf, "{%d}%d", r->min, cnt); }
+         { sprintf(buf, "{%u}%s", r->min, cb); }
       else if(r->max == _Repeats_Unlimited)
-         { sprintf(buf, "{%d,*}%d", r->min, cnt); }
+         { sprintf(buf, "{%u,*}%s", r->min, cb); }
       else
-         { sprintf(buf, "{%d,%d}%d", r->min, r->max, cnt); }
+         { sprintf(buf, "{%u,%u}%s", r->min, r->max, cb); }
    else if(r->always)
-      { sprintf(buf, "{*}%d", cnt); }
+      { sprintf(buf, "{*}%s", cb); }
    else
-      { sprintf(buf, "{_}%d", cnt); }
+      { sprintf(buf, "{_}%s", cb); }
    return buf;
 }
 
+/* ---------------------------------- Repeat-count sets -------------------------------------- */
+
+PRIVATE S_RptCnts const noRpts = {.lo = 0, .hi = 0};
+
+PRIVATE BOOL rptsSame(S_RptCnts const *a, S_RptCnts const *b)
+   { return a->lo == b->lo && a->hi == b->hi; }
+
+// Each count in 'r' goes up by one; a loop was completed. Clip rather than wrap.
+PRIVATE S_RptCnts rptsBump(S_RptCnts r)
+{
+   if(r.hi < _Repeats_Unlimited) { r.hi++; }
+   if(r.lo < _Repeats_Unlimited) { r.lo++; }
+   return r;
+}
+
+/* ---------------------------------- charBoxWidth --------------------------------------
+
+   Return the number of input chars which 'cb' consumes when it matches. Every kind of chars
+   segment is fixed-width; a literal segment is it's length, an escape or class is 1 and an
+   anchor is zero.
+*/
+PRIVATE U16 charBoxWidth(S_CharsBox const *cb)
+{
+   U16 w = 0;
+   S_CharSegs const *sg;
+
+   for(sg = cb->segs; sg->opcode != OpCode_EndCBox && sg->opcode != OpCode_Null; sg++)
+   {
+      if(sg->opcode == OpCode_Chars)
+         { w += sg->payload.literals.len; }
+      else if(sg->opcode == OpCode_EscCh || sg->opcode == OpCode_Class)
+         { w++; }
+   }
+   return w;
+}
+
+/* ---------------------------------- countedBox -------------------------------------------
+
+   If 'pc' is on a counted loop around a single CharBox, i.e 'Split{n,m} -> CharBox -> Jmp back',
+   return the index of that CharBox; otherwise _Max_T_InstrIdx. 'pc' may be at the CharBox or
+   at the Jmp.
+
+   Only these loops hold a counting-set. Because their body is a single fixed-width CharBox
+   each count in the set is one CharBox-width later in the input string than the next-older
+   count; so the set needs no more than it's range and the start of it's oldest member.
+*/
+#define _NotCounted _Max_T_InstrIdx
+
+PRIVATE T_InstrIdx countedBox(S_InstrList const *prog, T_InstrIdx pc)
+{
+   S_Instr const *b = prog->buf;
+   T_InstrIdx box;
+
+   if(b[pc].opcode == OpCode_CharBox)                    // At the CharBox?
+      { box = pc; }
+   else if(b[pc].opcode == OpCode_Jmp && pc > 0)         // else at the Jmp which closes a loop (maybe)
+      { box = pc - 1; }
+   else
+      { return _NotCounted; }
+
+   return
+      box > 0 && box + 1 < prog->put &&
+      b[box].opcode == OpCode_CharBox &&
+      b[box-1].opcode == OpCode_Split && b[box-1].repeats.cntsValid && b[box-1].left == box &&   // 'Split{n,m}' enters the CharBox? AND
+      b[box+1].opcode == OpCode_Jmp && b[box+1].left == box-1                                 // 'Jmp' loops back to the Split?
+         ? box
+         : _NotCounted;
+}
+
 /* ----------------------------------- sprntMatches --------------------------------------- */
 
 PRIVATE C8 const * sprntMatches(C8 *out, S_MatchList const *ml)
@@ -567,7 +1002,10 @@ PRIVATE C8 const * sprntMatches(C8 *out, S_MatchList const *ml)
    out[0] = '\0';
    for(U8 c = 0; c < ml->put; c++)
    {
-      sprintf(b1, "(%d %d)", ml->ms[c].start, ml->ms[c].len);
+      if(hasCapture(ml, c))
+         { sprintf(b1, "(%d %d)", ml->ms[c].start, ml->ms[c].len); }
+      else
+         { strcpy(b1, "(_)"); }
       strcat(out, b1);
    }
    return out;
@@ -584,15 +1022,22 @@ PRIVATE C8 const * sprntThread(C8 *out, T_ThrdListIdx ti, S_Thread const *t)
 /* --------------------------------- threadsEquivalent ------------------------------------
 
    'a' and 'b' in a thread list are equivalent if they are at the same instruction (pc =
-   program counter" and have the same repeat count.
+   program counter" and have the same repeat count. Unless no counted 'Split' can read the
+   count from that instruction on (see markIdleCounts()); then the count doesn't matter.
+
+   And they must treat a mismatch the same; a thread still eating leading mismatches is not the
+   same as one which has started a match.
 */
-PRIVATE BOOL threadsEquivalent(S_Thread const *a, S_Thread const *b)
+PRIVATE BOOL threadsEquivalent(S_Thread const *a, S_Thread const *b, S_InstrList const *prog)
 {
    return
       a->deleted == FALSE &&
       b->deleted == FALSE &&
       a->pc == b->pc &&
-      a->rptCnt == b->rptCnt;
+      a->sp == b->sp &&
+      a->eatMismatches == b->eatMismatches &&
+      a->caseRule == b->caseRule &&
+      (prog->buf[a->pc].idleCount || rptsSame(&a->rptCnt, &b->rptCnt));
 }
 
 /* ---------------------------------- matchesSame -------------------------------------- */
@@ -600,34 +1045,142 @@ PRIVATE BOOL threadsEquivalent(S_Thread const *a, S_Thread const *b)
 PRIVATE BOOL matchesSame(S_Match const *a, S_Match const *b)
    { return a->start == b->start && a->len == b->len; }
 
+/* --------------------------------- capturesSame ------------------------------------
+
+   Return TRUE if 'a' and 'b' hold the same captures, slot for slot past the global match, and
+   have the same subgroup open; so whatever they capture from here on is the same too. Threads
+   which hold no captures, e.g for a capture-free or global-only run, always do.
+*/
+PRIVATE BOOL capturesSame(S_Thread const *a, S_Thread const *b)
+{
+   if(a->matches.bufSize <= 1 && b->matches.bufSize <= 1)             // Neither can hold a capture?
+      { return TRUE; }                                                 // then there's none to differ.
+
+   if(a->subgroupStart != b->subgroupStart || a->lastOpensSub != b->lastOpensSub)
+      { return FALSE; }
+
+   U8 g, n = a->matches.put > b->matches.put ? a->matches.put : b->matches.put;
+   for(g = 1; g < n; g++)
+   {
+      BOOL has = hasCapture(&a->matches, g);
+      if(has != hasCapture(&b->matches, g) ||
+         (has == TRUE && !matchesSame(&a->matches.ms[g], &b->matches.ms[g])))
+         { return FALSE; }
+   }
+   return TRUE;
+}
+
+/* --------------------------------- countsMergeable ------------------------------------
+
+   Return TRUE if 'a' and 'b' are on the same counted loop (see countedBox()) at the same place
+   in the input, differ only in their repeat counts and the starts of the matches they carry,
+   and so may be folded into one thread holding a range of counts.
+
+   The counts must abut or overlap, so the merged set is still a range. And the starts must be
+   exactly a CharBox-width apart per count; then the younger members of the set can always be
+   recovered from the oldest, when the oldest are dropped at the loop's upper limit (see 'Split'
+   in runOnce()).
+*/
+PRIVATE BOOL countsMergeable(S_Thread const *a, S_Thread const *b, S_InstrList const *prog)
+{
+   if(a->deleted == TRUE || b->deleted == TRUE || a->pc != b->pc || a->sp != b->sp ||
+      a->eatMismatches != b->eatMismatches || a->caseRule != b->caseRule || a->lastOpensSub != b->lastOpensSub ||
+      a->matches.put != b->matches.put)
+      { return FALSE; }
+
+   T_InstrIdx box;
+   if( (box = countedBox(prog, a->pc)) == _NotCounted)                     // Not on a counted loop?
+      { return FALSE; }                                                    // then there's no counting-set.
+
+   if(a->rptCnt.lo > (U32)b->rptCnt.hi + 1 || b->rptCnt.lo > (U32)a->rptCnt.hi + 1)   // Gap between the counts?
+      { return FALSE; }                                                    // then can't hold the union as a range.
+
+   S32 dCnt = (S32)a->rptCnt.hi - b->rptCnt.hi;                            // 'a' is this many more loops along than 'b'...
+   S32 dW   = dCnt * charBoxWidth(&prog->buf[box].charBox);                // ...so must have started this many chars earlier.
+
+   /* If a subgroup opened at the counted CharBox, then it's start moves with the count, same as
+      the global match. Otherwise it must be the same for both.
+   */
+   if(a->lastOpensSub == box && a->subgroupStart != NULL && b->subgroupStart != NULL)
+   {
+      if(b->subgroupStart - a->subgroupStart != dW)
+         { return FALSE; }
+   }
+   else if(a->subgroupStart != b->subgroupStart)
+      { return FALSE; }
+
+   if(a->matches.put > 0)                                                  // Have a (leading) global match?
+   {
+      if((S32)b->matches.ms[0].start - a->matches.ms[0].start != dW)       // Starts aren't in step with the counts?
+         { return FALSE; }
+
+      for(U8 c = 1; c < a->matches.put; c++) {                             // Any captures must be the same, slot for slot.
+         if(!matchesSame(&a->matches.ms[c], &b->matches.ms[c])) {
+            return FALSE; }}
+   }
+   return TRUE;
+}
+
+/* ------------------------------------- mergeCounts ------------------------------------
+
+   Fold 'from' into 'to', which were passed by countsMergeable(). 'to' takes the union
+   of the counts; and the matches and subgroup start of whichever is older.
+*/
+PRIVATE void mergeCounts(S_Thread *to, S_Thread const *from)
+{
+   if(from->rptCnt.hi > to->rptCnt.hi)                   // 'from' holds the oldest count?
+   {
+      to->rptCnt.hi = from->rptCnt.hi;                   // then it's the new top of the range.
+      to->subgroupStart = from->subgroupStart;           // and 'to' now carries it's subgroup start...
+
+      if(hasCapture(&from->matches, 0) && ownMatches(&to->matches))    // ...and it's global match.
+         { to->matches.ms[0] = from->matches.ms[0]; }
+   }
+   if(from->rptCnt.lo < to->rptCnt.lo)
+      { to->rptCnt.lo = from->rptCnt.lo; }
+}
+
+/* ------------------------------------- dropOldestCounts ------------------------------------
+
+   Counts in 't' above 'max' have run past the upper limit of a counted loop. Drop them
+   from the set. The new oldest member started one CharBox-width later in the input for each
+   count dropped; so move the global match and any subgroup opened at the CharBox along by
+   that much.
+
+   't's matches are changed here; so they are copied first if they are shared.
+*/
+PRIVATE void dropOldestCounts(S_Thread *t, T_RepeatCnt max, S_InstrList const *prog, T_InstrIdx box)
+{
+   if(t->rptCnt.hi > max)
+   {
+      U16 w = charBoxWidth(&prog->buf[box].charBox);
+      U32 shift = (U32)(t->rptCnt.hi - max) * w;
+
+      if(hasCapture(&t->matches, 0) && ownMatches(&t->matches))
+         { t->matches.ms[0].start += shift; }
+
+      if(t->lastOpensSub == box && t->subgroupStart != NULL)
+         { t->subgroupStart += shift; }
+
+      t->rptCnt.hi = max;
+   }
+}
+
 /* ------------------------------------- mergeMatches ------------------------------------------------
+
+   Fold the matches of 'from' into 'to'. Each capture has it's own slot; so 'to' takes any it
+   doesn't have, and 'from's global match if that starts earlier.
 */
 PRIVATE void mergeMatches(S_MatchList *to, S_MatchList const *from)
 {
-   for(U8 c = 0; c < from->put; c++)                     // For each match in 'from'...
+   for(U8 g = 0; g < from->put; g++)                     // For each slot in 'from'...
    {
-      BOOL dup = FALSE;
-      for(U8 d = 0; d < to->put; d++)                    // With each match in 'to'...
-      {
-         if(matchesSame(&from->ms[c], &to->ms[d]) ) {    // Same [start, len]?
-            dup = TRUE;                                  // then from[c] is already in to[];
-            break; }                                     // quit looking now; no action required
-      }
-      if(dup == FALSE)                                   // Did NOT find from[c] in to[]?
-      {                                                  // So must copy it in.
-         if(c == 0)                                      // At from[0]? ... the global match
-         {                                               // then compare global matches; from[0] vs. to[0].
-            if(from->ms[0].start < to->ms[0].start)      // from[0] is earlier?
-               { to->ms[0] = from->ms[0]; }              // then overwrite to[0] with that earlier match.
-         }
-         else                                            // else at from[1...]; submatches
-         {                                               // Just add the submatch, if there's room.
-            if(to->put < to->bufSize) {                  // Room in to[] yet?
-               to->ms[to->put] = from->ms[c];            // then append from[c]
-               to->put++; }                              // and to[] has an (additional) submatch.
-         }
-      }
-   } // for each match in from[]
+      if(hasCapture(from, g) &&                          // ...which holds a capture AND
+         (!hasCapture(to, g) ||                          // 'to' has none there? OR
+          (g == 0 && from->ms[0].start < to->ms[0].start)) &&    // it's an earlier global match? AND
+         ownMatches(to))                                 // 'to' can be written?
+         { setSlot(to, g, &from->ms[g]); }               // then copy it in.
+   }
 }
 
 // -----------------------------------------------------------------------------------------------
@@ -647,7 +1200,7 @@ PRIVATE C8 const * prntInstr(C8 *out, S_Instr const *ip)
 
     Remove duplicate Threads in 'tl', folding the matches in the into the Thread(s) that are
     retained.  Duplicate Threads at are ones with the same instruction and with the same
-    repeat-count.
+    repeat-count, and the same captures (see capturesSame()).
 
     Duplicate threads can happen with regex which have explosive quantifiers. The two threads
     have reached the same place by two different routes. There's no point in propagating both;
@@ -663,12 +1216,12 @@ PRIVATE BOOL removeDuplicateThreads(S_ThreadList *tl, S_InstrList const *instr)
    if(tl->put >= 2) {                                             // At least 2 Threads in 'tl'?
       BOOL prntedHdr = FALSE;
 
-      for(U8 _from = tl->put-1; _from > 1; _from--) {             // From the last Thread to the 2nd....
-         for(U8 _to = _from-1; _to; _to--) {                      // For each Thread preceding...
+      for(T_ThrdListIdx _from = tl->put-1; _from > 1; _from--) {  // From the last Thread to the 2nd....
+         for(T_ThrdListIdx _to = _from-1; _to; _to--) {                      // For each Thread preceding...
             S_Thread *from = &tl->ts[_from];
             S_Thread *to = &tl->ts[_to];
 
-            if( threadsEquivalent(from, to) ) {                   // Later Thread is equivalent to earlier? ...
+            if( threadsEquivalent(from, to, instr) && capturesSame(from, to) ) {    // Later Thread is equivalent to earlier? ...
 
                if(prntedHdr == FALSE) {
                   dbgPrint("   ---- Found duplicates: Remove later (higher-indexed) one. ----\r\n");
@@ -683,10 +1236,28 @@ PRIVATE BOOL removeDuplicateThreads(S_ThreadList *tl, S_InstrList const *instr)
                            prntRpts(&ip->repeats, from->rptCnt),
                            sprntThread((C8[100]){}, _to, to));
 
-               mergeMatches(&to->matches, &from->matches);        // ...then merge matches from later in earlier.
+               if(tl->byPriority == FALSE)                        // (Unless the earlier is preferred, and keeps just it's own)...
+                  { mergeMatches(&to->matches, &from->matches); }  // ...then merge matches from later in earlier.
+               else if(earlierMatch(&from->matches, &to->matches)) // Preferred, but the later one started first?
+                  { takeMatches(to, from); }                       // then leftmost wins; 'to' carries on with it's match.
                from->deleted = TRUE;                              // and mark later as deleted.
+               countStat(merges);
+
+               dbgPrint("Merged: %s\r\n",  sprntThread((C8[100]){}, _to, to)); }
+
+            else if( countsMergeable(from, to, instr) ) {                                              // else same counted loop, just different counts?
+
+               if(prntedHdr == FALSE) {
+                  dbgPrint("   ---- Found duplicates: Remove later (higher-indexed) one. ----\r\n");
+                  prntedHdr = TRUE; }
+
+               mergeCounts(to, from);                             // then 'to' takes both sets of counts.
+               from->deleted = TRUE;
+               countStat(merges);
 
-               dbgPrint("Merged: %s\r\n",  sprntThread((C8[100]){}, _to, to)); }}}
+               dbgPrint("   %u(%u:) counts merged into %s %s\r\n",
+                           _from, from->pc, sprntThread((C8[100]){}, _to, to),
+                           prntRpts(&instr->buf[to->pc].repeats, to->rptCnt)); }}}
 
       if(prntedHdr == TRUE) {
          dbgPrint("\r\n"); }
@@ -713,35 +1284,91 @@ PRIVATE BOOL rightOpen(S_RepeatSpec const *r)
    Run the compiled regex 'prog' over 'str' until 'Match', meaning the regex was exhausted,
    OR 'str' is exhausted, meaning no match. List the total match and any subgroup matches
    in 'ml'.
+
+   If 'ml' == NULL the run is capture-free; threads carry no match buffers and the run
+   returns at the first thread to reach 'Match'.
+
+   The run starts at 'from', which is in 'str'. Match indices and anchors are still relative
+   to 'str'; so e.g '^' won't match at 'from' if that's past the start of 'str'.
+
+   If 'anchored' the match must start at 'from'; leading mismatches aren't eaten. A program
+   which starts with '^' (prog->anchoredStart) is always run anchored, at the start of 'str'
+   only; it's done as soon as its threads die, rather than eat the rest of 'str'.
+
+   If 'end' isn't NULL the match must end there; a thread reaching 'Match' anywhere else dies.
+   So a capture pass gets the same match as the pass which found it (see runTwoPhase()).
 */
-PRIVATE T_RegexRtn runOnce(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList *ml, U8 maxMatches, RegexLT_T_Flags flags)
+PRIVATE T_RegexRtn runOnce(S_InstrList *prog, C8 const *str, C8 const *from, C8 const *end, RegexLT_S_MatchList *ml, U8 maxMatches, RegexLT_T_Flags flags, BOOL anchored)
 {
    /* Make (empty) 'now' and 'next' thread lists; each as long the compiled regex in 'prog'. runOnce()
       executes the 'curr' Thread list. Any Threads which must continue are copied into 'next'. Any new
       Threads required are also made in 'next. Then, when all Threads in 'curr' have been exhausted 'next'
       and 'curr' are swapped, i.e 'next' becomes the new 'curr'.
 
-      Because no instruction splits into more than 2 paths, the tree/threads for executing
-      'prog' can be no wider than twice 'prog' length, plus 1 for the root thread. That's the reasoning
-      at least; but it's not correct because some test cases need more.
+      Each list is sized by the compiler for the most distinct threads 'prog' can have at once
+      (see boundThreads()), at each place in what's left of 'str' they may be at (see
+      regexlt_threadsNeeded()); addThread() keeps no duplicates. If a list fills anyway, the run fails
+      rather than drop threads and give a wrong answer.
    */
+   if(prog->anchoredStart)                // Every match must start at the start of 'str'?
+   {
+      if(from > str)                      // then there's none from 'from'...
+         { return E_RegexRtn_NoMatch; }
+      anchored = TRUE;                    // ...else try just from there; nothing to eat.
+   }
+
+   /* A match has at least 'minLen' chars. So, unanchored, there's none to find starting past
+      'lastStart'; eating threads stop there.
+   */
+   C8 const *lastStart = str + regexlt_cfg->maxStrLen;       // (No nearer than 'mustEnd', below.)
+
+   if(!anchored && prog->minLen > 0)
+   {
+      size_t left = strlen(from);
+      if(left < prog->minLen)                // Too short for any match?
+         { return E_RegexRtn_NoMatch; }      // then don't bother.
+      lastStart = from + (left - prog->minLen);
+   }
+
+   U16 listLen = regexlt_threadsNeeded(prog, prog->threadPlaces == 1 ? 0 : strlen(from));
+   U16 variants = variantsRoom(listLen, ml == NULL ? 0 : prog->groups + 1);   // The same for both runs of runTwoPhase(); so the 2nd can reuse the heap of the 1st.
    S_ThreadList *curr, *next;
-   T_ThrdListIdx len = (2 * (prog->put)) + 5;     // Add 3 to be safe.
-   curr = threadList(len);
-   next = threadList(len);
+   curr = threadList(listLen + variants, prog);
+   next = threadList(listLen + variants, prog);
 
-   S_ThrdMatchCfg matchesCfg0 = {.lst = NULL, .clone = TRUE, .newBufSize = maxMatches };
+   if(curr == NULL || next == NULL)       // Couldn't malloc() either list?
+   {
+      if(curr != NULL) { unThreadList(curr); }
+      if(next != NULL) { unThreadList(next); }
+      return E_RegexRtn_OutOfMemory;
+   }
+
+   if(ml == NULL)                         // Caller wants just yes/no?
+      { maxMatches = 0; }                 // then threads will hold no matches (so no malloc()s for them).
+
+   curr->byPriority = next->byPriority = BSET(flags, _RegexLT_Flags_MatchFirst);   // Leftmost-first? then threads run in order of preference.
+   curr->maxVariants = next->maxVariants = variants;
+
+   caps = (S_CaptureSlab){0};             // No capture sets, unless...
+
+   if(maxMatches > 0 &&                   // ...threads will hold matches? then get the slab they come from.
+      capsInit(capsNeeded(listLen + variants), maxMatches) == FALSE)
+   {
+      unThreadList(curr);
+      unThreadList(next);
+      return E_RegexRtn_OutOfMemory;
+   }
 
    // Make the 1st thread in and put the 1st opcode in it. Attach the start of the input string.
    addThread(curr,                     // to the current thread list
       newThread(  &(S_Thread){},
                   0,                   // PC starts at zero
-                  str,                 // From start of the input string
-                  0,                   // Loop/repeat count starts at 0. WIll increment if JMP back to reuse previous Chars-Box.
+                  from,                // From start of the input string, or wherever caller said.
+                  noRpts,              // Loop/repeat count starts at 0. WIll increment if JMP back to reuse previous Chars-Box.
                   NULL,                // No group start
-                  0,                   // Park program counter for sub-group at instruction zero.
-                  &matchesCfg0,        // Accumulate any matches here.
-                  _EatMismatches,      // Eat leading mismatches unless told otherwise.
+                  anchored ? prog->put : 0,  // Park program counter for sub-group at instruction zero; or, anchored, at none, so a group opened there is new.
+                  NULL,                // A new, empty, capture set; accumulate any matches there.
+                  anchored ? _StopAtMismatch : _EatMismatches,   // Eat leading mismatches unless told otherwise.
                   eMatchCase));        // Match case is the default.
 
    dbgPrint("------ Trace:\r\n"
@@ -760,7 +1387,7 @@ PRIVATE T_RegexRtn runOnce(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList
    BOOL matchedMinimal = FALSE;
 
    //if(ml != NULL) {ml->put = 0;}
-   U8 execCycles = 0;                     // Count how many times we renew the thread list.
+   U16 execCycles = 0;                    // Count how many times we renew the thread list.
                                                                         dbgPrint("\r\n%d: ---- [curr.put, next.put]: [%d %d]->[%d _]\r\n",
                                                                                                                   execCycles, curr->put, next->put, next->put);
    do {
@@ -769,7 +1396,7 @@ PRIVATE T_RegexRtn runOnce(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList
       C8 const       *sp;                 // Advance through input string.
       C8 const       *gs;                 // Start of a Subgroup in the current thread.
       C8 const       *cBoxStart;          // Start of current Char-Box (while 'strP' may be advanced past Box)
-      T_RepeatCnt    loopCnt = 0;         // Repeats loop count.
+      S_RptCnts      loopCnt = noRpts;    // Repeats loop count(s).
 
       T_ThrdListIdx  ti;
       BOOL addL, addR;
@@ -781,6 +1408,8 @@ PRIVATE T_RegexRtn runOnce(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList
       for(ti = 0; ti < curr->put; ti++)                                       // For each active thread.
       {
          S_Thread * thrd = &curr->ts[ti];                                     // the current Thread.
+         curr->ran = ti+1;                                                    // Any equivalent added now comes too late for this one; see addThread().
+         curr->ins = ti+1;                                                    // byPriority: this thread's forks run next; see forkThread().
 
          pc = thrd->pc;                                                       // The program counter and...
          sp = thrd->sp;                                                       // ..it's read pointer (to the source string)
@@ -795,12 +1424,6 @@ PRIVATE T_RegexRtn runOnce(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList
             dbgPrint("   %d(%d:) %s Deleted!\r\n", ti, pc, prntInstr((C8[30]){}, ip));
             continue; }
 
-         /* Premake a matches-cfg for most of the addThread()s below. Default is that
-            thrd->matches is cloned into a new buffer[maxMatches]
-         */
-         S_ThrdMatchCfg dfltMatchCfg = {
-            .lst = &thrd->matches, .clone = TRUE, .newBufSize = maxMatches };
-
          cBoxStart = sp;
 
          switch(ip->opcode )                          // Opcode is?...
@@ -828,24 +1451,19 @@ PRIVATE T_RegexRtn runOnce(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList
                         char in the input string after the match (sp). We just got our leading match on this
                         Char-Box so a subsequent mismatch should terminate this thread => '_StopAtMismatch'.
                      */
-                     newL = newThread(&(S_Thread){}, pc+1, sp, loopCnt, gs, thrd->lastOpensSub, &dfltMatchCfg, _StopAtMismatch, thrd->caseRule);
+                     newL = newThread(&(S_Thread){}, pc+1, sp, loopCnt, gs, thrd->lastOpensSub, &thrd->matches, _StopAtMismatch, thrd->caseRule);
 
                      if(!soloAnchor(&ip->charBox))
                         { addLeadMatch(newL, str, cBoxStart, cBoxStart, __LINE__, "!soloAnchor(&ip->charBox)"); }
 
-                     if(ip->closesGroup)                                         // This chars-list closed a subgroup?
-                     {
-                        if(ip->opensGroup)                                       // and this chars-list also opened a subgroup
-                        {
-                           newL->subgroupStart = cBoxStart;
-                           addMatch(newL, str, cBoxStart, sp-1, __LINE__, "ip->opensGroup");
-                        }
-                     }
-                     else if(ip->opensGroup && newL->subgroupStart == NULL)      // else this path opens a subgroup now?
+                     if(ip->opensGroup)                                          // This chars-list opens a subgroup? (this is the 1st time, leading matches aside)
                      {
-                        newL->subgroupStart = sp-1;                              // Mark the start -> will be copied into the fresh thread
+                        newL->lastOpensSub = pc;                                 // then mark it, as below...
+                        newL->subgroupStart = cBoxStart;                         // ...and where it starts.
                      }
-                     thrdL = addThread(next, newL);                              // Add thread we made to 'next'
+                     if(ip->closesGroup && newL->subgroupStart != NULL)          // This chars-list closed a subgroup?
+                        { closeGroup(newL, ip, prog, str, sp, __LINE__); }
+                     thrdL = forkThread(next, newL);                             // Add thread we made to 'next'
 
                      /* ---- Right-fork
 
@@ -855,13 +1473,14 @@ PRIVATE T_RegexRtn runOnce(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList
                         or a{2,}. For these forking here needlessly adds threads on each cycle; the current thread is
                         already counting the maximal match.
                      */
-                     if( *(cBoxStart+1) != '\0' &&                               // At least one more char in the input string? AND
+                     if( *cBoxStart != '\0' &&                                   // Not at the end (an empty CharBox matches there)? AND
+                        *(cBoxStart+1) != '\0' &&                               // at least one more char in the input string? AND
+                        cBoxStart+1 <= lastStart &&                              // enough left there for a match? AND
                         !rightOpen(&ip->repeats))                                // not right-open?
                      {
                         addR = TRUE;                                             // then add a new thread to 'next' applying existing CharBox start at this new char.
-                        dfltMatchCfg.clone = TRUE;                               // Spawning a new thread so clone match list of the existing thread (instead of referencing it).
                         thrdR = addThread(next,
-                           newThread(&(S_Thread){}, pc, cBoxStart+1, loopCnt, gs, thrd->lastOpensSub, &dfltMatchCfg,
+                           newThread(&(S_Thread){}, pc, cBoxStart+1, loopCnt, gs, thrd->lastOpensSub, &thrd->matches,
                               matchedMinimal ?                                   // Already got a (minimal) match?
                                  _StopAtMismatch : _EatMismatches, thrd->caseRule ) );           // then end this thread upon hitting a mismatch -
                      }
@@ -869,18 +1488,16 @@ PRIVATE T_RegexRtn runOnce(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList
                   else                                                           // else failed to match this 1st Chars_Box?
                   {
                      if(*sp == '\0') {                                           // Hit end-of-string too?
-                        rtn = E_RegexRtn_NoMatch;                                // then didn't even get a leading match. We are done.
-                        goto CleanupAndRtn;
-                     }
+                        }                                                        // then no leading match from here; this thread is done. (Others may yet match.)
                      else if(sp >= mustEnd ) {                                   // else reached limit on length of input string?
                         rtn = E_RegexRtn_BadInput;                               // then input was too long; we are done.
                         goto CleanupAndRtn;
                      }
-                     else if( *(cBoxStart+1) != '\0')                            // else if there's at least one more char in the input string?...
+                     else if( *(cBoxStart+1) != '\0' && cBoxStart+1 <= lastStart)  // else if there's at least one more char in the input string, and enough for a match?...
                      {                                                           // ...then advance to this char retry the existing CharsBox
                         addR = TRUE;                                             // starting at this new char.
                         thrdR = addThread( next,
-                           newThread(&(S_Thread){}, pc, cBoxStart+1, loopCnt, gs, thrd->lastOpensSub, &dfltMatchCfg,
+                           newThread(&(S_Thread){}, pc, cBoxStart+1, loopCnt, gs, thrd->lastOpensSub, &thrd->matches,
                                        matchedMinimal ? _StopAtMismatch : _EatMismatches, thrd->caseRule));
                      }
                   }                              // --- else continue below.
@@ -891,7 +1508,7 @@ PRIVATE T_RegexRtn runOnce(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList
                                                                         printTriad(cBoxStart),
                                                                         prntAddThrd((C8[25]){}, addL==FALSE, cput, pc+1, thrdL),
                                                                         prntAddThrd((C8[25]){}, addR==FALSE, addL==FALSE ? cput : cput+1, pc, thrdR),
-                                                                        loopCnt,
+                                                                        loopCnt.hi,
                                                                         addL == TRUE ? sprntMatches((C8[30]){}, &newL->matches ) : "");
                }
                else                                                  // else we got the 1st match (above)
@@ -906,14 +1523,18 @@ PRIVATE T_RegexRtn runOnce(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList
                         the matched segment.
 
                         Also, this was a char box; so bump the repeat count used by 'Split'to test repeat-ranges.
+
+                        If it took any chars then this thread has its leading match; it must not eat mismatches
+                        should it loop back to the 1st Char-Box e.g '([ac]*.)+'.
                      */
-                     S_Thread *newL = newThread(&(S_Thread){}, pc+1, sp, loopCnt, gs, thrd->lastOpensSub, &dfltMatchCfg, thrd->eatMismatches, thrd->caseRule);
+                     S_Thread *newL = newThread(&(S_Thread){}, pc+1, sp, loopCnt, gs, thrd->lastOpensSub, &thrd->matches,
+                                                sp > cBoxStart ? _StopAtMismatch : thrd->eatMismatches, thrd->caseRule);
 
                      /* If the Chars-Box we matched is the 1st AND if it contains something besides an anchor then
                         add a (leading) zero-length match interval i.e [box-start, box-start]. This match will be updated
                         to a global match if and when the regex is exhausted.
                      */
-                     if(thrd->matches.put == 0 && !soloAnchor(&ip->charBox))
+                     if(!hasCapture(&thrd->matches, 0) && !soloAnchor(&ip->charBox))
                         { addMatch(newL, str, cBoxStart, cBoxStart, __LINE__, "(thrd->matches.put == 0..."); }
 
                      /* If this instruction opens a sub-group and we did NOT loop directly back to this instruction
@@ -931,14 +1552,14 @@ PRIVATE T_RegexRtn runOnce(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList
                      // If this instruction closes a subgroup AND there was ab earlier match opening a subgroup
                      // then add a sub-match from 'subgroupStart' to group close at 'sp-1'.
                      if(ip->closesGroup && newL->subgroupStart != NULL)
-                        { addMatch(newL, str, newL->subgroupStart, sp-1, __LINE__, "ip->closesGroup"); }      // (sp-1, cuz src pointer is one-past subgroup close)
+                        { closeGroup(newL, ip, prog, str, sp, __LINE__); }
 
                                                                      dbgPrint("   %d(%d:) %s ==  %s    \t[ --> %d(%d:)" _SubStartTag "%c ,_ {%d}] \tLM%s\r\n",
                                                                         ti, pc, printRegexSample(&ip->charBox), printTriad(cBoxStart), next->put, pc+1,
                                                                         newL->subgroupStart == NULL ? '_' : *(newL->subgroupStart),
-                                                                        loopCnt,
+                                                                        loopCnt.hi,
                                                                         sprntMatches((C8[30]){}, &newL->matches ));
-                     addThread(next, newL);                                      // Add thread we made to 'next'
+                     forkThread(next, newL);                                     // Add thread we made to 'next'
                   }
                   else                                                           // Source chars did not match? OR input string too long?
                   {                                                              // then we are done with this branch of code execution; ...
@@ -954,7 +1575,83 @@ PRIVATE T_RegexRtn runOnce(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList
                break;
             } // case OpCode_CharBox:
 
+            case OpCode_Span:                         // --- A run of a single char or class e.g '\d+', '[A-F]{2,4}'
+            {
+               /* The compiler makes a 'Span' only where no char it accepts can also start what follows.
+                  So there's just one way to match; eat the longest run there is, up to 'max'. No need to fork
+                  a thread for each char.
+
+                  If eating leading mismatches then look at the whole run. If the run is too long, then only the
+                  last 'max' chars of it can be followed by the continuation; unless the continuation is 'Match',
+                  when the match is the first 'max' chars.
+               */
+               S_Thread *newL = NULL;
+               S_Thread const *thrdR = NULL;
+               T_ThrdListIdx cput = next->put;
+               addL = FALSE; addR = FALSE;
+
+               BOOL eating = ip->charBox.eatUntilMatch && thrd->eatMismatches;
+               U16 run = spanRun(ip->charBox.segs, sp, mustEnd, eating ? _Repeats_Unlimited : ip->repeats.max, thrd->caseRule);
+               C8 const *runEnd = sp + run;
+
+               if(runEnd >= mustEnd) {                                           // Input too long?
+                  rtn = E_RegexRtn_BadInput;                                     // then we are done running the program
+                  goto CleanupAndRtn; }
+
+               if(eating && run == 0 && *sp == '\0')                             // Eating, but hit end-of-string?
+                  { break; }                                                     // then no leading match from here; this thread is done. (Others may yet match.)
+
+               if(run >= ip->repeats.min)                                        // Got at least the min repeats?
+               {
+                  U16 take = run < ip->repeats.max ? run : ip->repeats.max;
+                  C8 const *from = eating && prog->buf[ip->left].opcode != OpCode_Match
+                                    ? runEnd - take                              // Take the last 'max' of the run...
+                                    : sp;                                        // ...or the 1st.
+                  addL = TRUE;
+                  newL = newThread(&(S_Thread){}, ip->left, from + take, noRpts, gs, thrd->lastOpensSub, &thrd->matches,
+                                   eating || take > 0 ? _StopAtMismatch : thrd->eatMismatches, thrd->caseRule);   // Took chars? then have a leading match; eat no more.
+
+                  if(eating)                                                     // Got our leading match?
+                     { addLeadMatch(newL, str, from, from, __LINE__, "Span, eating"); }
+                  else if(take > 0 && !hasCapture(&thrd->matches, 0))            // else the 1st chars matched by the regex?
+                     { addMatch(newL, str, from, from, __LINE__, "Span, 1st match"); }
+
+                  if(take == 0)                                                  // Ate nothing? e.g 'a*' vs 'b'
+                     { forkThread(curr, newL); }                                 // then continue rightaway; same as a 'Split'.
+                  else
+                     { forkThread(next, newL); }                                 // else continue on the next cycle, with 'sp' past the run.
+
+                  if(prog->buf[ip->left].opcode == OpCode_Match)                 // Span is last before 'Match'?
+                     { matchedMinimal = TRUE; }                                  // then we have at least a minimal match; see 'Jmp', below.
+               }
+
+               /* If eating leading mismatches, and don't yet have a match, then retry past the run. Nothing can start
+                  inside the run and do better; and the char which ended the run isn't in it.
+               */
+               if(eating && !matchedMinimal && *runEnd != '\0' && *(runEnd+1) != '\0' && runEnd+1 <= lastStart)
+               {
+                  addR = TRUE;
+                  thrdR = addThread(next,
+                     newThread(&(S_Thread){}, pc, runEnd+1, loopCnt, gs, thrd->lastOpensSub, &thrd->matches, _EatMismatches, thrd->caseRule));
+               }
+                                                                     dbgPrint("   %d(%d:) %s %s  %s    \t[ %s %s,%s] %u chars\t\tLM%s\r\n",
+                                                                        ti, pc,
+                                                                        printRegexSample(&ip->charBox),
+                                                                        eating ? "(<" : (addL ? "==" : "!="),
+                                                                        printTriad(cBoxStart),
+                                                                        addL && run == 0 ? "+>" : "-->",
+                                                                        prntAddThrd((C8[25]){}, addL==FALSE, cput, ip->left, NULL),
+                                                                        prntAddThrd((C8[25]){}, addR==FALSE, addL==FALSE ? cput : cput+1, pc, thrdR),
+                                                                        run,
+                                                                        addL == TRUE ? sprntMatches((C8[30]){}, &newL->matches ) : "");
+               break;
+            } // case OpCode_Span:
+
             case OpCode_Match:
+               if(end != NULL && cBoxStart != end) {                             // Must end elsewhere? (see runTwoPhase())
+                  dbgPrint("   %d(%d:) Match!:             -- not at the end wanted; dropped\r\n", ti, pc);
+                  break; }                                                       // then this thread is done; it's not the match.
+
                rtn = E_RegexRtn_Match;
 
                /* Mark that we got at least a minimal match. After this any (live) thread will terminate
@@ -963,46 +1660,57 @@ PRIVATE T_RegexRtn runOnce(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList
                */
                matchedMinimal = TRUE;
 
+               if(ml == NULL) {                                                  // Capture-free? Any thread reaching here is a match...
+                  dbgPrint("   %d(%d:) Match!:             -- capture-free; done *****\r\n", ti, pc);
+                  goto CleanupAndRtn; }                                          // ...so no need to run the rest.
+
                /* If caller supplied a hook for a match list then we will have malloced for a match list.
                   Fill the list with the matches which this thread found. If we are looking for a
                   maximal match on the entire input string then this match may not be the first.
                   So empty 'ml' before adding the matches from this thread.
                */
+               if(thrd->matches.ms == NULL) {                                    // This thread's matches couldn't be malloc()ed?
+                  rtn = E_RegexRtn_OutOfMemory;                                  // then we can't say where it matched.
+                  goto CleanupAndRtn; }
+
                if(ml != NULL)                                                    // 'ml' references a (malloced) match list?
                {
-#if 0
-                  ml->put = 0;                                                   // then empty this list (in case an earlier thread matched and filled it)
-
                   if(execCycles == 0 && ti == 0)                                 // First instruction AND 1st time thru? (is 'OpCode_Match')
                      { addMatch(thrd, str, str, str+strlen(str)-1, __LINE__, "(execCycles == 0 && ti == 0)"); }             // then it's the empty regex; matches everything, so add the whole string.
-                  else                                                           // else it's a possible global match....
-                     { thrd->matches.ms[0].len = cBoxStart - str - thrd->matches.ms[0].start; }    // ...we already marked the start in matches.ms[0]; add the length.
-
-                  // Copy any matches from this thread into the master
-                  U8 i;
-                  for(i = 0; i < thrd->matches.put; i++)
-                     { copyInMatch(ml, &thrd->matches.ms[i], str); }
-#else
-                  if(execCycles == 0 && ti == 0)                                 // First instruction AND 1st time thru? (is 'OpCode_Match')
-                     { addMatch(thrd, str, str, str+strlen(str)-1, __LINE__, "(execCycles == 0 && ti == 0)"); }             // then it's the empty regex; matches everything, so add the whole string.
-                  else                                                           // else it's a possible global match....
-                     { thrd->matches.ms[0].len = cBoxStart - str - thrd->matches.ms[0].start; }    // ...we already marked the start in matches.ms[0]; add the length.
-
-                  if(ml->put == 0 || thrd->matches.ms[0].len > ml->matches[0].len)
+                  else if(ownMatches(&thrd->matches))                            // else it's a possible global match; on a set of its own, as it's changed....
                   {
-                     copyMatchToList(&ml->matches[0], &thrd->matches.ms[0], str);
-                     if(ml->put == 0) {ml->put = 1;}
+                     if(hasCapture(&thrd->matches, 0))                           // ...we already marked the start in matches.ms[0]?
+                        { thrd->matches.ms[0].len = cBoxStart - str - thrd->matches.ms[0].start; }    // then add the length.
+                     else                                                        // else matched without eating a char e.g 'a*' on "b"
+                        { setSlot(&thrd->matches, 0, &(S_Match){.start = cBoxStart - str, .len = 0}); }   // so it's an empty match here.
                   }
-                  // Copy any matches from this thread into the master
-                  U8 i;
-                  for(i = 1; i < thrd->matches.put; i++)
-                     { copyInMatch(ml, &thrd->matches.ms[i], str); }
-#endif
+
+                  /* Copy this thread's captures into the master, slot for slot. A global match which displaces the one
+                     'ml' holds brings it's own; see displaces(). (A counting-set which dropped it's oldest counts now
+                     started later than the match they made; see dropOldestCounts(). Whatever it matches doesn't
+                     displace that one.)
+                  */
+                  copySlotsToList(ml, &thrd->matches, str, ml->put == 0 || displaces(&thrd->matches.ms[0], &ml->matches[0], curr->byPriority));
+               }
+
+               /* Leftmost-first, the threads behind this one are less preferred; whatever they might match, this
+                  match beats it. So drop them now. Only threads ahead of this one, now in 'next', can still win.
+                  But an empty match doesn't beat a real one which starts later (see displaces()); so threads
+                  which have yet to start a match, i.e are still at the regex's leading chars, are kept.
+               */
+               if(curr->byPriority)
+               {
+                  BOOL empty = ml != NULL && hasCapture(&thrd->matches, 0) && thrd->matches.ms[0].len == 0;
+                  T_ThrdListIdx c;
+                  for(c = ti+1; c < curr->put; c++) {
+                     if(curr->ts[c].deleted == FALSE && (empty == FALSE || hasCapture(&curr->ts[c].matches, 0))) {
+                        curr->ts[c].deleted = TRUE;
+                        countStat(pruned); }}
                }
 
                if( flags & _RegexLT_Flags_MatchLongest )
                {
-                  if(next->put == 0)
+                  if(next->put == 0 && ti+1 == curr->put)                        // Nothing queued, nor left to run this step?
                   {
                      dbgPrint("   %d(%d:) Match!:             -- Final, longest *****\r\n", ti, pc);
                      goto EndsCurrentStep;
@@ -1025,13 +1733,12 @@ PRIVATE T_RegexRtn runOnce(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList
 
             case OpCode_Jmp:                          // --- Jump
             {
-               dfltMatchCfg.clone = FALSE;
                S_Thread * newT;
                T_ThrdListIdx cput = curr->put;
 
-               addThread(curr, newT = newThread(&(S_Thread){}, ip->left, sp,
-                                          ip->left < pc ? loopCnt+1 : loopCnt,  // If jumping back then bump the loop cnt.
-                                          gs, thrd->lastOpensSub, &dfltMatchCfg, thrd->eatMismatches, thrd->caseRule));
+               forkThread(curr, newT = newThread(&(S_Thread){}, ip->left, sp,
+                                          ip->left < pc ? rptsBump(loopCnt) : loopCnt,  // If jumping back then bump the loop cnt.
+                                          gs, thrd->lastOpensSub, &thrd->matches, thrd->eatMismatches, thrd->caseRule));
 
                                                                      dbgPrint("   %d(%d:) jmp: %d     @ %s    \t[ +>  %d(%d:),_]\t\t %s%s \tM%s\r\n",
                                                                               ti, pc, ip->left,
@@ -1079,19 +1786,49 @@ PRIVATE T_RegexRtn runOnce(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList
 
                S_Thread *newL = NULL; S_Thread *newR = NULL;
 
+               /* If this thread holds a range of counts (see S_RptCnts) then the youngest decides whether
+                  to loop again and the oldest whether to move on. Those counts which are already at 'max' may
+                  not loop again and are dropped from the looping thread.
+               */
                // ----- Left Fork? Loop back.
-               if(!ip->repeats.cntsValid || loopCnt < ip->repeats.max)        // Unconditional repeat? OR repeat is conditional AND have not tried max-repeats of current chars-block?
+               if(!ip->repeats.cntsValid || loopCnt.lo < ip->repeats.max)     // Unconditional repeat? OR repeat is conditional AND have not tried max-repeats of current chars-block?
                {
-                  dfltMatchCfg.clone = FALSE;
-                  addThread(curr, newL = newThread(&(S_Thread){}, ip->left, sp, ip->left < pc ? loopCnt+1 : loopCnt, gs, thrd->lastOpensSub, &dfltMatchCfg, thrd->eatMismatches, thrd->caseRule));
+                  BOOL dropsCnts = ip->repeats.cntsValid && loopCnt.hi >= ip->repeats.max;   // Oldest count(s) are done looping?
+
+                  // Looping back on a counted repeat bumps the count. A '+' has no count; it may loop back
+                  // over e.g the '{2}' of '((ab){2}c)+', which must then count from 0 again.
+                  newL = newThread(&(S_Thread){}, ip->left, sp, ip->left < pc && ip->repeats.cntsValid ? rptsBump(loopCnt) : loopCnt, gs, thrd->lastOpensSub, &thrd->matches, thrd->eatMismatches, thrd->caseRule);
+
+                  if(dropsCnts)
+                     { dropOldestCounts(newL, ip->repeats.max-1, prog, ip->left); }
+                  forkThread(curr, newL);
                   addL = TRUE;
                }   // then this thread loops back to the current chars-block.
 
-               // ----- Right Fork? Forward.
-               if(!ip->repeats.cntsValid || loopCnt >= ip->repeats.min)       // Unconditional repeat? OR repeat is conditional AND have tried at least min-repeats of current chars-block.
+               /* ----- Right Fork? Forward.
+
+                  But not if possessive and every count loops again and the loop would match next. Then
+                  the loop must go on; a thread which left here could only match what the loop should have.
+               */
+               BOOL mustLoop =
+                  ip->repeats.possessive && addL &&
+                  (!ip->repeats.cntsValid || loopCnt.hi < ip->repeats.max) &&
+                  loopTakesMore(prog, ip, sp, str, mustEnd, thrd->caseRule);
+
+               if(mustLoop)
+                  { countStat(pruned); }
+               else if(!ip->repeats.cntsValid || loopCnt.hi >= ip->repeats.min)    // Unconditional repeat? OR repeat is conditional AND have tried at least min-repeats of current chars-block.
                {
-                  dfltMatchCfg.clone = TRUE;
-                  addThread(curr, newR = newThread(&(S_Thread){}, ip->right, sp, 0, gs, thrd->lastOpensSub, &dfltMatchCfg, thrd->eatMismatches, thrd->caseRule));
+                  newR = newThread(&(S_Thread){}, ip->right, sp, noRpts, gs, thrd->lastOpensSub, &thrd->matches, thrd->eatMismatches, thrd->caseRule);
+
+                  S_Instr const *skipped = &prog->buf[ip->left];
+                  if(ip->left > pc && skipped->opcode == OpCode_CharBox &&      // Skips a CharBox, e.g the 'b*' of '(ab*)'... AND
+                     skipped->closesGroup && !skipped->opensGroup &&            // that closes a group it didn't open...
+                     skipped->charBox.closesPastRpt &&                          // ...with it's repeat inside the group? AND
+                     newR->lastOpensSub != prog->put && newR->subgroupStart != NULL)   // that group is open?
+                     { closeGroup(newR, skipped, prog, str, sp, __LINE__); }    // then it closes here, without that CharBox.
+
+                  forkThread(curr, newR);
                   addR = TRUE;
                }  // then will now also attempt to match the next text block.
                                                                      dbgPrint("   %d(%d:) split(%d %d) @ %s    \t[ +>  %s,%s]\t %s%s \tLM%s \tRM%s\r\n",
@@ -1126,12 +1863,17 @@ EndsCurrentStep:
          Instruction by different routes. There's no point in propagating each of these duplicates;
          they will take the same same path.
       */
+      if(curr->overflowed || next->overflowed) {   // Dropped a thread? (see addThread())
+         rtn = E_RegexRtn_RanTooLong;               // then we can't trust any result.
+         goto CleanupAndRtn; }
+
       removeDuplicateThreads(next, prog);
       clearThreadList(curr);                       // Clear current list; to be populated from 'next'
       swapPtr(&curr, &next);                       // Make 'next' the current list - go round again.
 
       // Break if too many cycles of the thread list. Something badly wrong; as this is based of the
       // length of the input string.
+      countStat(cycles);
       if(++execCycles > prog->maxRunCnt) {
          rtn = E_RegexRtn_RanTooLong;
          goto CleanupAndRtn; }
@@ -1141,8 +1883,10 @@ EndsCurrentStep:
 
 CleanupAndRtn:
    clearThreadList(curr);
+   clearThreadList(next);                 // May hold threads, if we quit mid-cycle.
    unThreadList(curr);
    unThreadList(next);
+   capsUnInit();
    return rtn;
 }
 
@@ -1158,8 +1902,245 @@ PRIVATE void swapML(RegexLT_S_MatchList **a, RegexLT_S_MatchList **b)
 PRIVATE void addToMatchIdxs(RegexLT_S_MatchList *l, RegexLT_T_MatchIdx n)
 {
    U8 c;
-   for(c = 0; c < l->put; c++)
-      { l->matches[c].idx += n; }
+   for(c = 0; c < l->put; c++) {
+      if(l->matches[c].at != NULL) {                  // Skip empty capture slots.
+         l->matches[c].idx += n; }}
+}
+
+/* ----------------------------------- runTwoPhase ---------------------------------
+
+   Run 'prog' on 'str' into 'ml' in (up to) two passes.
+
+   The 1st pass tracks just the global match; each thread holds a single match slot, so
+   no sub-matches are recorded or merged. If there's no match, or no groups are to be
+   recorded ('maxMatches' is 1) then that's the whole answer.
+
+   Otherwise a 2nd pass, with full captures, extracts the sub-matches. It is anchored where the
+   global match starts, and must end where it ends; so it doesn't pay for captures over the
+   (mismatched) input before that, and it can't settle on some other match from there.
+*/
+#define _GlobalMatchOnly 1
+
+PRIVATE T_RegexRtn runTwoPhase(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList *ml, U8 maxMatches, RegexLT_T_Flags flags)
+{
+   T_RegexRtn rtn;
+
+   if( (rtn = runOnce(prog, str, str, NULL, ml, _GlobalMatchOnly, flags, FALSE)) != E_RegexRtn_Match ||   // No match (or some error)? OR
+       maxMatches <= _GlobalMatchOnly)                                                    // no sub-matches to find?
+      { return rtn; }                                                                     // then we are done.
+   else
+   {
+      C8 const *from = ml->matches[0].at;                                                 // Global match starts here...
+      C8 const *end = from + ml->matches[0].len;                                          // ...and ends here.
+      ml->put = 0;                                                                        // Clear the global; will be found again...
+      return runOnce(prog, str, from, end, ml, maxMatches, flags, TRUE);                  // ...by this full-capture run, with the sub-matches.
+   }
+}
+
+/* ----------------------------------- runFromEnd ---------------------------------
+
+   For '_RegexLT_Flags_MatchLast'. Try 'prog' anchored at each position of 'str', from the end
+   back; the 1st to match is the last match. So finding e.g the last timestamp on a line costs
+   the tail of the line, not a search of the whole line for each match in it.
+
+   But e.g '\d+' on "ab123" matches at '3', then '23' and '123'. So, having a match, step back
+   while the match one earlier ends no sooner. Then, from where that starts, get the captures.
+*/
+PRIVATE T_RegexRtn runFromEnd(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList *ml, U8 maxMatches, RegexLT_T_Flags flags)
+{
+   size_t len = EndStr(str) - str;
+   size_t i = prog->anchoredStart         // Try from the end, less the fewest chars a match can have...
+      ? 0 : len - prog->minLen;           // ...or, if it must start with '^', from the start only...
+   size_t at = 0, end = 0;                // ...the last match starts and ends here...
+   BOOL got = FALSE;                      // ...once we have one.
+   T_RegexRtn rtn;
+
+   while(1)
+   {
+      ml->put = 0;
+      if( (rtn = runOnce(prog, str, str + i, NULL, ml, _GlobalMatchOnly, flags, TRUE)) == E_RegexRtn_Match)
+      {
+         size_t e = ml->matches[0].idx + ml->matches[0].len;
+
+         if(got == TRUE && e < end)       // Ends before the match we have?
+            { break; }                    // then that's the last one.
+         at = i; end = e; got = TRUE;     // else it is, or covers, the last match so far.
+      }
+      else if(rtn != E_RegexRtn_NoMatch)  // Some error?
+         { return rtn; }
+      else if(got == TRUE)                // else no match here; but had one just after?
+         { break; }                       // then that's the last.
+
+      if(i == 0)                          // Tried from the start of 'str'?
+         { break; }                       // then we are done.
+      i--;
+   }
+
+   ml->put = 0;
+   return got == FALSE
+      ? E_RegexRtn_NoMatch
+      : runOnce(prog, str, str + at, str + end, ml, maxMatches, flags, TRUE);  // Again just the last match, with any captures; as runTwoPhase().
+}
+
+/* ----------------------------------- regexlt_threadsNeeded ---------------------------------
+
+   The threads each list needs to run 'prog' over 'inputLen' chars; 'maxThreads' for each place
+   in the input its threads may be at (see threadPlaces()). That's no more places than there are
+   chars, plus the end.
+*/
+PUBLIC U16 regexlt_threadsNeeded(S_InstrList const *prog, size_t inputLen)
+{
+   if(inputLen > regexlt_cfg->maxStrLen)                       // Can't run past 'maxStrLen' anyway.
+      { inputLen = regexlt_cfg->maxStrLen; }
+
+   size_t places = prog->threadPlaces == 0 || prog->threadPlaces > inputLen + 1
+      ? inputLen + 1
+      : prog->threadPlaces;
+
+   size_t n = (size_t)prog->maxThreads * places;
+   return n > _MaxThreadList ? _MaxThreadList : (U16)n;
+}
+
+/* ----------------------------------- regexlt_runMemRequired ---------------------------------
+
+   The most heap one runOnce() of a program with thread lists 'maxThreads' long can hold, with
+   threads holding 'maxMatches'. That's the 2 thread lists, as threadList() gets them, with any
+   room for variants (see variantsRoom()), and the slab of capture sets, as capsInit() gets it.
+*/
+PUBLIC size_t regexlt_runMemRequired(U16 maxThreads, U8 maxMatches)
+{
+   maxThreads += variantsRoom(maxThreads, maxMatches);
+   size_t len = maxThreads;
+   return
+      2 * (len * (sizeof(S_Thread)+2) + sizeof(S_ThreadList)) +     // 'curr' and 'next'...
+      (maxMatches == 0 ? 0 : capsBytes(capsNeeded(maxThreads), maxMatches));   // ...and the capture sets their threads share.
+}
+
+/* ----------------------------------- findLiteral ---------------------------------
+
+   Return TRUE if the 'lit' is in the 'n' chars at 'str'.
+*/
+PRIVATE BOOL findLiteral(C8 const *str, size_t n, S_Literals const *lit)
+{
+   C8 const *end = str + n;
+
+   while(str + lit->len <= end)
+   {
+      if( (str = memchr(str, lit->start[0], end - str)) == NULL ||   // No 1st char? OR
+          str + lit->len > end)                                      // too near the end for the rest?
+         { return FALSE; }                                           // then it's not there.
+      if(memcmp(str, lit->start, lit->len) == 0)
+         { return TRUE; }
+      str++;
+   }
+   return FALSE;
+}
+
+/* ----------------------------------- hasRequired ---------------------------------
+
+   Return FALSE if 'str', 'len' long, lacks any of the literals every match of 'prog' must hold
+   (see regexlt_analyzeProgram()); then it can't match and needn't be run.
+*/
+PRIVATE BOOL hasRequired(S_InstrList const *prog, C8 const *str, size_t len)
+{
+   U8 c;
+   for(c = 0; c < prog->numRequired; c++) {
+      if(findLiteral(str, len, &prog->required[c]) == FALSE) {
+         return FALSE; }}
+   return TRUE;
+}
+
+/* ----------------------------------- runShiftAnd ---------------------------------
+
+   For 'E_Engine_ShiftAnd'. Run 'prog', a fixed run of 'minLen' chars, over 'str', 'len' long,
+   bit-parallel. Bit 'n' of 'd' is set where the input so far ends with the 1st 'n'+1 chars of
+   the run; so a match ends where the top bit is set. Every match is the same length; so the
+   1st to end is the leftmost, and the longest. With '_RegexLT_Flags_MatchLast' the last to end
+   is the last match.
+
+   If 'ml' put the match in it, as the global match; there are no groups.
+*/
+PRIVATE T_RegexRtn runShiftAnd(S_InstrList const *prog, C8 const *str, size_t len, RegexLT_S_MatchList *ml, RegexLT_T_Flags flags)
+{
+   U32 d = 0, top = 1UL << (prog->minLen - 1);
+   BOOL last = ml != NULL && BSET(flags, _RegexLT_Flags_MatchLast);
+   size_t i, end = 0;
+   BOOL got = FALSE;
+
+   for(i = 0; i < len; i++)
+   {
+      U8 ch = str[i];
+
+      d = ((d << 1) | 1) & prog->masks[ch < _ShiftAnd_Chars ? ch : _ShiftAnd_Chars];
+      countStat(cycles);
+
+      if((d & top) != 0)                        // A match ends here?
+      {
+         got = TRUE;
+         end = i;
+         if(!last)                              // Want the 1st?
+            { break; }                          // then that's it.
+      }
+   }
+
+   if(got == FALSE)
+      { return E_RegexRtn_NoMatch; }
+
+   if(ml != NULL)
+   {
+      size_t at = end + 1 - prog->minLen;
+      ml->matches[0] = (RegexLT_S_Match){.at = str + at, .idx = at, .len = prog->minLen};
+      ml->put = 1;
+   }
+   return E_RegexRtn_Match;
+}
+
+/* ----------------------------------- runLiteral ---------------------------------
+
+   For 'E_Engine_Literal'. 'prog' is a plain string, its 'prefix'. Find it in 'str', 'len' long,
+   by Horspool; compare the window's last char 1st, then the rest and, on a mismatch, slide the
+   window by the skip for that last char (see chooseEngine()). A 1-char string is just memchr().
+   With '_RegexLT_Flags_MatchLast' keep sliding, by 1 past each find, to the last.
+
+   If 'ml' put the match in it, as the global match; there are no groups.
+*/
+PRIVATE T_RegexRtn runLiteral(S_InstrList const *prog, C8 const *str, size_t len, RegexLT_S_MatchList *ml, RegexLT_T_Flags flags)
+{
+   S_Literals const *lit = &prog->prefix;
+   T_CharSegmentLen n = lit->len;
+   C8 ends = lit->start[n-1];
+   BOOL last = ml != NULL && BSET(flags, _RegexLT_Flags_MatchLast);
+   C8 const *end = str + len, *at = str, *got = NULL;
+
+   while(at + n <= end)
+   {
+      countStat(cycles);
+
+      if(n == 1)                                                     // Just 1 char?
+      {
+         if( (at = memchr(at, ends, end - at)) == NULL)              // then memchr() it.
+            { break; }
+      }
+      else if(at[n-1] != ends || memcmp(at, lit->start, n-1) != 0)   // else window doesn't hold it?
+      {
+         at += prog->skips[(U8)at[n-1]];                             // then slide on.
+         continue;
+      }
+      got = at;                                                      // Found.
+      if(!last)                                                      // Want the 1st?
+         { break; }                                                  // then that's it.
+      at++;
+   }
+
+   if(got == NULL)
+      { return E_RegexRtn_NoMatch; }
+
+   if(ml != NULL)
+   {
+      ml->matches[0] = (RegexLT_S_Match){.at = got, .idx = got - str, .len = n};
+      ml->put = 1;
+   }
+   return E_RegexRtn_Match;
 }
 
 /* ----------------------------------- regexlt_runCompiledRegex ---------------------------------
@@ -1170,12 +2151,51 @@ PRIVATE void addToMatchIdxs(RegexLT_S_MatchList *l, RegexLT_T_MatchIdx n)
 
    If '_RegexLT_Flags_MatchLongest' is the repeat until no more matches and return the
    longest match.
+
+   If '_RegexLT_Flags_MatchLast' (alone) then search from the end of 'str' back; see runFromEnd().
+
+   But first, if 'str' lacks a literal which any match must hold, it's 'NoMatch' without a run.
+
+   If 'ml' == NULL there's no list to fill; just say whether there's a match, capture-free.
+   Otherwise each search is two-phase (see runTwoPhase()). Only the capture groups in 'groups'
+   are recorded; threads hold a slot for just those.
+
+   A program which regexlt_analyzeProgram() gave to shift-and is run by runShiftAnd(), and a
+   plain string by runLiteral(), unless groups are wanted, or the last of the longest; those
+   need the thread VM. runLiteral() finds the string itself, so skips the check for it.
 */
-PUBLIC T_RegexRtn regexlt_runCompiledRegex(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList **ml, U8 maxMatches, RegexLT_T_Flags flags)
+PUBLIC T_RegexRtn regexlt_runCompiledRegex(S_InstrList *prog, C8 const *str, RegexLT_S_MatchList **ml, RegexLT_T_Groups groups, RegexLT_T_Flags flags)
 {
    T_RegexRtn rtn, r2;
 
-   rtn = runOnce(prog, str, *ml, maxMatches, flags);           // Try to match at least once.
+   size_t len = strlen(str);
+   U8 maxMatches = mapGroups(prog, groups);                    // Thread slots for the global match and the groups wanted.
+
+   BOOL noVM =
+      prog->engine != E_Engine_NFA &&                          // Program has a faster engine? AND
+      (ml == NULL || *ml == NULL || maxMatches == _GlobalMatchOnly) &&                   // no groups wanted? AND
+      !(BSET(flags, _RegexLT_Flags_MatchLongest) && BSET(flags, _RegexLT_Flags_MatchLast));   // not the last of the longest?
+
+   if(len < prog->minLen ||                                    // Input too short for any match? OR
+      ((noVM == FALSE || prog->engine != E_Engine_Literal) &&
+       hasRequired(prog, str, len) == FALSE))                  // lacks a literal every match must hold?
+      { return E_RegexRtn_NoMatch; }                           // then it can't match; no need to make any threads.
+
+   if(noVM == TRUE)
+   {
+      return prog->engine == E_Engine_Literal
+         ? runLiteral(prog, str, len, ml == NULL ? NULL : *ml, flags)       // Plain string? then search for it.
+         : runShiftAnd(prog, str, len, ml == NULL ? NULL : *ml, flags);     // else run it bit-parallel.
+   }
+
+   if(ml == NULL)                                              // No hook for a match list?
+      { return runOnce(prog, str, str, NULL, NULL, 0, flags, FALSE); }  // then yes/no is all we can tell the caller; longest or last is the same answer.
+
+   if( BSET(flags, _RegexLT_Flags_MatchLast) &&                // Want the last match (but not the longest)?
+      !BSET(flags, _RegexLT_Flags_MatchLongest) && *ml != NULL)
+      { return runFromEnd(prog, str, *ml, maxMatches, flags); }   // then search from the end, back.
+
+   rtn = runTwoPhase(prog, str, *ml, maxMatches, flags);       // Try to match at least once.
 
    // Now, if we got 1st match and we are to look for longest anywhere, then try again
    if( BSET(flags, _RegexLT_Flags_MatchLongest | _RegexLT_Flags_MatchLast) &&          // Search for longest or last? AND
@@ -1184,7 +2204,7 @@ PUBLIC T_RegexRtn regexlt_runCompiledRegex(S_InstrList *prog, C8 const *str, Reg
    {                                                           // ...otherwise there's no point in trying again; what can we tell the caller?
       // Make a 2nd match list so we can compare matches and find longest
       RegexLT_S_MatchList *m2;
-      if( (m2 = newMatchList(maxMatches)) == NULL)             // Couldn't make 2nd list?
+      if( (m2 = newMatchList((*ml)->listSize)) == NULL)        // Couldn't make 2nd list? (same as the caller's; it may be swapped for it)
       {
          rtn = E_RegexRtn_OutOfMemory;                         // then fail.
       }
@@ -1202,7 +2222,7 @@ PUBLIC T_RegexRtn regexlt_runCompiledRegex(S_InstrList *prog, C8 const *str, Reg
             else
             {                                                  // Try another match
                m2->put = 0;                                    // Clear out the match list (it may have been used before).
-               if( (r2 = runOnce(prog, newStart, m2, maxMatches, flags)) != E_RegexRtn_Match )   // No more matches?
+               if( (r2 = runTwoPhase(prog, newStart, m2, maxMatches, flags)) != E_RegexRtn_Match )   // No more matches?
                {
                   if(r2 != E_RegexRtn_NoMatch)                 // There was an error? (not just a failure to match)?
                   {
@@ -0,0 +1,548 @@
+/* ------------------------------------------------------------------------------
+|
+| Non-backtracking Lite Regex - Parse tree and rewrites.
+|
+| regexlt_compileRegex() makes instructions straight from the regex string; there's no
+| place in there to change the structure of the regex. So, ahead of that, the regex is
+| parsed into a tree, rewritten and printed back out as a (simpler) regex which is what
+| gets compiled.
+|
+| Rewrites are:
+|     - Single chars:      'a|b|xyz'       becomes  '[ab]|xyz'
+|     - Common parts:      'eth0|eth1'     becomes  'eth[01]';  'ac|bc'  becomes '[ab]c'
+|     - Nested repeats:    'x(?:a*)*'      becomes  'xa*';      'x(?:a+)?' becomes 'xa*'
+|
+| Each matches the same strings, with the same captures, as what it replaces; and, as the
+| regex is compiled before the match flags are known, prefers the same match leftmost-first.
+| So each fires only where that's plain:
+|     - single chars are gathered only where they are next to each other; 'a|xyz|b' isn't
+|       '[ab]|xyz' leftmost-first, on "b".
+|     - alternates are factored only if they differ in one char, and every other part is a
+|       single char, class or escape; so they all match the same length.
+|     - repeats are merged only in a '(?:...)' around a repeated char, class or escape. A
+|       subgroup captures it's last pass, which may differ with the number of passes. And
+|       not where the repeat might be the first thing matched; see simplify().
+| A regex which doesn't parse or which has nothing to rewrite is compiled as is.
+|
+|  Public:
+|     regexlt_simplifyRegex()
+|
+--------------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include "libs_support.h"
+#include "util.h"
+#include "regexlt_private.h"
+
+// Private to RegexLT_'.
+#define dbgPrint           regexlt_dbgPrint
+#define getMemMultiple     regexlt_getMemMultiple
+#define safeFree           regexlt_safeFree
+
+#define _MaxTreeLen MAX_U8    // Longest regex which is parsed. Node text lengths and child counts are U8.
+
+typedef enum {
+   E_Node_Leaf = 0,        // A char, escape, class, '.' or anchor; as it is in the regex.
+   E_Node_Set,             // Chars from an alternation, printed as a char class e.g '[abc]'.
+   E_Node_Cat,             // Children one after the other.
+   E_Node_Alt,             // Children are alternates i.e 'a|b|c'.
+   E_Node_Group,           // '(...)'; or '(?:...)', '(?>...)', whose opener is it's text.
+   E_Node_Rpt              // Child is repeated by '?', '*', '+' or '{n,m}'.
+} T_NodeKind;
+
+typedef struct S_Node S_Node;
+
+struct S_Node {
+   T_NodeKind  kind;
+   C8 const    *txt;       // Leaf: it's text in the regex. Rpt: the operator e.g '*' or '{2,3}'
+   U8          len;        // of 'txt'.
+   C8          ch;         // Leaf: if it's a single literal char, that char; else '\0'.
+   S_Node      *kid,       // 1st child.
+               *sib;       // Next sibling.
+};
+
+typedef struct {
+   S_Node      *buf;       // Nodes are taken from here...
+   U16         size,       // ...which has this many
+               put;        // Next free.
+   C8 const    *p;         // Next regex char to parse.
+   BOOL        fail;       // Regex didn't parse; or has '\i', '\I' (which would change what a set matches)
+} S_Parser;
+
+typedef struct {
+   C8    *buf;
+   U16   size, put;
+} S_Writer;
+
+/* ------------------------------------- newNode --------------------------------------- */
+
+PRIVATE S_Node * newNode(S_Parser *ps, T_NodeKind kind, C8 const *txt, U8 len)
+{
+   if(ps->put >= ps->size) {
+      ps->fail = TRUE;
+      return NULL; }
+   else {
+      S_Node *n = &ps->buf[ps->put++];
+      *n = (S_Node){.kind = kind, .txt = txt, .len = len, .ch = '\0', .kid = NULL, .sib = NULL};
+      return n; }
+}
+
+// ---- Append 'kid' to the children of 'n'.
+PRIVATE void addKid(S_Node *n, S_Node *kid)
+{
+   S_Node **k;
+   for(k = &n->kid; *k != NULL; k = &(*k)->sib) {}
+   *k = kid;
+}
+
+// ---- Overwrite 'n' with 'r', keeping 'n's place in its list of siblings.
+PRIVATE void replaceWith(S_Node *n, S_Node const *r)
+{
+   S_Node *sib = n->sib;
+   *n = *r;
+   n->sib = sib;
+}
+
+PRIVATE U8 numKids(S_Node const *n)
+{
+   U8 c; S_Node const *k;
+   for(c = 0, k = n->kid; k != NULL; k = k->sib, c++) {}
+   return c;
+}
+
+/* --------------------------------------- Parser -----------------------------------------
+
+      alt   := cat ('|' cat)*
+      cat   := (atom rpt*)*
+      atom  := '(' ('?:' | '?>')? alt ')' | '[' ... ']' | '\' ch | ch
+      rpt   := ('?' | '*' | '+' | '{' ... '}') '+'?
+*/
+PRIVATE S_Node * parseAlt(S_Parser *ps);
+
+PRIVATE S_Node * parseAtom(S_Parser *ps)
+{
+   C8 const *p = ps->p;
+   S_Node *n;
+
+   switch(*p)
+   {
+      case '(':
+         ps->p += p[1] == '?' && (p[2] == ':' || p[2] == '>') ? 3 : 1;   // Past '(' or '(?:' or '(?>'
+         if( (n = newNode(ps, E_Node_Group, p, ps->p - p)) != NULL) {
+            n->kid = parseAlt(ps); }
+
+         if(*ps->p != ')')                      // Group wasn't closed?
+            { ps->fail = TRUE; }
+         else
+            { ps->p++; }
+         return n;
+
+      case '[':
+         for(ps->p++; *ps->p != ']' && *ps->p != '\0'; ps->p++) {}   // to the close ']'.
+         if(*ps->p == '\0') {
+            ps->fail = TRUE;
+            return NULL; }
+         ps->p++;
+         return newNode(ps, E_Node_Leaf, p, ps->p - p);
+
+      case '\\':
+         if(p[1] == '\0' || toupper(p[1]) == 'I')   // Dangling escape? OR change of case-sensitivity?
+            { ps->fail = TRUE; return NULL; }       // then leave the regex alone.
+         ps->p += 2;
+         return newNode(ps, E_Node_Leaf, p, 2);
+
+      case '?': case '*': case '+': case '{':       // Operator with nothing to repeat? or
+      case ']': case '}': case '\0':                // stray close? or no more regex?
+         ps->fail = TRUE;
+         return NULL;
+
+      default:
+         ps->p++;
+         if( (n = newNode(ps, E_Node_Leaf, p, 1)) != NULL && *p != '.' && !isAnchor(*p)) {
+            n->ch = *p; }                           // A literal char.
+         return n;
+   }
+}
+
+PRIVATE BOOL isRptOp(C8 ch)
+   { return ch == '?' || ch == '*' || ch == '+' || ch == '{'; }
+
+PRIVATE S_Node * parseCat(S_Parser *ps)
+{
+   S_Node *cat = newNode(ps, E_Node_Cat, NULL, 0);
+
+   if(cat == NULL)
+      { return NULL; }
+
+   while(ps->fail == FALSE && *ps->p != '\0' && *ps->p != '|' && *ps->p != ')')
+   {
+      S_Node *n = parseAtom(ps);
+
+      while(ps->fail == FALSE && isRptOp(*ps->p))   // Any number of repeats on that atom.
+      {
+         C8 const *op = ps->p;
+
+         if(*op == '{') {
+            for(; *ps->p != '}' && *ps->p != '\0'; ps->p++) {}
+            if(*ps->p == '\0') {
+               ps->fail = TRUE;
+               break; }}
+         ps->p++;
+
+         if(*ps->p == '+')                         // Possessive e.g 'a*+'? The '+' goes with the repeat; it's not another.
+            { ps->p++; }
+
+         S_Node *r = newNode(ps, E_Node_Rpt, op, ps->p - op);
+         if(r != NULL) { r->kid = n; }
+         n = r;
+      }
+      if(ps->fail == FALSE)
+         { addKid(cat, n); }
+   }
+   return cat;
+}
+
+PRIVATE S_Node * parseAlt(S_Parser *ps)
+{
+   S_Node *cat = parseCat(ps);
+
+   if(ps->fail == TRUE || *ps->p != '|')
+      { return cat; }
+   else
+   {
+      S_Node *alt = newNode(ps, E_Node_Alt, NULL, 0);
+      if(alt != NULL)
+      {
+         addKid(alt, cat);
+         while(ps->fail == FALSE && *ps->p == '|') {
+            ps->p++;
+            addKid(alt, parseCat(ps)); }
+      }
+      return alt;
+   }
+}
+
+/* ------------------------------------- Rewrites -------------------------------------- */
+
+// ---- A literal char which needs no escape inside a char class.
+PRIVATE BOOL setsChar(S_Node const *n)
+   { return n->kind == E_Node_Leaf && n->ch != '\0' && (isalnum(n->ch) || strchr("_!#%&',/:;<=>@~\"", n->ch) != NULL); }
+
+// ---- Print 'n' into 'w', as regex.
+PRIVATE void emit(S_Writer *w, S_Node const *n);
+
+PRIVATE BOOL sameText(S_Node const *a, S_Node const *b)
+{
+   C8 ba[_MaxTreeLen+1], bb[_MaxTreeLen+1];
+   S_Writer wa = {.buf = ba, .size = sizeof(ba), .put = 0}, wb = {.buf = bb, .size = sizeof(bb), .put = 0};
+   emit(&wa, a); emit(&wb, b);
+   return wa.put < wa.size && wa.put == wb.put && memcmp(ba, bb, wa.put) == 0;
+}
+
+// ---- The children of an alternate; a Cat's list or else the alternate itself.
+PRIVATE S_Node * itemsOf(S_Node *n, U8 *cnt)
+{
+   if(n->kind == E_Node_Cat) {
+      *cnt = numKids(n);
+      return n->kid; }
+   else {
+      *cnt = 1;
+      return n; }
+}
+
+PRIVATE S_Node * nthItem(S_Node *first, U8 idx)
+   { for(; idx > 0; idx--) { first = first->sib; } return first; }
+
+/* ---- Make a Set from the single chars 'from[0..cnt-1]'; leaving out duplicates. If
+        there's just one char then it's a Leaf.
+*/
+PRIVATE S_Node * makeSet(S_Parser *ps, S_Node * const *from, U8 cnt)
+{
+   S_Node *set = newNode(ps, E_Node_Set, NULL, 0);
+   S_Node *k;
+   U8 c;
+
+   for(c = 0; c < cnt && set != NULL; c++)
+   {
+      for(k = set->kid; k != NULL && k->ch != from[c]->ch; k = k->sib) {}
+
+      if(k == NULL) {                                    // Not got this char yet?
+         S_Node *cpy = newNode(ps, E_Node_Leaf, from[c]->txt, from[c]->len);
+         if(cpy == NULL) { return NULL; }
+         cpy->ch = from[c]->ch;
+         addKid(set, cpy); }
+   }
+   return
+      set != NULL && numKids(set) == 1
+         ? set->kid
+         : set;
+}
+
+/* ---- Alternates which all read the same but for one char e.g 'eth0|eth1|eth2' -> 'eth[012]'.
+        (With just one item each, that's 'a|b|c' -> '[abc]'). Every item must be a Leaf, so each
+        alternate matches just one length; otherwise which alternate leftmost-first prefers could
+        change the match e.g '.*b|.*c' on "bc".
+*/
+PRIVATE BOOL factorAlt(S_Parser *ps, S_Node *alt)
+{
+   S_Node *a0 = alt->kid, *k, *diffs[_MaxTreeLen];             // Child counts are U8; so room for any number of alternates.
+   U8 n0, cnt, pos, at;
+   S_Node *items0 = itemsOf(a0, &n0);
+
+   if(n0 == 0)
+      { return FALSE; }
+
+   for(k = a0; k != NULL; k = k->sib)                 // All alternates the same length, and all Leafs?
+   {
+      S_Node *i = itemsOf(k, &cnt);
+      if(cnt != n0) { return FALSE; }
+      for(pos = 0; pos < cnt; pos++, i = i->sib) {
+         if(i->kind != E_Node_Leaf) { return FALSE; }}
+   }
+
+   for(pos = 0, at = n0; pos < n0; pos++)             // Find the one place where they differ.
+   {
+      S_Node *i0 = nthItem(items0, pos);
+      BOOL same = TRUE;
+
+      for(k = a0->sib; k != NULL && same; k = k->sib) {
+         same = sameText(i0, nthItem(itemsOf(k, &cnt), pos)); }
+
+      if(same == FALSE)
+      {
+         if(at < n0)                                  // Already found a difference?
+            { return FALSE; }                         // then they differ in 2 places.
+         at = pos;
+      }
+   }
+   if(at == n0)                                       // All the same?
+      { at = 0; }                                     // then they all have the same 1st item. Merge it to one.
+
+   for(cnt = 0, k = a0; k != NULL; k = k->sib, cnt++)
+   {
+      U8 n;
+      if(setsChar(diffs[cnt] = nthItem(itemsOf(k, &n), at)) == FALSE)
+         { return FALSE; }
+   }
+
+   S_Node *set = makeSet(ps, diffs, cnt);
+   if(set == NULL)
+      { return FALSE; }
+
+   replaceWith(diffs[0], set);                        // Put the merged chars into the 1st alternate...
+   replaceWith(alt, a0);                              // which replaces all of them.
+   return TRUE;
+}
+
+/* ---- Gather alternates which are single chars, and next to each other, into one set e.g
+        'a|b|xyz' -> '[ab]|xyz'. Not 'a|xyz|b'; leftmost-first, 'xyz' is preferred to 'b'.
+*/
+PRIVATE BOOL gatherSingles(S_Parser *ps, S_Node *alt)
+{
+   S_Node *singles[_MaxTreeLen], *k;                           // Room for any number of alternates, as above.
+   U8 cnt;
+
+   for(k = alt->kid; k != NULL && !(setsChar(k) && k->sib != NULL && setsChar(k->sib)); k = k->sib) {}   // To the 1st 2 singles in a row.
+
+   if(k == NULL)
+      { return FALSE; }
+
+   for(cnt = 0; k != NULL && setsChar(k); k = k->sib) {          // Take the run of singles from there.
+      singles[cnt++] = k; }
+
+   S_Node *set = makeSet(ps, singles, cnt);
+   if(set == NULL)
+      { return FALSE; }
+
+   replaceWith(singles[0], set);                      // The set takes the place of the 1st single...
+   singles[0]->sib = k;                               // ...and the others in the run are unlinked.
+
+   if(numKids(alt) == 1)
+      { replaceWith(alt, alt->kid); }
+   return TRUE;
+}
+
+/* ---- '(?:X*)*' -> 'X*' etc, where X is a single char, class or escape. Not for a group which
+        captures; it captures it's last pass, and merging the repeats changes how passes are
+        counted. Nor for a bigger X; that keeps it's group, and a repeated group nested in another
+        doesn't always compile right.
+*/
+PRIVATE BOOL mergeRepeats(S_Node *rpt)
+{
+   S_Node *inner = rpt->kid;
+   S_Node *tgt = inner->kind == E_Node_Group ? inner->kid : inner;
+
+   if(inner->kind == E_Node_Group && (inner->len != 3 || inner->txt[2] != ':'))   // Group captures? or is atomic; '(?>a+)*' isn't '(?>a*)'?
+      { return FALSE; }
+
+   if( tgt != NULL && tgt->kind == E_Node_Rpt &&                                  // Repeats...
+       tgt->kid->kind == E_Node_Leaf && !(tgt->kid->len == 1 && isAnchor(*tgt->kid->txt)) &&   // ...a char, class or escape? AND
+       tgt->len == 1 && rpt->len == 1 && *rpt->txt != '{' && *tgt->txt != '{')   // Both repeats are '?', '*' or '+'?
+   {
+      if(*tgt->txt != *rpt->txt) {                    // Different repeats?
+         tgt->txt = "*"; }                            // then together they are always '*'.
+      replaceWith(rpt, tgt);                          // Outer repeat, and any group, are gone.
+      return TRUE;
+   }
+   return FALSE;
+}
+
+/* ---- Rewrite 'n' and its children, bottom up. Return TRUE if anything changed.
+
+        'lead' if 'n' may be the first thing the regex matches. A repeat there is left as is;
+        runOnce() restarts a leading 'a*' or '(?:a*)?' only at it's CharBox, so 'a*b' misses
+        "a1b", but '(?:(?:a*)?)+b', which compiles to a loop, doesn't.
+*/
+PRIVATE BOOL simplify(S_Parser *ps, S_Node *n, BOOL lead)
+{
+   BOOL changed = FALSE, kidLeads = lead;
+   S_Node *k;
+
+   for(k = n->kid; k != NULL; k = k->sib) {
+      if(simplify(ps, k, kidLeads)) {
+         changed = TRUE; }
+      if(n->kind != E_Node_Alt && k->kind != E_Node_Rpt && k->kind != E_Node_Group) {   // Every alternate leads if 'n' does; in a run, so does what follows a
+         kidLeads = FALSE; }}                                                             // repeat or a group, either of which might match nothing.
+
+   switch(n->kind)
+   {
+      case E_Node_Cat:
+         if(numKids(n) == 1)                          // A Cat of one is just that one.
+            { replaceWith(n, n->kid); }
+         break;
+
+      case E_Node_Alt:
+         if(factorAlt(ps, n) || gatherSingles(ps, n))
+            { changed = TRUE; }
+         break;
+
+      case E_Node_Rpt:
+         if(lead == FALSE && mergeRepeats(n))
+            { changed = TRUE; }
+         break;
+
+      default:
+         break;
+   }
+   return changed;
+}
+
+/* --------------------------------------- emit ------------------------------------------ */
+
+PRIVATE void put(S_Writer *w, C8 const *s, U8 len)
+{
+   for(; len > 0; len--, s++) {
+      if(w->put < w->size) { w->buf[w->put] = *s; }
+      w->put++; }                                     // Keep counting even if past the end; caller checks for overrun.
+}
+
+PRIVATE void emit(S_Writer *w, S_Node const *n)
+{
+   S_Node const *k;
+
+   switch(n->kind)
+   {
+      case E_Node_Leaf:
+         put(w, n->txt, n->len);
+         break;
+
+      case E_Node_Set:
+         put(w, "[", 1);
+         for(k = n->kid; k != NULL; k = k->sib) { put(w, &k->ch, 1); }
+         put(w, "]", 1);
+         break;
+
+      case E_Node_Group:
+         put(w, n->txt, n->len);                      // '(' or '(?:' etc.
+         if(n->kid != NULL) { emit(w, n->kid); }
+         put(w, ")", 1);
+         break;
+
+      case E_Node_Rpt:
+         emit(w, n->kid);
+         put(w, n->txt, n->len);
+         break;
+
+      case E_Node_Cat:
+         for(k = n->kid; k != NULL; k = k->sib) { emit(w, k); }
+         break;
+
+      case E_Node_Alt:
+         for(k = n->kid; k != NULL; k = k->sib) {
+            emit(w, k);
+            if(k->sib != NULL) { put(w, "|", 1); }}
+         break;
+   }
+}
+
+/* ------------------------------------ regexlt_simplifyRegex ----------------------------------------
+
+   Parse 'regex' into a tree, rewrite and print it. If there were rewrites then return the new
+   regex, in memory from 'getMem()'; caller must free() it. Otherwise return NULL, meaning
+   compile 'regex' as is. NULL also if the regex didn't parse or a malloc() failed.
+*/
+/* Each regex char makes at most 2 nodes, plus the top Cat and Alt. Sets made by rewrites copy
+   chars from the tree; allow the same again for those.
+*/
+#define _NodesFor(len) (4*(len) + 4)
+
+PUBLIC C8 * regexlt_simplifyRegex(C8 const *regex)
+{
+   U16 len = strlen(regex);
+   S_Node *nodes;
+   C8 *out;
+
+   if(len == 0 || len > _MaxTreeLen)
+      { return NULL; }
+
+   S_TryMalloc toMalloc[] = {                                    // 'nodes' last, so it's freed from the top of a pool (see regexlt_pool.c).
+      { (void**)&out,      _MaxTreeLen + 1,                  E_RegexMem_Simplify },
+      { (void**)&nodes,    _NodesFor(len) * sizeof(S_Node), E_RegexMem_Simplify } };
+
+   if( getMemMultiple(toMalloc, RECORDS_IN(toMalloc)) == FALSE)
+      { return NULL; }
+
+   S_Parser ps = {.buf = nodes, .size = _NodesFor(len), .put = 0, .p = regex, .fail = FALSE };
+   S_Node *top = parseAlt(&ps);
+   S_Writer w = {.buf = out, .size = _MaxTreeLen, .put = 0};
+
+   if( ps.fail == FALSE && *ps.p == '\0' && top != NULL &&       // Parsed the whole regex? AND
+       simplify(&ps, top, TRUE) == TRUE && ps.fail == FALSE)             // rewrote something (and had the nodes to do it)?
+   {
+      emit(&w, top);
+
+      if(w.put < w.size && w.put <= regexlt_cfg->maxRegexLen)     // New regex fits?
+      {
+         out[w.put] = '\0';
+         dbgPrint("\r\n------- Simplified: '%s' -> '%s'\r\n", regex, out);
+         safeFree(nodes);
+         return out;
+      }
+   }
+   safeFree(nodes);
+   safeFree(out);
+   return NULL;
+}
+
+/* ------------------------------------ regexlt_simplifyMem ----------------------------------------
+
+   The heap regexlt_simplifyRegex() gets for 'regex'; while it works and, if it returns a rewrite,
+   what's kept for that. Same getMem()s as regexlt_simplifyRegex().
+*/
+PUBLIC S_SimplifyMem regexlt_simplifyMem(C8 const *regex)
+{
+   U16 len = strlen(regex);
+
+   if(len == 0 || len > _MaxTreeLen)
+      { return (S_SimplifyMem){.working = 0, .kept = 0}; }
+   else
+      { return (S_SimplifyMem){
+            .working = _NodesFor(len) * sizeof(S_Node) + _MaxTreeLen + 1,
+            .kept    = _MaxTreeLen + 1 }; }
+}
+
+// ------------------------------------------- eof -------------------------------------------
@@ -0,0 +1,390 @@
+#include "libs_support.h"
+   #if _TARGET_IS == _TARGET_UNITY_TDD
+#include "unity.h"
+#define _TRACE_PRINTS_ON false
+   #else
+#define TEST_FAIL()
+#define _TRACE_PRINTS_ON true
+   #endif // _TARGET_IS
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "util.h"
+#include "regexlt_private.h"
+
+PUBLIC U16 tdd_TestNum;    // For labeling error messages with the test that failed.
+
+/* What the compiler works out about a program before it's run, e.g whether it's anchored or
+   what any match must hold. Each test checks what was worked out, and that a run agrees.
+*/
+
+// =============================== Tests start here ==================================
+
+
+/* -------------------------------------- setUp ------------------------------------------- */
+
+PRIVATE void * getMem(size_t numBytes) { return calloc(1, numBytes); }
+PRIVATE void myFree(void *p) { free(p); }
+
+#define _MaxInput 1000
+
+PRIVATE RegexLT_S_Cfg const cfg = {          // RegexLT_Init() keeps a pointer to this; so it's not on the stack.
+   .getMem        = getMem,
+   .free          = myFree,
+   .printEnable   = _TRACE_PRINTS_ON,
+   .maxSubmatches = 9,
+   .maxRegexLen   = MAX_U8,
+   .maxStrLen     = _MaxInput + 2 };
+
+void setUp(void) {
+   RegexLT_Init(&cfg);
+}
+
+/* -------------------------------------- tearDown ------------------------------------------- */
+
+void tearDown(void) {
+}
+
+/* ----------------------------------- compiles -----------------------------------------
+
+   Compile 'regex' into 'prog'. If it won't, print that test 'tstNum' of 'tag' failed and
+   return FALSE.
+*/
+PRIVATE BOOL compiles(C8 const *tag, U8 tstNum, C8 const *regex, S_Program **prog)
+{
+   if(RegexLT_Compile(regex, (void**)prog) != E_RegexRtn_OK)
+   {
+      printf("%s fail #%u: \"%s\" didn't compile\r\n", tag, tstNum, regex);
+      return FALSE;
+   }
+   return TRUE;
+}
+
+// -------------------------------- test_AnchoredStart --------------------------------------
+
+/* A program which starts with '^' is tried at the start only. A mismatch there is the end of
+   it; the rest of the input costs nothing. Alternatives without '^' aren't anchored.
+*/
+void test_AnchoredStart(void)
+{
+   typedef struct { C8 const *regex; BOOL anchored; T_RegexRtn rtn; } S_Tst;
+
+   S_Tst const tsts[] = {
+      { "^\\d+\\.\\d+\\.\\d+\\.\\d+$",  TRUE,    E_RegexRtn_NoMatch },
+      { "^(a|1)",                      TRUE,    E_RegexRtn_Match },
+      { "^a|^1",                       TRUE,    E_RegexRtn_Match },
+      { "^a|1",                        FALSE,   E_RegexRtn_Match },
+      { "1^",                          FALSE,   E_RegexRtn_NoMatch },
+   };
+
+   C8 src[201];
+   memset(src, '1', sizeof(src)-1);                               // e.g "111...1x"; not an IP address.
+   src[sizeof(src)-2] = 'x';
+   src[sizeof(src)-1] = '\0';
+
+   U8 i, fails = 0;
+   RegexLT_S_Stats st;
+   S_Program *prog;
+
+   for(i = 0; i < RECORDS_IN(tsts); i++)
+   {
+      S_Tst const *t = &tsts[i];
+      RegexLT_S_MatchList *ml = NULL;
+
+      if(compiles("anchored", i, t->regex, &prog) == FALSE)
+         { fails++; continue; }
+      T_RegexRtn rtn = RegexLT_MatchProgStats(prog, src, &ml, _RegexLT_Flags_None, &st);
+
+      if(prog->instrs.anchoredStart != t->anchored || rtn != t->rtn ||
+         (t->anchored && st.cycles > 10))                         // Anchored? then it's over in a few steps, not 200.
+      {
+         printf("anchored fail #%u: \"%s\" anchored %u got %s in %lu cycles\r\n",
+                  i, t->regex, prog->instrs.anchoredStart, RegexLT_RtnStr(rtn), (unsigned long)st.cycles);
+         fails++;
+      }
+      RegexLT_FreeMatches(ml);
+      RegexLT_FreeProgram(prog);
+   }
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+// -------------------------------- test_RequiredLiterals --------------------------------------
+
+/* The compiler finds literals any match must hold. An input which lacks one is 'NoMatch' with
+   no threads run; one which has them all is run as usual.
+*/
+void test_RequiredLiterals(void)
+{
+   typedef struct { C8 const *regex; U8 numRequired; C8 const *lacks, *has; } S_Tst;
+
+   S_Tst const tsts[] = {
+      // Regex                     Required   Lacks one                 Has them, and matches
+      { "[a-z]+@[a-z]+\\.com",      3,      "bob at example.com",     "mail bob@example.com now" },
+      { "\\d+,\\d+",                1,      "12 34 56",               "12,34" },
+      { "ab.d",                     2,      "abxx",                   "xabcd" },
+      { "(cat|dog)s",               1,      "cat dog",                "two cats" },
+      { "x\\d?y",                   2,      "x1 z",                   "x1y" },
+      { "a*b?",                     0,      NULL,                     "ccc" },                  // May match nothing; so nothing is required.
+      { ".?c*|c{1,4}.c",            0,      NULL,                     "xcc" },                  // A '|' among repeats; nothing is claimed.
+   };
+
+   U8 i, fails = 0;
+   RegexLT_S_Stats st;
+   S_Program *prog;
+
+   for(i = 0; i < RECORDS_IN(tsts); i++)
+   {
+      S_Tst const *t = &tsts[i];
+      RegexLT_S_MatchList *ml = NULL;
+
+      if(compiles("required", i, t->regex, &prog) == FALSE)
+         { fails++; continue; }
+
+      if(prog->instrs.numRequired != t->numRequired)
+         { printf("required fail #%u: \"%s\" %u literals\r\n", i, t->regex, prog->instrs.numRequired); fails++; }
+
+      if(t->lacks != NULL &&
+         (RegexLT_MatchProgStats(prog, t->lacks, &ml, _RegexLT_Flags_None, &st) != E_RegexRtn_NoMatch || st.threads != 0))
+         { printf("required fail #%u: \"%s\" ran on \"%s\"\r\n", i, t->regex, t->lacks); fails++; }
+
+      if(RegexLT_MatchProgStats(prog, t->has, &ml, _RegexLT_Flags_None, &st) != E_RegexRtn_Match)
+         { printf("required fail #%u: \"%s\" no match on \"%s\"\r\n", i, t->regex, t->has); fails++; }
+
+      RegexLT_FreeMatches(ml);
+      RegexLT_FreeProgram(prog);
+   }
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+// -------------------------------- test_MatchLengths --------------------------------------
+
+/* The compiler works out the fewest and most chars a match can have. An input shorter than the
+   fewest is 'NoMatch' with no threads run; and no match is missed for starting too near the end.
+*/
+void test_MatchLengths(void)
+{
+   typedef struct { C8 const *regex; U16 minLen, maxLen; C8 const *tooShort, *fits; } S_Tst;
+
+   S_Tst const tsts[] = {
+      // Regex                     Min   Max                        Too short   Just fits
+      { "[a-c]{4}",                 4,    4,                         "abc",     "xxabca" },
+      { "a{2,3}b",                  3,    4,                         "ab",      "xaab" },
+      { "x\\d{3}-\\d{4}",           9,    9,                         "x12-3456", "x123-4567" },
+      { "\\d\\d?",                  1,    2,                         "",        "xx7" },
+      { "ab*",                      1,    _MatchLen_Unbounded,       "",        "bba" },          // Unlimited repeat; no most.
+      { "a*b?",                     0,    _MatchLen_Unbounded,       NULL,      "ccc" },          // May match nothing.
+      { ".?c*|c{1,4}.c",            0,    _MatchLen_Unbounded,       NULL,      "xcc" },          // A '|' among repeats; no lengths are claimed.
+      { "a?(c.[bc]b+)?|ab{2,5}$",   0,    _MatchLen_Unbounded,       NULL,      "b" },
+   };
+
+   U8 i, fails = 0;
+   RegexLT_S_Stats st;
+   S_Program *prog;
+
+   for(i = 0; i < RECORDS_IN(tsts); i++)
+   {
+      S_Tst const *t = &tsts[i];
+      RegexLT_S_MatchList *ml = NULL;
+
+      if(compiles("lengths", i, t->regex, &prog) == FALSE)
+         { fails++; continue; }
+
+      if(prog->instrs.minLen != t->minLen || prog->instrs.maxLen != t->maxLen)
+         { printf("lengths fail #%u: \"%s\" min %u max %u\r\n", i, t->regex, prog->instrs.minLen, prog->instrs.maxLen); fails++; }
+
+      if(t->tooShort != NULL &&
+         (RegexLT_MatchProgStats(prog, t->tooShort, &ml, _RegexLT_Flags_None, &st) != E_RegexRtn_NoMatch || st.threads != 0))
+         { printf("lengths fail #%u: \"%s\" ran on \"%s\"\r\n", i, t->regex, t->tooShort); fails++; }
+
+      if(RegexLT_MatchProgStats(prog, t->fits, &ml, _RegexLT_Flags_None, &st) != E_RegexRtn_Match)
+         { printf("lengths fail #%u: \"%s\" no match on \"%s\"\r\n", i, t->regex, t->fits); fails++; }
+
+      RegexLT_FreeMatches(ml);
+      RegexLT_FreeProgram(prog);
+   }
+
+   /* Longest-match; starts too near the end are not tried, but a match already going must still
+      run to its longest.
+   */
+   RegexLT_S_MatchList *ml = NULL;
+   if(RegexLT_Match("(a|b).{1,3}[ab]", "xbcaa1", &ml, _RegexLT_Flags_MatchLongest) != E_RegexRtn_Match ||
+      ml->matches[0].idx != 1 || ml->matches[0].len != 4)
+      { printf("lengths fail: longest not [1 4]\r\n"); fails++; }
+   RegexLT_FreeMatches(ml);
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+// -------------------------------- test_Analyze --------------------------------------
+
+/* RegexLT_Analyze() says how a program starts and ends, what its matches hold and how big
+   they are; and whether it could be run as a DFA. Its heap, for the program and a match on
+   the longest input, is no more than RegexLT_MemRequired() says all of it takes.
+*/
+void test_Analyze(void)
+{
+   typedef struct {
+      C8 const *regex;
+      BOOL anchoredStart, anchoredEnd;
+      C8 const *prefix, *suffix, *first;        // 'first' NULL if a match may start with any char.
+      U16 minLen, maxLen;
+      BOOL dfaFriendly; U16 dfaStates;
+   } S_Tst;
+
+   S_Tst const tsts[] = {
+      // Regex                  ^      $      Prefix   Suffix   First           Min   Max                   DFA    States
+      { "hello",                FALSE, FALSE, "hello", "hello", "h",            5,    5,                    TRUE,  6 },
+      { "abc\\d+x",             FALSE, FALSE, "abc",   "x",     "a",            5,    _MatchLen_Unbounded,  TRUE,  7 },
+      { "^foo.*bar$",           TRUE,  TRUE,  "foo",   "bar",   "f",            6,    _MatchLen_Unbounded,  TRUE,  8 },
+      { "a.c",                  FALSE, FALSE, "a",     "c",     "a",            3,    3,                    TRUE,  4 },
+      { "\\d{3}-\\d{4}",        FALSE, FALSE, "",      "",      "0123456789",   8,    8,                    TRUE,  9 },
+      { "x*y",                  FALSE, FALSE, "",      "y",     "xy",           1,    _MatchLen_Unbounded,  TRUE,  3 },
+      { ".*z",                  FALSE, FALSE, "",      "z",     NULL,           1,    _MatchLen_Unbounded,  TRUE,  3 },
+      { "a++b",                 FALSE, FALSE, "",      "b",     "a",            2,    _MatchLen_Unbounded,  FALSE, 4 },     // Possessive.
+      { "a{1000}",              FALSE, FALSE, "",      "",      "a",            1000, 1000,                 FALSE, 1001 },  // Too many states.
+      { "a?(c.[bc]b+)?|ab{2,5}$", FALSE, FALSE, "",    "",      NULL,           0,    _MatchLen_Unbounded,  TRUE,  11 },    // '|' among repeats; no '$' claimed.
+   };
+
+   U8 i, fails = 0;
+   S_Program *prog;
+
+   for(i = 0; i < RECORDS_IN(tsts); i++)
+   {
+      S_Tst const *t = &tsts[i];
+      RegexLT_S_Analysis a;
+
+      if(compiles("analyze", i, t->regex, &prog) == FALSE)
+         { fails++; continue; }
+      RegexLT_Analyze(prog, &a);
+
+      C8 first[MAX_U8+1];
+      U16 ch, n = 0;
+      for(ch = 1; ch <= 0x7F; ch++) {
+         if(C8bag_Contains(&a.firstChars, ch) == TRUE) {
+            first[n++] = ch; }}
+      first[n] = '\0';
+
+      if(a.anchoredStart != t->anchoredStart || a.anchoredEnd != t->anchoredEnd ||
+         a.prefix.len != strlen(t->prefix) || strncmp(a.prefix.chars, t->prefix, a.prefix.len) != 0 ||
+         a.suffix.len != strlen(t->suffix) || strncmp(a.suffix.chars, t->suffix, a.suffix.len) != 0 ||
+         (t->first == NULL ? a.firstAny == FALSE : (a.firstAny == TRUE || strcmp(first, t->first) != 0)) ||
+         a.minLen != t->minLen || a.maxLen != t->maxLen ||
+         a.dfaFriendly != t->dfaFriendly || a.dfaStates != t->dfaStates)
+      {
+         printf("analyze fail #%u: \"%s\" ^%u $%u '%.*s' '%.*s' [%s] %u-%u DFA %u %u\r\n",
+                i, t->regex, a.anchoredStart, a.anchoredEnd, a.prefix.len, a.prefix.chars, a.suffix.len, a.suffix.chars,
+                a.firstAny ? "any" : first, a.minLen, a.maxLen, a.dfaFriendly, a.dfaStates);
+         fails++;
+      }
+
+      RegexLT_S_ProgSize sz = RegexLT_ProgramSize(prog);
+      if(a.instrs.optimized != sz.optimized || a.numRequired != prog->instrs.numRequired ||
+         a.maxThreads != regexlt_threadsNeeded(&prog->instrs, cfg.maxStrLen))
+         { printf("analyze fail #%u: \"%s\" sizes\r\n", i, t->regex); fails++; }
+
+      if(a.isMatchBytes > a.matchBytes ||
+         a.programBytes + a.matchBytes > RegexLT_MemRequired(t->regex, cfg.maxStrLen, _RegexLT_Flags_None))
+         { printf("analyze fail #%u: \"%s\" %lu + %lu bytes\r\n", i, t->regex, (unsigned long)a.programBytes, (unsigned long)a.matchBytes); fails++; }
+
+      RegexLT_FreeProgram(prog);
+   }
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+// -------------------------------- test_Engines --------------------------------------
+
+/* A short fixed run of chars and classes runs on shift-and, and a plain string on a substring
+   search; no threads, and the same matches as the thread VM. Wanting its groups puts it back on
+   the VM; and anything else stays there.
+*/
+void test_Engines(void)
+{
+   typedef struct { C8 const *regex; T_Engine engine; C8 const *src; RegexLT_T_Flags flags; RegexLT_T_MatchIdx idx; RegexLT_T_MatchLen len; } S_Tst;
+
+   S_Tst const tsts[] = {
+      // Regex                  Engine               Input                       Flags                           Idx   Len
+      { "x\\d{3}-\\d{4}",       E_Engine_ShiftAnd,   "tel x555-1234.",           _RegexLT_Flags_None,            4,    9 },
+      { "x\\d{3}-\\d{4}",       E_Engine_ShiftAnd,   "x111-2222 x333-4444",      _RegexLT_Flags_MatchLast,       10,   9 },
+      { "x\\d{3}-\\d{4}",       E_Engine_ShiftAnd,   "x111-2222 x333-4444",      _RegexLT_Flags_MatchLongest,    0,    9 },
+      { "a[bc].d",              E_Engine_ShiftAnd,   "abd ac\xE9""d",            _RegexLT_Flags_None,            4,    4 },    // '.' is any char, even past 0x7F.
+      { "x\\.y",                E_Engine_ShiftAnd,   "xyx.y",                    _RegexLT_Flags_None,            2,    3 },    // An escape; not just 'Chars'.
+      { "aab",                  E_Engine_Literal,    "aaaab",                    _RegexLT_Flags_None,            2,    3 },
+      { "hello",                E_Engine_Literal,    "help, hello hello",        _RegexLT_Flags_None,            6,    5 },
+      { "hello",                E_Engine_Literal,    "help, hello hello",        _RegexLT_Flags_MatchLast,       12,   5 },
+      { "aa",                   E_Engine_Literal,    "aaa",                      _RegexLT_Flags_MatchLast,       1,    2 },    // Overlapping.
+      { "z",                    E_Engine_Literal,    "xyzzy",                    _RegexLT_Flags_MatchLast,       3,    1 },
+      { "is a long plain string, longer than shift-and can take",
+                                E_Engine_Literal,    ">is a long plain string, longer than shift-and can take",
+                                                                                 _RegexLT_Flags_None,            1,    54 },
+      { "a+b",                  E_Engine_NFA,        "xaab",                     _RegexLT_Flags_None,            1,    3 },    // Not fixed length.
+      { "^abc",                 E_Engine_NFA,        "abc",                      _RegexLT_Flags_None,            0,    3 },    // Anchored.
+      { "a{33}",                E_Engine_NFA,        NULL,                       _RegexLT_Flags_None,            0,    0 },    // Too long for a U32.
+   };
+
+   U8 i, fails = 0;
+   RegexLT_S_Stats st;
+   S_Program *prog;
+
+   for(i = 0; i < RECORDS_IN(tsts); i++)
+   {
+      S_Tst const *t = &tsts[i];
+      RegexLT_S_MatchList *ml = NULL;
+
+      if(compiles("engines", i, t->regex, &prog) == FALSE)
+         { fails++; continue; }
+
+      if(prog->instrs.engine != t->engine)
+         { printf("engines fail #%u: \"%s\" engine %u\r\n", i, t->regex, prog->instrs.engine); fails++; }
+
+      if(t->src != NULL)
+      {
+         if(RegexLT_MatchProgStats(prog, t->src, &ml, t->flags, &st) != E_RegexRtn_Match ||
+            ml->matches[0].idx != t->idx || ml->matches[0].len != t->len ||
+            (t->engine != E_Engine_NFA) != (st.threads == 0))
+            { printf("engines fail #%u: \"%s\" on \"%s\"\r\n", i, t->regex, t->src); fails++; }
+
+         if(RegexLT_IsMatch(prog, t->src) != E_RegexRtn_Match)
+            { printf("engines fail #%u: \"%s\" IsMatch()\r\n", i, t->regex); fails++; }
+      }
+
+      RegexLT_FreeMatches(ml);
+      RegexLT_FreeProgram(prog);
+   }
+
+   // Groups wanted go to the thread VM; none wanted, to shift-and.
+   RegexLT_S_MatchList *ml = NULL;
+   RegexLT_Compile("(ab)(cd)", (void**)&prog);
+
+   if(prog->instrs.engine != E_Engine_ShiftAnd ||
+      RegexLT_MatchProgStats(prog, "xabcdx", &ml, _RegexLT_Flags_None, &st) != E_RegexRtn_Match ||
+      st.threads == 0 || ml->put != 3 || ml->matches[2].idx != 3 ||
+      RegexLT_MatchProgGroups(prog, "xabcdx", &ml, _RegexLT_Flags_None, _RegexLT_Groups_None) != E_RegexRtn_Match ||
+      ml->matches[0].idx != 1 || ml->matches[0].len != 4)
+      { printf("engines fail: groups\r\n"); fails++; }
+
+   RegexLT_FreeMatches(ml);
+   RegexLT_FreeProgram(prog);
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+// ----------------------------------------- eof --------------------------------------------
@@ -0,0 +1,124 @@
+#include "libs_support.h"
+   #if _TARGET_IS == _TARGET_UNITY_TDD
+#include "unity.h"
+#define _TRACE_PRINTS_ON false
+   #else
+#define TEST_FAIL()
+#define _TRACE_PRINTS_ON true
+   #endif // _TARGET_IS
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "util.h"
+#include "regexlt_private.h"
+
+PUBLIC U16 tdd_TestNum;    // For labeling error messages with the test that failed.
+
+/* Capture sets, shared among threads copy-on-write from a slab got once per run.
+*/
+
+// =============================== Tests start here ==================================
+
+
+/* -------------------------------------- setUp ------------------------------------------- */
+
+PRIVATE void * getMem(size_t numBytes) { return calloc(1, numBytes); }
+PRIVATE void myFree(void *p) { free(p); }
+
+#define _MaxInput 1000
+
+PRIVATE RegexLT_S_Cfg const cfg = {          // RegexLT_Init() keeps a pointer to this; so it's not on the stack.
+   .getMem        = getMem,
+   .free          = myFree,
+   .printEnable   = _TRACE_PRINTS_ON,
+   .maxSubmatches = 9,
+   .maxRegexLen   = MAX_U8,
+   .maxStrLen     = _MaxInput + 2 };
+
+void setUp(void) {
+   RegexLT_Init(&cfg);
+}
+
+/* -------------------------------------- tearDown ------------------------------------------- */
+
+void tearDown(void) {
+}
+
+// -------------------------------- test_CaptureSets --------------------------------------
+
+/* Threads share capture sets, from one slab got per run; a set is copied only when a thread
+   writes to one it shares. So a match takes the same getMem()s however long the input, and
+   however many threads fork; and the captures come out as before.
+*/
+void test_CaptureSets(void)
+{
+   typedef struct { C8 const *regex; C8 fill; C8 const *tail; RegexLT_T_MatchIdx at1, len1, at2, len2; } S_Tst;
+
+   S_Tst const tsts[] = {
+      // regex                   fill  tail        sub-matches, from the start of 'tail'
+      { "a(b+)c(d)",             'b',  "abbcd",     1, 2,  4, 1 },
+      { "<(b+)>(c)",             'b',  "<bb>c",     1, 2,  4, 1 },
+      { "x(y+)(z)",              'y',  "xyyz",      1, 2,  3, 1 },
+      { "(ab)(c+)",              'a',  "abcc",      0, 2,  2, 2 },
+      { "([0-9]+)=(x)",          ' ',  "12=x",      0, 2,  3, 1 },
+   };
+
+   U16 const lens[] = { 20, 400 };
+   static C8 str[_MaxInput + 10];
+   U8 i, j, fails = 0;
+   void *prog;
+
+   for(i = 0; i < RECORDS_IN(tsts); i++)
+   {
+      S_Tst const *t = &tsts[i];
+      U32 getMems[RECORDS_IN(lens)];
+
+      if(RegexLT_Compile(t->regex, &prog) != E_RegexRtn_OK)
+      {
+         printf("caps fail #%u: \"%s\" didn't compile\r\n", i, t->regex);
+         fails++;
+         continue;
+      }
+
+      for(j = 0; j < RECORDS_IN(lens); j++)
+      {
+         RegexLT_S_MatchList *ml = NULL;
+         RegexLT_S_Stats st;
+         U16 n = lens[j];
+
+         memset(str, t->fill, n);
+         strcpy(str+n, t->tail);
+
+         if(RegexLT_MatchProgStats(prog, str, &ml, _RegexLT_Flags_None, &st) != E_RegexRtn_Match || ml->put != 3 ||
+            ml->matches[1].idx != n + t->at1 || ml->matches[1].len != t->len1 ||
+            ml->matches[2].idx != n + t->at2 || ml->matches[2].len != t->len2)
+         {
+            printf("caps fail #%u: \"%s\" at %u wrong captures\r\n", i, t->regex, n);
+            fails++;
+         }
+         else if(st.copies == 0 || st.copies >= st.threads)          // Some forks write; most just share.
+         {
+            printf("caps fail #%u: \"%s\" at %u, %lu copies for %lu threads\r\n",
+               i, t->regex, n, (unsigned long)st.copies, (unsigned long)st.threads);
+            fails++;
+         }
+         getMems[j] = st.getMems;
+         RegexLT_FreeMatches(ml);
+      }
+
+      if(getMems[0] != getMems[1])
+      {
+         printf("caps fail #%u: \"%s\" getMems %lu then %lu\r\n", i, t->regex, (unsigned long)getMems[0], (unsigned long)getMems[1]);
+         fails++;
+      }
+      RegexLT_FreeProgram(prog);
+   }
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+// ----------------------------------------- eof --------------------------------------------
@@ -0,0 +1,240 @@
+#include "libs_support.h"
+   #if _TARGET_IS == _TARGET_UNITY_TDD
+#include "unity.h"
+#define _TRACE_PRINTS_ON false
+   #else
+#define TEST_FAIL()
+#define _TRACE_PRINTS_ON true
+   #endif // _TARGET_IS
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "util.h"
+#include "regexlt_private.h"
+
+PUBLIC U16 tdd_TestNum;    // For labeling error messages with the test that failed.
+
+/* Pathological patterns, which blow up a backtracking matcher, should cost no more than
+   linear in the input here; removeDuplicateThreads() merges the threads which would otherwise
+   multiply. These tests run each pattern over inputs of increasing length and check that
+   the work grows no faster than the input.
+
+   The work is counted as the threads made, from RegexLT_MatchProgStats(); unlike time, it's
+   the same on every run, so the tests hold on a loaded machine or under a sanitizer. The
+   times are printed, for information only.
+
+   Thread lists are sized by the compiler, for the most distinct threads the program can have.
+   A list which fills anyway fails the match, and counts an overflow; so each test also checks
+   the result and that nothing overflowed.
+*/
+
+// =============================== Tests start here ==================================
+
+
+/* -------------------------------------- setUp ------------------------------------------- */
+
+PRIVATE void * getMem(size_t numBytes) { return calloc(1, numBytes); }
+PRIVATE void myFree(void *p) { free(p); }
+
+#define _MaxInput 1000
+
+PRIVATE RegexLT_S_Cfg const cfg = {          // RegexLT_Init() keeps a pointer to this; so it's not on the stack.
+   .getMem        = getMem,
+   .free          = myFree,
+   .printEnable   = _TRACE_PRINTS_ON,
+   .maxSubmatches = 9,
+   .maxRegexLen   = MAX_U8,
+   .maxStrLen     = _MaxInput + 2 };
+
+void setUp(void) {
+   RegexLT_Init(&cfg);
+}
+
+/* -------------------------------------- tearDown ------------------------------------------- */
+
+void tearDown(void) {
+}
+
+/* ----------------------------------- Run and measure -----------------------------------
+
+   Match 'prog' against 'len' of 'fill' followed by 'tail'. Returns the match result, the
+   threads it took and the quickest of a few runs, in ns.
+*/
+typedef struct { T_RegexRtn rtn; U32 threads, overflows; double ns; } S_Cost;
+
+#define _TimingRuns 5
+
+PRIVATE double nowNs(void)
+{
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+PRIVATE S_Cost runOne(void *prog, C8 fill, U16 len, C8 const *tail)
+{
+   static C8 str[_MaxInput + 10];
+   S_Cost c = {.ns = 1e18};
+   U8 i;
+
+   memset(str, fill, len);
+   strcpy(str+len, tail);
+
+   for(i = 0; i < _TimingRuns; i++)
+   {
+      RegexLT_S_MatchList *ml = NULL;
+      RegexLT_S_Stats stats;
+      double t0 = nowNs();
+      c.rtn = RegexLT_MatchProgStats(prog, str, &ml, _RegexLT_Flags_None, &stats);
+      double ns = nowNs() - t0;
+      c.threads = stats.threads;             // Same every run.
+      c.overflows = stats.overflows;
+      if(ns < c.ns) { c.ns = ns; }
+      RegexLT_FreeMatches(ml);
+   }
+   return c;
+}
+
+/* A run at 'n' chars makes no more than its share of the threads of a run at the shortest,
+   plus a little slack for the fixed cost of a call.
+*/
+#define _WorkSlack  1.25
+
+PRIVATE BOOL scalesLinearly(S_Cost const *c0, U16 n0, S_Cost const *c, U16 n)
+{
+   return c->threads <= _WorkSlack * ((double)n / n0) * c0->threads + 10;
+}
+
+// -------------------------------- test_LinearInInput --------------------------------------
+
+void test_LinearInInput(void)
+{
+   typedef struct { C8 const *regex; C8 fill; C8 const *tail; T_RegexRtn rtn; } S_Tst;
+
+   S_Tst const tsts[] = {
+      // Nested and alternated repeats over a near-miss; a backtracker tries each way of splitting the 'a's.
+      { "(a|a)*b",               'a', "",    E_RegexRtn_NoMatch },
+      { "(a*)*b",                'a', "",    E_RegexRtn_NoMatch },
+      { "(a+)+b",                'a', "",    E_RegexRtn_NoMatch },
+      { "(aa|a)*b",              'a', "",    E_RegexRtn_NoMatch },
+      { "a*a*a*a*b",             'a', "",    E_RegexRtn_NoMatch },
+      { ".*.*.*b",               'a', "",    E_RegexRtn_NoMatch },
+      { "(a{2,5}){2,5}b",        'a', "",    E_RegexRtn_NoMatch },
+      { "a{1,3}a{1,3}a{1,3}b",   'a', "",    E_RegexRtn_NoMatch },
+
+      // ...and the same with the match at the far end.
+      { "(a|a)*b",               'a', "b",   E_RegexRtn_Match },
+      { "(a*)*b",                'a', "b",   E_RegexRtn_Match },
+      { "a*a*a*a*b",             'a', "b",   E_RegexRtn_Match },
+      { ".*.*.*b",               'a', "b",   E_RegexRtn_Match },
+   };
+
+   U16 const lens[] = { 100, 200, 400, 800 };
+   U8 i, l, fails;
+
+   for(i = 0, fails = 0; i < RECORDS_IN(tsts); i++)
+   {
+      S_Tst const *t = &tsts[i];
+      void *prog;
+
+      if(RegexLT_Compile(t->regex, &prog) != E_RegexRtn_OK)
+      {
+         printf("complexity fail #%u: \"%s\" didn't compile\r\n", i, t->regex);
+         fails++;
+         continue;
+      }
+
+      S_Cost c0 = runOne(prog, t->fill, lens[0], t->tail);
+
+      for(l = 0; l < RECORDS_IN(lens); l++)
+      {
+         S_Cost c = l == 0 ? c0 : runOne(prog, t->fill, lens[l], t->tail);
+
+         if(c.rtn != t->rtn || c.overflows != 0)
+         {
+            printf("complexity fail #%u: \"%s\" len %u: expected %s got %s, %lu overflows\r\n",
+               i, t->regex, lens[l], RegexLT_RtnStr(t->rtn), RegexLT_RtnStr(c.rtn), (unsigned long)c.overflows);
+            fails++;
+         }
+         else if(!scalesLinearly(&c0, lens[0], &c, lens[l]))
+         {
+            printf("complexity fail #%u: \"%s\" len %u -> %u: threads %lu -> %lu\r\n",
+               i, t->regex, lens[0], lens[l], (unsigned long)c0.threads, (unsigned long)c.threads);
+            fails++;
+         }
+         else if(l == RECORDS_IN(lens)-1)                         // For information; not checked.
+         {
+            printf("complexity: \"%s\" len %u -> %u: us %.0f -> %.0f\r\n", t->regex, lens[0], lens[l], c0.ns/1e3, c.ns/1e3);
+         }
+      }
+      RegexLT_FreeProgram(prog);
+   }
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+// -------------------------------- test_PolynomialInRegex --------------------------------------
+
+/* 'a?^n a^n' against 'a^n' i.e 'a?a?a?aaa' against 'aaa'. A backtracker takes 2^n tries,
+   giving up each optional 'a' in turn. Here the threads can be no more than the program is
+   long, so the work is at most n (threads) by n (chars).
+*/
+void test_PolynomialInRegex(void)
+{
+   U8 const ns[] = { 4, 8, 16, 32 };
+   U8 i, fails;
+   S_Cost c0;
+
+   for(i = 0, fails = 0; i < RECORDS_IN(ns); i++)
+   {
+      C8 regex[3*32 + 1];
+      U8 n = ns[i], j;
+      void *prog;
+
+      for(j = 0; j < n; j++)
+         { regex[2*j] = 'a'; regex[2*j+1] = '?'; }
+      memset(regex + 2*n, 'a', n);
+      regex[3*n] = '\0';
+
+      if(RegexLT_Compile(regex, &prog) != E_RegexRtn_OK)
+      {
+         printf("complexity fail: a?^%u a^%u didn't compile\r\n", n, n);
+         fails++;
+         continue;
+      }
+
+      S_Cost c = runOne(prog, 'a', n, "");
+      if(i == 0) { c0 = c; }
+
+      double sq = ((double)n / ns[0]) * ((double)n / ns[0]);
+
+      if(c.rtn != E_RegexRtn_Match || c.overflows != 0)
+      {
+         printf("complexity fail: a?^%u a^%u: expected Match got %s, %lu overflows\r\n", n, n, RegexLT_RtnStr(c.rtn), (unsigned long)c.overflows);
+         fails++;
+      }
+      else if(c.threads > _WorkSlack * sq * c0.threads + 10)
+      {
+         printf("complexity fail: a?^%u a^%u: threads %lu -> %lu\r\n",
+            n, n, (unsigned long)c0.threads, (unsigned long)c.threads);
+         fails++;
+      }
+      else                                                        // For information; not checked.
+      {
+         printf("complexity: a?^%u a^%u: us %.0f -> %.0f\r\n", n, n, c0.ns/1e3, c.ns/1e3);
+      }
+      RegexLT_FreeProgram(prog);
+   }
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+// ----------------------------------------- eof --------------------------------------------
@@ -80,6 +80,8 @@ typedef struct {
    S_OneMatchChk ms[_MaxMatchChks];
 } S_MatchesCheck;
 
+#define _NoGroup {MAX_U16, 0}       // Group took no part in the match; it's slot is empty.
+
 
 typedef struct {
    C8 const        * regex;         // Search expression.
@@ -120,6 +122,15 @@ PRIVATE BOOL matchesOK(C8 *out, RegexLT_S_MatchList const *ml, S_MatchesCheck co
       RegexLT_S_Match const *m = &ml->matches[c];
       S_OneMatchChk const *ck = &chk->ms[c];
 
+      if(ck->idx == MAX_U16)        // Expect an empty slot?
+      {
+         if(m->at != NULL)
+         {
+            sprintf(out, "\tWrong match: %d reqd [- -] got [%d %d]  [start,len]!\r\n", c, m->idx, m->len);
+            rtn = FALSE;
+         }
+         continue;
+      }
       if(m->idx != ck->idx || m->len != ck->len)
       {
          sprintf(out, "\tWrong match: %d reqd [%d %d] got [%d %d]  [start,len]!\r\n",
@@ -143,9 +154,10 @@ PRIVATE C8 const *printFlags(C8 *out, RegexLT_T_Flags f)
    }
    else
    {
-      sprintf(out, "<%s %s>",
+      sprintf(out, "<%s %s %s>",
            f & _RegexLT_Flags_MatchLongest ? "match-longest" : "",
-           f & _RegexLT_Flags_MatchLast ? "match-last" : "");
+           f & _RegexLT_Flags_MatchLast ? "match-last" : "",
+           f & _RegexLT_Flags_MatchFirst ? "match-first" : "");
    }
    return out;
 }
@@ -161,7 +173,7 @@ PRIVATE BOOL runOneTest_PrintOneLine(U16 idx, S_Test const *t, bool printAllTest
    RegexLT_S_MatchList *ml = NULL;
 
    C8 rgx[200];
-   sprintf(rgx, "%-2d:   \'%-15s\' <- \'%-15s\' %s", idx, t->regex, t->src, printFlags((C8[30]){}, t->flags));           // Print the  regex and test string.
+   snprintf(rgx, sizeof(rgx), "%-2d:   \'%-15s\' <- \'%-15s\' %s", idx, t->regex, t->src, printFlags((C8[30]){}, t->flags));           // Print the  regex and test string.
 
    if(t->replace == NULL)                                                           // This test is a match-only, no replace?
    {
@@ -276,9 +288,24 @@ void test_Finds(void)
       { ".*de{1}f",     "abcdeefghij",          E_RegexRtn_NoMatch,  {0, {}}              },       // Exactly 1 'e' in 'deef' -> no match.
       { ".*de{3}f",     "abcdeefghij",          E_RegexRtn_NoMatch,  {0, {}}              },
 
+      { "a{3}b",        "aaaab",                E_RegexRtn_Match,    {1, {{1,4}}}         },       // Exactly 3 'a' ahead of 'b'; the leading 'a' is dropped.
+      { "x{1,12}y",     "bxxxxxxxxxxxxxxxy",    E_RegexRtn_Match,    {1, {{4,13}}}        },       // 15 'x', take the last 12 -> 'xxxxxxxxxxxxy'.
+      { "ab{2,3}c",     "abbbbc abbbc",         E_RegexRtn_Match,    {1, {{7,5}}}         },       // 'abbbbc' has 4 'b'; too many.
+
+      // Runs of a single char or class; these compile to 'Span'.
+      { "\\d+",          "x123y",                E_RegexRtn_Match,    {1, {{1,3}}}         },       // The whole run.
+      { "\\d+",          "3.14159",              E_RegexRtn_Match,    {1, {{0,1}}}         },       // The first run.
+      { "\\d+x",         "12 345x",              E_RegexRtn_Match,    {1, {{3,4}}}         },       // 1st run isn't followed by 'x'; 2nd is.
+      { "\\d+$",         "3.14159",              E_RegexRtn_Match,    {1, {{2,5}}}         },
+      { "\\d{2,}x",      "1x 22x",               E_RegexRtn_Match,    {1, {{3,3}}}         },       // '1' is too short a run.
+      { "[0-9A-F]{4}",  "555-1234",             E_RegexRtn_Match,    {1, {{4,4}}}         },
+      { "x[0-9]*y",     "x12z x345y",           E_RegexRtn_Match,    {1, {{5,5}}}         },
+      { "x[0-9]*y",     "xy",                   E_RegexRtn_Match,    {1, {{0,2}}}         },       // Zero repeats.
+      { "a.*",          "baaaa",                E_RegexRtn_Match,    {1, {{1,4}}}         },       // '.*' at the end takes the rest.
+
       { "def",          "abcdefghij",           E_RegexRtn_Match,    {1, {{3,3}}}         },
       { ".*d(e*)f",     "abcdeefghij",          E_RegexRtn_Match,    {2, {{0,7}, {4,2}}}  },
-      { ".*d(ef)+",     "abcdefefghij",         E_RegexRtn_Match,    {2, {{0,8}, {4,4}}}  },
+      { ".*d(ef)+",     "abcdefefghij",         E_RegexRtn_Match,    {2, {{0,8}, {6,2}}}  },       // A repeated group holds it's last pass.
       { ".*de+f",       "abcdeefghij",          E_RegexRtn_Match,    {1, {{0,7}}}         },
       { "ab+",          "abbbbefghij",          E_RegexRtn_Match,    {1, {{0,5}}}         },
       { "b+",           "abbbbefghij",          E_RegexRtn_Match,    {1, {{1,4}}}         },
@@ -302,13 +329,41 @@ void test_Finds(void)
       { "34+",          "2344456344448",        E_RegexRtn_Match,    {1, {{1,4}}}         },
       { "34+",          "2344456344448123445",  E_RegexRtn_Match,    {1, {{1,4}}}   },
       { "34+",          "2344456344448123445",  E_RegexRtn_Match,    {1, {{7,5}}},  _RegexLT_Flags_MatchLongest   },
+      // Sub-matches are captured on the global match only, after a long lead of mismatches.
+      { "(ab)+c",       "zzzzzzzzzzzzzzzzabababc",    E_RegexRtn_Match,    {2, {{16,7},{20,2}}}   },
+      { "a(bc)+d",      "zzzzzzzzzzzzzzzzzzxabcbcd",  E_RegexRtn_Match,    {2, {{19,6},{22,2}}}   },
+      { "a(bc)+d",      "zzzzzzzzzzzzzzzzzzxabcbce",  E_RegexRtn_NoMatch,  {0, {}}                },
+      // ...from the one global match found first; the same start and the same end.
+      { "([ca]{1,5}c*)+",   "cca11aabacaa1",      E_RegexRtn_Match,    {2, {{0,3},{0,3}}}     },
+      { "([ba]{2,3})",      " ca1ab1 1bb1ac",     E_RegexRtn_Match,    {2, {{4,2},{4,2}}}     },
+      { ".{0,3}([ab])*",    "ca    1b",           E_RegexRtn_Match,    {1, {{0,3}}}           },
+      // A search which eats to the end of the input without a leading match ends; the others may still match.
+      { "(cb)*",            "c",                  E_RegexRtn_Match,    {1, {{0,0}}}           },
+      { "[ab]|1aa$",        "1a",                 E_RegexRtn_Match,    {1, {{1,1}}}           },
       { "34+",          "2344456344448123445",  E_RegexRtn_Match,    {1, {{15,3}}}, _RegexLT_Flags_MatchLast      },
+      // The last match is found from the end back; past any number of earlier ones, and with its captures.
+      { "\\d+",         "1 22 333 4444 5 66 77 8 9 10 11 12 13", E_RegexRtn_Match, {1, {{35,2}}}, _RegexLT_Flags_MatchLast },
+      { "\\d+",         "ab123",                E_RegexRtn_Match,    {1, {{2,3}}},  _RegexLT_Flags_MatchLast      },
+      { "[0-9]{4}",     "98372",                E_RegexRtn_Match,    {1, {{1,4}}},  _RegexLT_Flags_MatchLast      },   // Starts last; overlaps '9837'.
+      { "(\\d)\\d{3}",     "98372",                E_RegexRtn_Match,    {2, {{1,4},{1,1}}},  _RegexLT_Flags_MatchLast },
+      { "(\\d+)\\.(\\d+)", "v 1.2 and 33.44 end", E_RegexRtn_Match,  {3, {{10,5},{10,2},{13,2}}}, _RegexLT_Flags_MatchLast },
+      { "zz",           "2344456344448123445",  E_RegexRtn_NoMatch,  {0, {}},       _RegexLT_Flags_MatchLast      },
       { matchPhone1,    "414 777 9214",         E_RegexRtn_Match,    {1, {{0,12}}}  },
       { matchPhone1,    "414-777-9214",         E_RegexRtn_Match,    {1, {{0,12}}}  },
       { matchPhone1,    "tel 414-777-9214 nn",  E_RegexRtn_Match,    {1, {{4,12}}}  },
       { "\\(\\d{3}\\)[ \\-]?\\d{3}[ \\-]?\\d{4}",    "(414) 777 9214",      E_RegexRtn_Match,    {1, {{0,14}}}  },
       { "\\(?\\d{3}\\)?[ \\-]?\\d{3}[ \\-]?\\d{4}",    "(414)-777-9214 nn",  E_RegexRtn_Match,    {1, {{0,14}}}  },
       { "\\(?\\d{3}\\)?[ \\-]?\\d{3}[ \\-]?\\d{4}",    "414-777-9214 nn",  E_RegexRtn_Match,    {1, {{0,12}}}  },
+      // '+', '[' and ']' escaped are literals.
+      { "AT\\+CSQ",       "OK AT+CSQ",            E_RegexRtn_Match,    {1, {{3,6}}}   },
+      { "\\+\\d+",         "tel +44 20",           E_RegexRtn_Match,    {1, {{4,3}}}   },
+      { "\\[\\d+\\]",       "a[12]b",               E_RegexRtn_Match,    {1, {{1,4}}}   },
+      { "\\[\\d+\\]",       "a12b",                 E_RegexRtn_NoMatch,  {0, {}}        },
+      // A real match beats an empty one found before it.
+      { "c*",             "bbcbbcb11",            E_RegexRtn_Match,    {1, {{2,1}}}   },
+      { "((b+aba+){0,})?bb*|a", "11cb1",          E_RegexRtn_Match,    {1, {{3,1}}}   },
+      { "a*",             "bbb",                  E_RegexRtn_Match,    {1, {{0,0}}}   },    // Only empty ones; the leftmost.
+      { "((\\d?\\d?)+)+",    "",                     E_RegexRtn_Match,    {1, {{0,0}}}   },    // Empty at the end; nothing read past it.
 
       //{ "(34){2}",          "2343456",        E_RegexRtn_Match,    {1, {{1,4}}}         },      // ******* Repeated capturing group should only snag the last '34'.
 
@@ -354,6 +409,27 @@ void test_Groups(void)
    S_Test const tests[] = {
         { "34",               "1234343456",        E_RegexRtn_Match,    {1, {{2,2}}}         },
       { "34+",          "2344456344448123445",  E_RegexRtn_Match,    {1, {{7,5}}},  _RegexLT_Flags_MatchLongest   },
+      // Each group has it's own slot, in order of it's '('; an empty slot if the group didn't take part.
+      { "(q)|d(og)",          "dog",               E_RegexRtn_Match,    {3, {{0,3}, _NoGroup, {1,2}}}   },
+      { "c(a)*t(s)",          "cts",               E_RegexRtn_Match,    {3, {{0,3}, _NoGroup, {2,1}}}   },
+      { "c(a)*t(s)",          "cats",              E_RegexRtn_Match,    {3, {{0,4}, {1,1}, {3,1}}}      },
+      { "(\\d+)x",            "12 345x",           E_RegexRtn_Match,    {2, {{3,4}, {3,3}}}             },
+      // Threads equivalent but for their captures aren't merged; the captures of the match come out, unchanged.
+      { "([a-c]+)1",          "zzab1",             E_RegexRtn_Match,    {2, {{2,3}, {2,2}}}             },
+      { ".{1,5}aa?(.{1,4}..*)", "xbaab1c",         E_RegexRtn_Match,    {2, {{0,7}, {4,3}}}             },
+      { "(.[cb]?c){0,}[ca]?", "1bc a",             E_RegexRtn_Match,    {2, {{0,3}, {0,3}}}             },
+      { "^(c{0,1})c{0,}",     "ccc",               E_RegexRtn_Match,    {2, {{0,3}, {0,1}}}             },
+      // A group repeated holds it's last pass; a repeat inside a group, all of it.
+      { "(a|b)+c",            "xxababc",           E_RegexRtn_Match,    {2, {{2,5}, {5,1}}}             },
+      { "(ab)+c",             "ababc",             E_RegexRtn_Match,    {2, {{0,5}, {2,2}}}             },
+      { "([ba]{2,3})",        " ca1ab1 1bb1ac",    E_RegexRtn_Match,    {2, {{4,2}, {4,2}}}             },
+      { "([ba]){2,3}",        " ca1ab1 1bb1ac",    E_RegexRtn_Match,    {2, {{4,2}, {5,1}}}             },
+      { "(ab*)+c",            "abbabac",           E_RegexRtn_Match,    {2, {{0,7}, {5,1}}}             },
+      // A group closes where a repeat it ends is skipped e.g the 'b*' here.
+      { "\\da?(a[ca]b*)+(.{1,}b)", "1aacb1b",      E_RegexRtn_Match,    {3, {{0,7}, {2,3}, {5,2}}}, _RegexLT_Flags_MatchFirst },
+      { "(a[ca]b*)+x",        "aabacbbaax",        E_RegexRtn_Match,    {2, {{0,10}, {7,2}}}            },
+      // Each pass of a repeated group counts its inner repeats afresh.
+      { "((\\d\\d){1,4}c*[ab]{0,}b)+b?[ab]", " aa11bccbb", E_RegexRtn_NoMatch, {0, {}}                   },
 //      { "34",             "1234343456",        E_RegexRtn_Match,    {1, {{2,2}}}         },
       //{ "(34){2}",          "1234343456",        E_RegexRtn_Match,    {1, {{4,4}}}         },
    };
@@ -439,4 +515,584 @@ void test_IPAddr(void)
    }
 }
 
+/* -------------------------------- test_LargeRepeats --------------------------------------
+
+   Repeat counts well beyond the number of threads the run-time could hold if each
+   count got its own thread.
+*/
+
+void test_LargeRepeats(void)
+{
+   RegexLT_S_Cfg cfg = {
+      .getMem        = getMemCleared,
+      .free          = myFree,
+      .printEnable   = _TRACE_PRINTS_ON,
+      .maxSubmatches = 9,
+      .maxRegexLen   = MAX_U8,
+      .maxStrLen     = 1000 };
+
+   RegexLT_Init(&cfg);
+
+   #define _HexRecLen 512
+   C8 hex[_HexRecLen+10];                                   // 'zz' + 512 hex digits + 'Q'
+   C8 xs[300];                                              // 'b' + 250 'x' + 'y'
+   U16 c;
+
+   strcpy(hex, "zz");
+   for(c = 0; c < _HexRecLen; c++)
+      { hex[c+2] = "0123456789ABCDEF"[c % 16]; }
+   strcpy(&hex[_HexRecLen+2], "Q");
+
+   xs[0] = 'b';
+   memset(&xs[1], 'x', 250);
+   strcpy(&xs[251], "y");
+
+   S_Test const tests[] = {
+      { "[0-9A-F]{512}",      hex,        E_RegexRtn_Match,    {1, {{2,512}}}       },
+      { "[0-9A-F]{512}Q",     hex,        E_RegexRtn_Match,    {1, {{2,513}}}       },
+      { "[0-9A-F]{513}",      hex,        E_RegexRtn_NoMatch,  {0, {}}              },
+      { "x{1,200}y",          xs,         E_RegexRtn_Match,    {1, {{51,201}}}      },    // Only the last 200 'x' may be taken.
+      { "x{1,200}.y",         xs,         E_RegexRtn_Match,    {1, {{50,202}}}      },    // '.' may also take an 'x'; so runs as a counted loop, not a 'Span'.
+      { "x{300,}y",           xs,         E_RegexRtn_NoMatch,  {0, {}}              },
+      { "a{70000}",           "aaa",      E_RegexRtn_CompileFailed, {0, {}}         },    // Counts must be no more than 65535.
+      { ".{3,6}c",            "c1 c a1c1  b1", E_RegexRtn_Match, {1, {{0,4}}}       },    // Counts dropped past 6 start later; mustn't displace the leftmost match.
+   };
+
+   U8 fails;
+   for(c = 0, fails = 0; c < RECORDS_IN(tests); c++)
+   {
+      tdd_TestNum = c;
+      if( runOneTest_PrintOneLine(c, &tests[c], _PrintFailsOnly) == FALSE)
+         { fails++; }
+   }
+   if(fails > 0)
+   {
+      printf("\r\n------- %d Fail(s) --------\r\n", fails);
+      TEST_FAIL();
+   }
+}
+
+/* -------------------------------- test_IsMatch --------------------------------------
+
+   Capture-free RegexLT_IsMatch() must agree with RegexLT_Match() on yes/no. And because
+   threads hold no matches, the number of malloc()s must not grow with the number of threads.
+*/
+
+PRIVATE U16 getMemCalls = 0;
+
+PRIVATE void * getMemCounted(size_t numBytes)
+   { getMemCalls++; return getMemCleared(numBytes); }
+
+void test_IsMatch(void)
+{
+   RegexLT_S_Cfg cfg = {
+      .getMem        = getMemCounted,
+      .free          = myFree,
+      .printEnable   = _TRACE_PRINTS_ON,
+      .maxSubmatches = 9,
+      .maxRegexLen   = MAX_U8,
+      .maxStrLen     = MAX_U8 };
+
+   RegexLT_Init(&cfg);
+
+   S_Test const tests[] = {
+      // Regex            Test string                Result code
+      { "abc",             "xxabcxx",                 E_RegexRtn_Match     },
+      { "abc",             "xxabxcx",                 E_RegexRtn_NoMatch   },
+      { "^abc",            "xabc",                    E_RegexRtn_NoMatch   },
+      { "abc$",            "xabc",                    E_RegexRtn_Match     },
+      { "a(bc)+d",         "xabcbcd",                 E_RegexRtn_Match     },
+      { "a(bc)+d",         "xabcbd",                  E_RegexRtn_NoMatch   },
+      { "\\d+x",           "12 345x",                 E_RegexRtn_Match     },
+      { "x[0-9]*y",        "x12z x345z",              E_RegexRtn_NoMatch   },
+      { "[0-9A-F]{4}",     "555-1234",                E_RegexRtn_Match     },
+      { "(ab)*c(d|e)",     "xabababababababce",       E_RegexRtn_Match     },
+      { "(ab)*c(d|e)",     "xabababababababcf",       E_RegexRtn_NoMatch   },
+   };
+
+   U8 c, fails;
+   for(c = 0, fails = 0; c < RECORDS_IN(tests); c++)
+   {
+      S_Test const *t = &tests[c];
+      void *prog;
+      tdd_TestNum = c;
+
+      T_RegexRtn rtn;
+      if( (rtn = RegexLT_Compile(t->regex, &prog)) != E_RegexRtn_OK)
+      {
+         printf("%-2d: '%s' didn't compile: %s\r\n", c, t->regex, RegexLT_RtnStr(rtn));
+         fails++;
+         continue;
+      }
+
+      /* Once capture-free after a long lead, to get the fixed malloc() overhead; then on the test string.
+         (Not on just one char; that may lack a literal the regex must have, and so not be run at all.)
+      */
+      C8 longer[80];
+      snprintf(longer, sizeof(longer), "zzzzzzzzzzzzzzzzzzzzzzzzzzzzzz%s", t->src);
+      getMemCalls = 0;
+      RegexLT_IsMatch(prog, longer);
+      U16 fixedMallocs = getMemCalls;
+
+      getMemCalls = 0;
+      rtn = RegexLT_IsMatch(prog, t->src);
+
+      if(rtn != t->rtn) {
+         printf("%-2d: '%s' <- '%s' expected '%s' got '%s'\r\n", c, t->regex, t->src, RegexLT_RtnStr(t->rtn), RegexLT_RtnStr(rtn));
+         fails++; }
+      else if(getMemCalls != fixedMallocs) {
+         printf("%-2d: '%s' <- '%s' %u malloc()s; expected %u\r\n", c, t->regex, t->src, getMemCalls, fixedMallocs);
+         fails++; }
+      else if( (rtn = RegexLT_MatchProg(prog, t->src, NULL, _RegexLT_Flags_MatchLongest)) != t->rtn) {   // No match-list is also capture-free.
+         printf("%-2d: '%s' <- '%s' no match-list; expected '%s' got '%s'\r\n", c, t->regex, t->src, RegexLT_RtnStr(t->rtn), RegexLT_RtnStr(rtn));
+         fails++; }
+
+      RegexLT_FreeProgram(prog);
+   }
+   if(fails > 0)
+   {
+      printf("\r\n------- %d Fail(s) --------\r\n", fails);
+      TEST_FAIL();
+   }
+}
+
+/* -------------------------------- test_GroupMask --------------------------------------------
+
+   Only the groups asked for are recorded; the others are empty. The list is by group number
+   whatever the mask.
+*/
+void test_GroupMask(void)
+{
+   typedef struct { C8 const *regex, *src; RegexLT_T_Groups groups; S_MatchesCheck chk; } S_MaskTest;
+
+   S_MaskTest const tests[] = {
+      { "c(a)*t(s)",       "cats",        _RegexLT_Groups_All,    {3, {{0,4}, {1,1}, {3,1}}}         },
+      { "c(a)*t(s)",       "cats",        _RegexLT_Group(2),      {3, {{0,4}, _NoGroup, {3,1}}}      },
+      { "c(a)*t(s)",       "cats",        _RegexLT_Group(1),      {2, {{0,4}, {1,1}}}                },
+      { "c(a)*t(s)",       "cats",        _RegexLT_Groups_None,   {1, {{0,4}}}                       },
+      { "(\\d+)x",         "12 345x",     _RegexLT_Groups_None,   {1, {{3,4}}}                       },
+      { "(q)|d(og)",       "dog",         _RegexLT_Group(2),      {3, {{0,3}, _NoGroup, {1,2}}}      },
+   };
+
+   RegexLT_S_Cfg cfg = {
+      .getMem        = getMemCleared,
+      .free          = myFree,
+      .printEnable   = _TRACE_PRINTS_ON,
+      .maxSubmatches = 9,
+      .maxRegexLen   = MAX_U8,
+      .maxStrLen     = MAX_U8 };
+
+   RegexLT_Init(&cfg);
+
+   U8 c, fails;
+   C8 out[100];
+   for(c = 0, fails = 0; c < RECORDS_IN(tests); c++)
+   {
+      S_MaskTest const *t = &tests[c];
+      RegexLT_S_MatchList *ml = NULL;
+      void *prog;
+      T_RegexRtn rtn;
+      tdd_TestNum = c;
+
+      if( (rtn = RegexLT_Compile(t->regex, &prog)) != E_RegexRtn_OK)
+      {
+         printf("%-2d: '%s' didn't compile: %s\r\n", c, t->regex, RegexLT_RtnStr(rtn));
+         fails++;
+         continue;
+      }
+
+      if( (rtn = RegexLT_MatchProgGroups(prog, t->src, &ml, _RegexLT_Flags_None, t->groups)) != E_RegexRtn_Match) {
+         printf("%-2d: '%s' <- '%s' groups 0x%lx; got '%s'\r\n", c, t->regex, t->src, (unsigned long)t->groups, RegexLT_RtnStr(rtn));
+         fails++; }
+      else if(matchesOK(out, ml, &t->chk, t->src) == FALSE) {
+         printf("%-2d: '%s' <- '%s' groups 0x%lx\r\n%s", c, t->regex, t->src, (unsigned long)t->groups, out);
+         fails++; }
+
+      RegexLT_FreeMatches(ml);
+      RegexLT_FreeProgram(prog);
+   }
+   if(fails > 0)
+   {
+      printf("\r\n------- %d Fail(s) --------\r\n", fails);
+      TEST_FAIL();
+   }
+}
+
+/* -------------------------------- test_Possessive --------------------------------------------
+
+   '(?:...)' captures nothing. A possessive repeat, or an atomic group, never gives back what
+   it ate; so 'a*+a' can't match at all.
+*/
+void test_Possessive(void)
+{
+   S_Test const tests[] = {
+      { "(?:ab)+(c)",         "ababc",             E_RegexRtn_Match,    {2, {{0,5}, {4,1}}}             },
+      { "a*a",                "aaa",               E_RegexRtn_Match,    {1, {{0,3}}}                    },
+      { "a*+a",               "aaa",               E_RegexRtn_NoMatch,  {0}                             },
+      { "\\d++x",             "123x",              E_RegexRtn_Match,    {1, {{0,4}}}                    },
+      { "\\d++\\d",           "1234",              E_RegexRtn_NoMatch,  {0}                             },
+      { "a{1,2}+a",           "aaa",               E_RegexRtn_Match,    {1, {{0,3}}}                    },
+      { "a?+b",               "ab",                E_RegexRtn_Match,    {1, {{0,2}}}                    },
+      { "(?>a+)b",            "xaab",              E_RegexRtn_Match,    {1, {{1,3}}}                    },
+      { "(?>a+)a",            "aaa",               E_RegexRtn_NoMatch,  {0}                             },
+      // An atomic group which is more than a possessive repeat doesn't compile; nor does an unknown '(?'.
+      { "(?>a*ab)",           "aab",               E_RegexRtn_CompileFailed, {0}                        },
+      { "(?x)",               "a",                 E_RegexRtn_BadExpr,  {0}                             },
+   };
+
+   RegexLT_S_Cfg cfg = {
+      .getMem        = getMemCleared,
+      .free          = myFree,
+      .printEnable   = _TRACE_PRINTS_ON,
+      .maxSubmatches = 9,
+      .maxRegexLen   = MAX_U8,
+      .maxStrLen     = MAX_U8 };
+
+   RegexLT_Init(&cfg);
+
+   U8 c, fails;
+   for(c = 0, fails = 0; c < RECORDS_IN(tests); c++)
+   {
+      tdd_TestNum = c;
+      if( runOneTest_PrintOneLine(c, &tests[c], _PrintFailsOnly) == FALSE)
+         { fails++; }
+   }
+   if(fails > 0)
+   {
+      printf("\r\n------- %d Fail(s) --------\r\n", fails);
+      TEST_FAIL();
+   }
+}
+
+/* -------------------------------- test_MatchFirst --------------------------------------------
+
+   Leftmost-first, of the matches which start first the regex's preference wins, not the longest;
+   'cat|category' takes 'cat'. Threads behind a match are cut off.
+*/
+void test_MatchFirst(void)
+{
+   S_Test const tests[] = {
+      { "a|ab",               "ab",                E_RegexRtn_Match,    {1, {{0,1}}},  _RegexLT_Flags_MatchFirst  },
+      { "a|ab",               "ab",                E_RegexRtn_Match,    {1, {{0,2}}},  _RegexLT_Flags_None        },
+      { "cat|category",       "category",          E_RegexRtn_Match,    {1, {{0,3}}},  _RegexLT_Flags_MatchFirst  },
+      { "ab|a",               "xab",               E_RegexRtn_Match,    {1, {{1,2}}},  _RegexLT_Flags_MatchFirst  },
+      // Still leftmost; and greedy repeats still take all they can.
+      { "34+",                "2344456344448123445", E_RegexRtn_Match,  {1, {{1,4}}},  _RegexLT_Flags_MatchFirst  },
+      { "a{2,3}",             "aaaa",              E_RegexRtn_Match,    {1, {{0,3}}},  _RegexLT_Flags_MatchFirst  },
+      { "\\d+|x",             "ab12x",             E_RegexRtn_Match,    {1, {{2,2}}},  _RegexLT_Flags_MatchFirst  },
+      { "x\\d",               "ab12",              E_RegexRtn_NoMatch,  {0},           _RegexLT_Flags_MatchFirst  },
+      // Leftmost before preferred; and, as by default, a real match beats an empty one found before it.
+      { "a*",                 "bac",               E_RegexRtn_Match,    {1, {{1,1}}},  _RegexLT_Flags_MatchFirst  },
+      { "a*",                 "bac",               E_RegexRtn_Match,    {1, {{1,1}}},  _RegexLT_Flags_None        },
+      { "((b{0,2})*)",        "1aba1aab",          E_RegexRtn_Match,    {1, {{2,1}}},  _RegexLT_Flags_MatchFirst  },
+      { "a*",                 "bbb",               E_RegexRtn_Match,    {1, {{0,0}}},  _RegexLT_Flags_MatchFirst  },
+      { "|a",                 "a",                 E_RegexRtn_Match,    {1, {{0,0}}},  _RegexLT_Flags_MatchFirst  },
+      { ".{1,3}c+c*",         "b111a1cc1",         E_RegexRtn_Match,    {1, {{3,5}}},  _RegexLT_Flags_MatchFirst  },
+      { ".{1,3}a{0,}b",       "aca1aabc",          E_RegexRtn_Match,    {1, {{1,6}}},  _RegexLT_Flags_MatchFirst  },
+      { ".{1,3}a",            "bbc1bcaaccaa",      E_RegexRtn_Match,    {1, {{3,4}}},  _RegexLT_Flags_MatchFirst  },
+   };
+
+   RegexLT_S_Cfg cfg = {
+      .getMem        = getMemCleared,
+      .free          = myFree,
+      .printEnable   = _TRACE_PRINTS_ON,
+      .maxSubmatches = 9,
+      .maxRegexLen   = MAX_U8,
+      .maxStrLen     = MAX_U8 };
+
+   RegexLT_Init(&cfg);
+
+   U8 c, fails;
+   for(c = 0, fails = 0; c < RECORDS_IN(tests); c++)
+   {
+      tdd_TestNum = c;
+      if( runOneTest_PrintOneLine(c, &tests[c], _PrintFailsOnly) == FALSE)
+         { fails++; }
+   }
+
+   // 'a' matches before the thread for 'ab' is done; that one is cut off.
+   RegexLT_S_Stats stats;
+   RegexLT_S_MatchList *ml = NULL;
+   void *prog;
+
+   if(RegexLT_Compile("a|ab", &prog) != E_RegexRtn_OK ||
+      RegexLT_MatchProgStats(prog, "ab", &ml, _RegexLT_Flags_MatchFirst, &stats) != E_RegexRtn_Match ||
+      stats.pruned == 0)
+   {
+      printf("match-first fail: no threads cut off\r\n");
+      fails++;
+   }
+   RegexLT_FreeMatches(ml);
+   RegexLT_FreeProgram(prog);
+
+   if(fails > 0)
+   {
+      printf("\r\n------- %d Fail(s) --------\r\n", fails);
+      TEST_FAIL();
+   }
+}
+
+/* -------------------------------- test_Optimizer --------------------------------------
+
+   The optimizer should shrink these programs, and they must still match as before.
+*/
+
+void test_Optimizer(void)
+{
+   RegexLT_S_Cfg cfg = {
+      .getMem        = getMemCleared,
+      .free          = myFree,
+      .printEnable   = _TRACE_PRINTS_ON,
+      .maxSubmatches = 9,
+      .maxRegexLen   = MAX_U8,
+      .maxStrLen     = MAX_U8 };
+
+   RegexLT_Init(&cfg);
+
+   typedef struct { C8 const *regex, *src; T_RegexRtn rtn; RegexLT_S_ProgSize size; } S_OptTest;
+
+   S_OptTest const tests[] = {
+      // Regex            Test string       Result code            Compiled, Optimized
+      { "\\d{3}-\\d{4}",   "tel 555-1234",   E_RegexRtn_Match,      {8, 4} },
+      { "\\d{3}-\\d{4}",   "tel 555 1234",   E_RegexRtn_NoMatch,    {8, 4} },
+      { "a\\s*b",          "xa   b",         E_RegexRtn_Match,      {6, 4} },
+      { "x[0-9]*y",        "x12z x345y",     E_RegexRtn_Match,      {6, 4} },
+      { "a\\d+b\\d+c",     "a12b345c",       E_RegexRtn_Match,      {8, 6} },
+      { "a+b",             "caaab",          E_RegexRtn_Match,      {4, 3} },
+      { "abc",             "xxabcxx",        E_RegexRtn_Match,      {2, 2} },  // Nothing to take out.
+   };
+
+   U8 c, fails;
+   for(c = 0, fails = 0; c < RECORDS_IN(tests); c++)
+   {
+      S_OptTest const *t = &tests[c];
+      void *prog;
+      tdd_TestNum = c;
+
+      T_RegexRtn rtn;
+      if( (rtn = RegexLT_Compile(t->regex, &prog)) != E_RegexRtn_OK)
+      {
+         printf("%-2d: '%s' didn't compile: %s\r\n", c, t->regex, RegexLT_RtnStr(rtn));
+         fails++;
+         continue;
+      }
+
+      RegexLT_S_ProgSize sz = RegexLT_ProgramSize(prog);
+
+      if(sz.compiled != t->size.compiled || sz.optimized != t->size.optimized) {
+         printf("%-2d: '%s' size %u -> %u; expected %u -> %u\r\n", c, t->regex, sz.compiled, sz.optimized, t->size.compiled, t->size.optimized);
+         fails++; }
+      else if( (rtn = RegexLT_IsMatch(prog, t->src)) != t->rtn) {
+         printf("%-2d: '%s' <- '%s' expected '%s' got '%s'\r\n", c, t->regex, t->src, RegexLT_RtnStr(t->rtn), RegexLT_RtnStr(rtn));
+         fails++; }
+
+      RegexLT_FreeProgram(prog);
+   }
+   if(fails > 0)
+   {
+      printf("\r\n------- %d Fail(s) --------\r\n", fails);
+      TEST_FAIL();
+   }
+}
+
+/* -------------------------------- test_ClassInBox --------------------------------------------
+
+   A class starts a CharBox; chars after it share that box. A repeat binds only the char, class
+   or group just before it, never the whole box. And boxes which end at a class or a group's edge
+   are counted by prescan; these must compile, not overrun.
+*/
+void test_ClassInBox(void)
+{
+   S_Test const tests[] = {
+      { "a[bc]d",             "xacd",              E_RegexRtn_Match,    {1, {{1,3}}}                    },
+      { "ab[cd]",             "xabd",              E_RegexRtn_Match,    {1, {{1,3}}}                    },
+      { "b[ca]b{0,3}",        "xbabbbb",           E_RegexRtn_Match,    {1, {{1,5}}}                    },
+      { "b[ca]b{0,3}",        " c",                E_RegexRtn_NoMatch,  {0}                             },
+      { "b[ba]a?",            " c",                E_RegexRtn_NoMatch,  {0}                             },
+      { "aa[ca]c*",           " c",                E_RegexRtn_NoMatch,  {0}                             },
+      { "[ac][ac]b{0,1}a",    " cabaa",            E_RegexRtn_Match,    {1, {{1,4}}}                    },
+      { "[ca][cb]b?\\d",      "11ccc",             E_RegexRtn_NoMatch,  {0}                             },
+      { "a[ca]a*bb*",         "ba1",               E_RegexRtn_NoMatch,  {0}                             },
+      { "a[ca]a*bb*",         "xacabbb",           E_RegexRtn_Match,    {1, {{1,6}}}                    },
+      { "x\\db+",             "x1bbb",             E_RegexRtn_Match,    {1, {{0,5}}}                    },
+      { "[cb](\\daa).",       "b1aax",             E_RegexRtn_Match,    {2, {{0,5}, {1,3}}}             },
+      { "((\\dc+c)b)\\d",     "1ccb2",             E_RegexRtn_Match,    {1, {{0,5}}}                    },
+      { "b{0,}(b[a-c]c)?b",   "abbcbabbb",         E_RegexRtn_Match,    {2, {{1,4}, {1,3}}}             },    // Group of chars then a class, repeated.
+      { "(bc+|c.[^a]){0,2}bb", "bb",               E_RegexRtn_Match,    {1, {{0,2}}}                    },
+      { "abb[^a]|(c)?cb[^a]", "bbb1aab1ccc",       E_RegexRtn_NoMatch,  {0}                             },
+   };
+
+   RegexLT_S_Cfg cfg = {
+      .getMem        = getMemCleared,
+      .free          = myFree,
+      .printEnable   = _TRACE_PRINTS_ON,
+      .maxSubmatches = 9,
+      .maxRegexLen   = MAX_U8,
+      .maxStrLen     = MAX_U8 };
+
+   RegexLT_Init(&cfg);
+
+   U8 c, fails;
+   for(c = 0, fails = 0; c < RECORDS_IN(tests); c++)
+   {
+      tdd_TestNum = c;
+      if( runOneTest_PrintOneLine(c, &tests[c], _PrintFailsOnly) == FALSE)
+         { fails++; }
+   }
+   if(fails > 0)
+   {
+      printf("\r\n------- %d Fail(s) --------\r\n", fails);
+      TEST_FAIL();
+   }
+}
+
+/* -------------------------------- test_ReplaceProg --------------------------------------------
+
+   RegexLT_ReplaceProg() with a compiled program gives what RegexLT_Replace() does. It makes it's
+   own match list; so whatever was on the stack before doesn't matter.
+*/
+PRIVATE void dirtyStack(void)
+   { volatile U8 junk[256]; memset((void*)junk, 0xA5, sizeof(junk)); }
+
+void test_ReplaceProg(void)
+{
+   typedef struct { C8 const *regex, *src, *replace, *outChk; T_RegexRtn rtn; } S_Tst;
+
+   S_Tst const tests[] = {
+      // Regex            Test string          Replace              Result                Result code
+      { "(dog)|cat",      "bigdogs",           "My pet is a $1",    "My pet is a dog",    E_RegexRtn_Match     },
+      { "(\\d)-(\\d)",    "tel 5-1",           "$2 $1",             "1 5",                E_RegexRtn_Match     },
+      { "(\\d+)-(\\d+)",  "no number",         "$2 $1",             NULL,                 E_RegexRtn_NoMatch   },
+   };
+
+   RegexLT_S_Cfg cfg = {
+      .getMem        = getMemCleared,
+      .free          = myFree,
+      .printEnable   = _TRACE_PRINTS_ON,
+      .maxSubmatches = 9,
+      .maxRegexLen   = MAX_U8,
+      .maxStrLen     = MAX_U8 };
+
+   RegexLT_Init(&cfg);
+
+   U8 c, fails;
+   for(c = 0, fails = 0; c < RECORDS_IN(tests); c++)
+   {
+      S_Tst const *t = &tests[c];
+      C8 out[_OutBufSize];
+      void *prog;
+      tdd_TestNum = c;
+
+      if(RegexLT_Compile(t->regex, &prog) != E_RegexRtn_OK)
+      {
+         printf("%-2d: '%s' didn't compile\r\n", c, t->regex);
+         fails++;
+         continue;
+      }
+
+      dirtyStack();
+      T_RegexRtn rtn = RegexLT_ReplaceProg(prog, t->src, t->replace, out);
+
+      if(rtn != t->rtn) {
+         printf("%-2d: '%s' <- '%s' expected '%s' got '%s'\r\n", c, t->regex, t->src, RegexLT_RtnStr(t->rtn), RegexLT_RtnStr(rtn));
+         fails++; }
+      else if(t->outChk != NULL && strncmp(out, t->outChk, _OutBufSize) != 0) {
+         printf("%-2d: '%s' -> expected '%s' got '%s'\r\n", c, t->replace, t->outChk, out);
+         fails++; }
+
+      RegexLT_FreeProgram(prog);
+   }
+   if(fails > 0)
+   {
+      printf("\r\n------- %d Fail(s) --------\r\n", fails);
+      TEST_FAIL();
+   }
+}
+
+/* -------------------------------- test_GivesBackHeap --------------------------------------------
+
+   Each call gives back all the heap it got, whether it matched or not. And a program, freed or
+   failed to compile, gives back all of it, trunk and all.
+*/
+PRIVATE S16 blocksHeld = 0;      // getMem()s not yet free()d.
+
+PRIVATE void * getMemHeld(size_t numBytes)
+{
+   void *p;
+   if( (p = getMemCleared(numBytes)) != NULL)
+      { blocksHeld++; }
+   return p;
+}
+
+PRIVATE void freeHeld(void *p)
+{
+   if(p != NULL)
+      { blocksHeld--; }
+   myFree(p);
+}
+
+void test_GivesBackHeap(void)
+{
+   RegexLT_S_Cfg cfg = {
+      .getMem        = getMemHeld,
+      .free          = freeHeld,
+      .printEnable   = _TRACE_PRINTS_ON,
+      .maxSubmatches = 9,
+      .maxRegexLen   = MAX_U8,
+      .maxStrLen     = MAX_U8 };
+
+   RegexLT_Init(&cfg);
+
+   C8 const *srcs[] = { "tel 555-1234", "no number" };      // A match, and none.
+   C8 const *regex = "(\\d+)-(\\d+)";
+   C8 out[_OutBufSize];
+   void *prog;
+   U8 c, fails = 0;
+   S16 held = blocksHeld;
+
+   if(RegexLT_Compile(regex, &prog) != E_RegexRtn_OK)
+      { TEST_FAIL(); return; }
+   RegexLT_FreeProgram(prog);
+   if(blocksHeld != held) {
+      printf("RegexLT_FreeProgram() kept %d blocks\r\n", blocksHeld - held);
+      fails++; }
+
+   if(RegexLT_Compile("a{2,1}", &prog) != E_RegexRtn_CompileFailed || blocksHeld != held) {   // Prescans, but doesn't compile.
+      printf("Failed RegexLT_Compile() kept %d blocks\r\n", blocksHeld - held);
+      fails++; }
+
+   RegexLT_Compile(regex, &prog);
+
+   for(c = 0; c < RECORDS_IN(srcs); c++)
+   {
+      RegexLT_S_MatchList *ml = NULL;
+
+      held = blocksHeld;
+      RegexLT_Match(regex, srcs[c], &ml, _RegexLT_Flags_None);
+      RegexLT_FreeMatches(ml);
+      if(blocksHeld != held) {
+         printf("RegexLT_Match() on '%s' kept %d blocks\r\n", srcs[c], blocksHeld - held);
+         fails++; }
+
+      held = blocksHeld;
+      RegexLT_Replace(regex, srcs[c], "$2 $1", out);
+      if(blocksHeld != held) {
+         printf("RegexLT_Replace() on '%s' kept %d blocks\r\n", srcs[c], blocksHeld - held);
+         fails++; }
+
+      held = blocksHeld;
+      RegexLT_ReplaceProg(prog, srcs[c], "$2 $1", out);
+      if(blocksHeld != held) {
+         printf("RegexLT_ReplaceProg() on '%s' kept %d blocks\r\n", srcs[c], blocksHeld - held);
+         fails++; }
+   }
+   RegexLT_FreeProgram(prog);
+
+   if(fails > 0)
+   {
+      printf("\r\n------- %d Fail(s) --------\r\n", fails);
+      TEST_FAIL();
+   }
+}
+
 // ----------------------------------------- eof --------------------------------------------
@@ -0,0 +1,209 @@
+#include "libs_support.h"
+   #if _TARGET_IS == _TARGET_UNITY_TDD
+#include "unity.h"
+#define _TRACE_PRINTS_ON false
+   #else
+#define TEST_FAIL()
+#define _TRACE_PRINTS_ON true
+   #endif // _TARGET_IS
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "util.h"
+#include "regexlt_private.h"
+
+PUBLIC U16 tdd_TestNum;    // For labeling error messages with the test that failed.
+
+// =============================== Tests start here ==================================
+
+
+/* -------------------------------------- setUp ------------------------------------------- */
+
+PRIVATE U16 getMemsLeft = MAX_U16;        // Fail the getMem() after this many.
+
+PRIVATE void * getMem(size_t numBytes)
+{
+   if(getMemsLeft == 0)
+      { return NULL; }
+   getMemsLeft--;
+   return calloc(1, numBytes);
+}
+
+PRIVATE void myFree(void *p) { free(p); }
+
+PRIVATE RegexLT_S_Cfg const cfg = {          // RegexLT_Init() keeps a pointer to this; so it's not on the stack.
+   .getMem        = getMem,
+   .free          = myFree,
+   .printEnable   = _TRACE_PRINTS_ON,
+   .maxSubmatches = 9,
+   .maxRegexLen   = MAX_U8,
+   .maxStrLen     = MAX_U8 };
+
+void setUp(void) {
+   RegexLT_Init(&cfg);
+   getMemsLeft = MAX_U16;
+}
+
+/* -------------------------------------- tearDown ------------------------------------------- */
+
+void tearDown(void) {
+   RegexLT_TrackMem(NULL);
+}
+
+#define _Chk(cond)  if(!(cond)) { printf("mem fail line %u: %s\r\n", __LINE__, #cond); fails++; }
+
+// -------------------------------- test_TrackMem --------------------------------------
+
+void test_TrackMem(void)
+{
+   RegexLT_S_MemUse use;
+   RegexLT_S_MemCnts const *by = use.by;
+   void *prog;
+   RegexLT_S_MatchList *ml = NULL;
+   U8 fails = 0;
+
+   _Chk( RegexLT_TrackMem(&use) == TRUE );
+
+   // The program is all that's left after compiling.
+   _Chk( RegexLT_Compile("a(b+)c", &prog) == E_RegexRtn_OK );
+   _Chk( by[E_RegexMem_Program].live == sizeof(S_Program) );
+   _Chk( by[E_RegexMem_Instrs].live > 0 && by[E_RegexMem_CharSegs].live > 0 );
+   _Chk( by[E_RegexMem_ThreadLists].getMems == 0 );
+
+   // Can't stop while a program is out.
+   _Chk( RegexLT_TrackMem(NULL) == FALSE );
+
+   // The run gets and frees its threads; the match list is kept.
+   size_t progBytes = use.all.live;
+   _Chk( RegexLT_MatchProg(prog, "xxabbbcxx", &ml, _RegexLT_Flags_None) == E_RegexRtn_Match );
+   _Chk( by[E_RegexMem_ThreadLists].peak > 0 && by[E_RegexMem_ThreadLists].live == 0 );
+   _Chk( by[E_RegexMem_ThreadMatches].peak > 0 && by[E_RegexMem_ThreadMatches].live == 0 );
+   _Chk( by[E_RegexMem_MatchLists].live > 0 );
+   _Chk( use.all.live == progBytes + by[E_RegexMem_MatchLists].live );
+   _Chk( use.all.peak >= progBytes + by[E_RegexMem_ThreadLists].peak );
+
+   // Each purpose adds up to the whole.
+   size_t peaks = 0; U32 gets = 0; U8 i;
+   for(i = 0; i < _RegexMem_NumPurposes; i++)
+      { peaks += by[i].peak; gets += by[i].getMems; }
+   _Chk( gets == use.all.getMems && peaks >= use.all.peak );
+
+   RegexLT_FreeMatches(ml);
+   RegexLT_FreeProgram(prog);
+   _Chk( use.all.live == 0 && use.all.getMems == use.all.frees );
+   _Chk( RegexLT_TrackMem(NULL) == TRUE );
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+// -------------------------------- test_GetMemFails --------------------------------------
+
+/* Whichever getMem() fails, compile and match give back all they got.
+*/
+void test_GetMemFails(void)
+{
+   RegexLT_S_MemUse use;
+   U8 fails = 0;
+   U16 n;
+
+   for(n = 0; n < 60; n++)
+   {
+      void *prog = NULL;
+      RegexLT_S_MatchList *ml = NULL;
+
+      _Chk( RegexLT_TrackMem(&use) == TRUE );
+      getMemsLeft = n;
+
+      if(RegexLT_Compile("a(b+)c|d", &prog) == E_RegexRtn_OK)
+      {
+         RegexLT_MatchProg(prog, "xxabbbcxx", &ml, _RegexLT_Flags_None);
+         RegexLT_FreeMatches(ml);
+         RegexLT_FreeProgram(prog);
+      }
+      getMemsLeft = MAX_U16;
+
+      if(use.all.live != 0 || RegexLT_TrackMem(NULL) == FALSE)
+      {
+         printf("mem fail: getMem() #%u failed; %lu bytes kept\r\n", n, (unsigned long)use.all.live);
+         fails++;
+         break;
+      }
+   }
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+// -------------------------------- test_MemRequired --------------------------------------
+
+/* RegexLT_MemRequired() is never less than what compile and match actually hold.
+*/
+void test_MemRequired(void)
+{
+   typedef struct { C8 const *regex, *src; RegexLT_T_Flags flags; } S_Tst;
+
+   S_Tst const tsts[] = {
+      { "abc",                   "xxabcxx",                    _RegexLT_Flags_None },
+      { "a(b+)c",                "xxabbbbcxx",                 _RegexLT_Flags_None },
+      { "(\\d+)\\.(\\d+)",          "pi is 3.14159 or so",        _RegexLT_Flags_None },
+      { "eth0|eth1|eth2",        "dev eth2 up",                _RegexLT_Flags_None },     // Simplified; keeps the rewrite.
+      { "[a-z]+@[a-z]+",         "mail bob@example now",       _RegexLT_Flags_None },
+      { "\\d+",                  "1 22 333 4444 55",           _RegexLT_Flags_MatchLongest },
+      { "(a|b)c",                "ac bc ac",                   _RegexLT_Flags_MatchLast },
+      { "x\\w{2,4}y",            "xaby xabcy xabcdy",          _RegexLT_Flags_None },
+      { "a*a*b",                 "aaaaaaaaaaaaaaaaaab",        _RegexLT_Flags_None },
+   };
+
+   RegexLT_S_MemUse use;
+   U8 i, fails = 0;
+
+   for(i = 0; i < RECORDS_IN(tsts); i++)
+   {
+      S_Tst const *t = &tsts[i];
+      void *prog;
+      RegexLT_S_MatchList *ml = NULL;
+
+      size_t req = RegexLT_MemRequired(t->regex, strlen(t->src), t->flags);
+
+      RegexLT_TrackMem(&use);
+      if(RegexLT_Compile(t->regex, &prog) != E_RegexRtn_OK)
+      {
+         printf("mem fail #%u: '%s' didn't compile\r\n", i, t->regex);
+         fails++;
+      }
+      else
+      {
+         RegexLT_MatchProg(prog, t->src, &ml, t->flags);
+         RegexLT_FreeMatches(ml);
+         RegexLT_FreeProgram(prog);
+
+         if(req == 0 || use.all.peak > req)
+         {
+            printf("mem fail #%u: '%s' needs %lu bytes but took %lu\r\n", i, t->regex, (unsigned long)req, (unsigned long)use.all.peak);
+            fails++;
+         }
+      }
+      RegexLT_TrackMem(NULL);
+   }
+
+   // Bad regex or input too long for RegexLT_Init() is 0.
+   if(RegexLT_MemRequired("a[b", 10, _RegexLT_Flags_None) != 0 ||
+      RegexLT_MemRequired("ab", cfg.maxStrLen+1, _RegexLT_Flags_None) != 0)
+   {
+      printf("mem fail: bad regex or input not refused\r\n");
+      fails++;
+   }
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+// ----------------------------------------- eof --------------------------------------------
@@ -0,0 +1,162 @@
+#include "libs_support.h"
+   #if _TARGET_IS == _TARGET_UNITY_TDD
+#include "unity.h"
+#define _TRACE_PRINTS_ON false
+   #else
+#define TEST_FAIL()
+#define _TRACE_PRINTS_ON true
+   #endif // _TARGET_IS
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "util.h"
+#include "regexlt_private.h"
+
+PUBLIC U16 tdd_TestNum;    // For labeling error messages with the test that failed.
+
+// =============================== Tests start here ==================================
+
+
+/* -------------------------------------- setUp ------------------------------------------- */
+
+#define _PoolSize 20000
+
+PRIVATE U8 poolBuf[_PoolSize];
+
+PRIVATE RegexLT_S_Cfg const cfg = {          // RegexLT_Init() keeps a pointer to this; so it's not on the stack.
+   .getMem        = RegexLT_PoolGetMem,
+   .free          = RegexLT_PoolFree,
+   .printEnable   = _TRACE_PRINTS_ON,
+   .maxSubmatches = 9,
+   .maxRegexLen   = MAX_U8,
+   .maxStrLen     = MAX_U8 };
+
+void setUp(void) {
+   RegexLT_Init(&cfg);
+   RegexLT_PoolInit(poolBuf, sizeof(poolBuf));
+}
+
+/* -------------------------------------- tearDown ------------------------------------------- */
+
+void tearDown(void) {
+}
+
+#define _Chk(cond)  if(!(cond)) { printf("pool fail line %u: %s\r\n", __LINE__, #cond); fails++; }
+
+// -------------------------------- test_PoolBlocks --------------------------------------
+
+void test_PoolBlocks(void)
+{
+   U8 fails = 0;
+
+   U8 *a = RegexLT_PoolGetMem(24);
+   U8 *b = RegexLT_PoolGetMem(40);
+   U8 *c = RegexLT_PoolGetMem(24);
+
+   _Chk( a != NULL && b != NULL && c != NULL );
+   _Chk( a < b && b < c );
+   _Chk( (size_t)a % sizeof(void*) == 0 && (size_t)b % sizeof(void*) == 0 );
+
+   // Top block goes back to the pool; the next of any size goes there.
+   size_t hw = RegexLT_PoolHighWater();
+   RegexLT_PoolFree(c);
+   _Chk( RegexLT_PoolGetMem(16) == c );
+   _Chk( RegexLT_PoolHighWater() == hw );
+
+   // Others are kept for the same size, and come back zeroed.
+   memset(a, 0x55, 24);
+   RegexLT_PoolFree(a);
+   _Chk( RegexLT_PoolGetMem(40) != a );
+   U8 *a2 = RegexLT_PoolGetMem(24);
+   _Chk( a2 == a && a2[0] == 0 && a2[23] == 0 );
+
+   // Full is NULL.
+   _Chk( RegexLT_PoolGetMem(_PoolSize) == NULL );
+
+   // Reset goes back to the mark.
+   RegexLT_PoolReset();
+   _Chk( RegexLT_PoolGetMem(24) == a );
+
+   // And a pool too small to use is refused.
+   _Chk( RegexLT_PoolInit(poolBuf, 4) == FALSE );
+   _Chk( RegexLT_PoolGetMem(8) == NULL );
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+// -------------------------------- test_PoolMatches --------------------------------------
+
+/* Compile and match from the pool; the same as from the heap, and with RegexLT_PoolReset()
+   between matches the pool used stays put, however many.
+*/
+void test_PoolMatches(void)
+{
+   typedef struct { C8 const *src; T_RegexRtn rtn; RegexLT_T_MatchIdx idx; RegexLT_T_MatchLen len; } S_Tst;
+
+   S_Tst const tsts[] = {
+      { "id 123-4567 ok",        E_RegexRtn_Match,    3, 8 },
+      { "no number here",        E_RegexRtn_NoMatch,  0, 0 },
+      { "99-1234, 555-1234",     E_RegexRtn_Match,    9, 8 },
+      { "555-123",               E_RegexRtn_NoMatch,  0, 0 },
+   };
+
+   U8 fails = 0;
+   U16 i;
+   void *prog;
+   size_t hw = 0;
+
+   if(RegexLT_Compile("(\\d{3})-(\\d{4})", &prog) != E_RegexRtn_OK)
+   {
+      printf("pool fail: didn't compile\r\n");
+      TEST_FAIL();
+      return;
+   }
+   RegexLT_PoolMark();
+
+   for(i = 0; i < 100; i++)
+   {
+      S_Tst const *t = &tsts[i % RECORDS_IN(tsts)];
+      RegexLT_S_MatchList *ml = NULL;
+      T_RegexRtn rtn = RegexLT_MatchProg(prog, t->src, &ml, _RegexLT_Flags_None);
+
+      if(rtn != t->rtn ||
+         (rtn == E_RegexRtn_Match && (ml->matches[0].idx != t->idx || ml->matches[0].len != t->len)))
+      {
+         printf("pool fail #%u: '%s' got %s\r\n", i, t->src, RegexLT_RtnStr(rtn));
+         fails++;
+         break;
+      }
+      RegexLT_FreeMatches(ml);
+      RegexLT_PoolReset();
+
+      if(i == RECORDS_IN(tsts))                          // Each input once?
+         { hw = RegexLT_PoolHighWater(); }               // then that's the most the pool will be used.
+      else if(i > RECORDS_IN(tsts) && RegexLT_PoolHighWater() != hw)
+      {
+         printf("pool fail: used %lu then %lu\r\n", (unsigned long)hw, (unsigned long)RegexLT_PoolHighWater());
+         fails++;
+         break;
+      }
+   }
+
+   // Tags, and blocks kept by size, take the pool a little past what the heap would need; but not far.
+   size_t req = RegexLT_MemRequired("(\\d{3})-(\\d{4})", MAX_U8, _RegexLT_Flags_None);
+   _Chk( RegexLT_PoolHighWater() <= 2 * req );
+
+   RegexLT_FreeProgram(prog);
+
+   // A pool too small says so.
+   RegexLT_PoolInit(poolBuf, 200);
+   _Chk( RegexLT_Compile("(\\d{3})-(\\d{4})", &prog) == E_RegexRtn_OutOfMemory );
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+// ----------------------------------------- eof --------------------------------------------
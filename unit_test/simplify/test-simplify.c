@@ -0,0 +1,171 @@
+#include "libs_support.h"
+   #if _TARGET_IS == _TARGET_UNITY_TDD
+#include "unity.h"
+#define _TRACE_PRINTS_ON false
+   #else
+#define TEST_FAIL()
+#define _TRACE_PRINTS_ON true
+   #endif // _TARGET_IS
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "util.h"
+#include "regexlt_private.h"
+
+PUBLIC U16 tdd_TestNum;    // For labeling error messages with the test that failed.
+
+// =============================== Tests start here ==================================
+
+
+/* -------------------------------------- setUp ------------------------------------------- */
+
+PRIVATE void * getMem(size_t numBytes) { return malloc(numBytes); }
+PRIVATE void myFree(void *p) { free(p); }
+
+PRIVATE RegexLT_S_Cfg const cfg = {          // RegexLT_Init() keeps a pointer to this; so it's not on the stack.
+   .getMem        = getMem,
+   .free          = myFree,
+   .printEnable   = _TRACE_PRINTS_ON,
+   .maxSubmatches = 9,
+   .maxRegexLen   = MAX_U8,
+   .maxStrLen     = MAX_U8 };
+
+void setUp(void) {
+   RegexLT_Init(&cfg);
+}
+
+/* -------------------------------------- tearDown ------------------------------------------- */
+
+void tearDown(void) {
+}
+
+// -------------------------------- test_Simplify --------------------------------------
+
+void test_Simplify(void)
+{
+   typedef struct { C8 const *regex, *rtn; } S_Tst;    // 'rtn' == NULL if regex is to be left as is.
+
+   S_Tst const tsts[] = {
+      // Nothing to rewrite
+      { "abc",                NULL },
+      { "a+b*c?",             NULL },
+      { "cat|dog",            NULL },
+      { "abc|abd|xyz",        NULL },     // Differ in more than 1 place.
+      { "(a)b|(a)c",          NULL },     // Merging would lose a subgroup.
+
+      // Single chars to a class
+      { "a|b",                "[ab]" },
+      { "a|b|c",              "[abc]" },
+      { "a|b|xyz",            "[ab]|xyz" },
+      { "xyz|a|b|c",          "xyz|[abc]" },
+      { "a|xyz|b",            NULL },     // Leftmost-first, 'xyz' is preferred to 'b'.
+      { "a|bc|b",             NULL },
+      { "(a|b)c",             "([ab])c" },
+      { "a|a",                "a" },
+
+      // Common parts
+      { "abc|abd",            "ab[cd]" },
+      { "eth0|eth1|eth2",     "eth[012]" },
+      { "ac|bc",              "[ab]c" },
+      { "x(ab1|ab2)y",        "x(ab[12])y" },
+      { "\\da|\\db",          "\\d[ab]" },
+      { "\\d+a|\\d+b",        NULL },     // Differ in one char; but a repeat might match a different length.
+      { ".*b|.*c",            NULL },
+      { "^ab|^ac",            "^a[bc]" },
+      { "a.|b.",              "[ab]." },
+
+      // Nested repeats
+      { "x(?:a*)*",           "xa*" },
+      { "x(?:a+)+",           "xa+" },
+      { "x(?:a+)?",           "xa*" },
+      { "x(?:\\d?)*",          "x\\d*" },
+      { "x(?:[ab]*)+",        "x[ab]*" },
+      { "(?:a*)*",            NULL },     // Leads the regex; see simplify().
+      { "b?(?:a+)?c",         NULL },
+      { "x|(?:a+)?b|y",       NULL },
+      { "(?:ab*)?",           NULL },     // Not a repeat inside.
+      { "(?:(?:ab)*)*",       NULL },     // Repeats more than a char.
+      { "(?:a*){2}",          NULL },
+      { "(a*)*",              NULL },     // Captures; it's last pass might change.
+      { "(?:(a)*)*",          NULL },     // Holds a group which captures.
+      { "(ab(b*)*)?",         NULL },
+      { "((cca+bcccab)?)?$",  NULL },
+      { "(?>a+)*",            NULL },     // Atomic; not the same as '(?>a*)'.
+      { "a*+|b*+",            NULL },     // Possessive; the '+' isn't another repeat.
+      { "(?:a|b)c",           "(?:[ab])c" },
+
+      // Left alone
+      { "\\ia|b",             NULL },     // Case-insensitive; a set might not be.
+      { ".|a",                NULL },     // '.' isn't a char.
+      { "[ab]|c",             NULL },
+   };
+
+   U8 i, fails;
+
+   for(i = 0, fails = 0; i < RECORDS_IN(tsts); i++)
+   {
+      S_Tst const *t = &tsts[i];
+      C8 *rtn = regexlt_simplifyRegex(t->regex);
+
+      if( (rtn == NULL) != (t->rtn == NULL) || (rtn != NULL && strcmp(rtn, t->rtn) != 0) )
+      {
+         printf("simplify fail #%u: \"%s\" -> \"%s\" but got \"%s\"\r\n",
+            i, t->regex, t->rtn == NULL ? "(as is)" : t->rtn, rtn == NULL ? "(as is)" : rtn);
+         fails++;
+      }
+      free(rtn);
+   }
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+/* -------------------------------- test_SimplifiedMatches --------------------------------------
+
+   Whether or not a regex is rewritten, it must match as written. These each went wrong with a
+   rewrite, or with the compile changes which came with it.
+*/
+void test_SimplifiedMatches(void)
+{
+   typedef struct { C8 const *regex, *str; T_RegexRtn rtn; U16 idx, len; } S_Tst;
+
+   S_Tst const tsts[] = {
+      { "abb[^a]|(c)?cb[^a]",    "bbb1aab1ccc",    E_RegexRtn_NoMatch,  0, 0 },
+      { "(bc+|c.[^a]){0,2}bb",   "bb",             E_RegexRtn_Match,    0, 2 },
+      { "b{0,}(b[a-c]c)?b",      "abbcbabbb",      E_RegexRtn_Match,    1, 4 },
+      { "((cca+bcccab)?)?$",     "",               E_RegexRtn_Match,    0, 0 },
+      { "(ab(b*)*)?",            "abbb",           E_RegexRtn_Match,    0, 4 },
+      { "a|xyz|x",               "xyz",            E_RegexRtn_Match,    0, 3 },
+      { "eth0|eth1",             "ifeth1",         E_RegexRtn_Match,    2, 4 },
+      { "(?:a+)?b",              "aab",            E_RegexRtn_Match,    0, 3 },
+      { "((?:a*)?){0,2}[^a]+(x?)+", "bxcaxb1ccc",  E_RegexRtn_Match,    0, 3 },
+      { "(?:(?:a*)?)+(b*|(c\\d+)((b[ab]+)*)+)b", "a1bxc1bc", E_RegexRtn_Match, 2, 1 },
+   };
+
+   U8 i, fails;
+
+   for(i = 0, fails = 0; i < RECORDS_IN(tsts); i++)
+   {
+      S_Tst const *t = &tsts[i];
+      RegexLT_S_MatchList *ml = NULL;
+      T_RegexRtn rtn = RegexLT_Match(t->regex, t->str, &ml, _RegexLT_Flags_None);
+
+      if(rtn != t->rtn ||
+         (rtn == E_RegexRtn_Match && (ml == NULL || ml->matches[0].idx != t->idx || ml->matches[0].len != t->len)))
+      {
+         printf("match fail #%u: '%s' on \"%s\"\r\n", i, t->regex, t->str);
+         fails++;
+      }
+      RegexLT_FreeMatches(ml);
+   }
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+// ----------------------------------------- eof --------------------------------------------
@@ -0,0 +1,104 @@
+#include "libs_support.h"
+   #if _TARGET_IS == _TARGET_UNITY_TDD
+#include "unity.h"
+#define _TRACE_PRINTS_ON false
+   #else
+#define TEST_FAIL()
+#define _TRACE_PRINTS_ON true
+   #endif // _TARGET_IS
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "util.h"
+#include "regexlt_private.h"
+
+PUBLIC U16 tdd_TestNum;    // For labeling error messages with the test that failed.
+
+/* RegexLT_MatchProgStats(); what a run counts as it goes, and that each call counts afresh.
+*/
+
+// =============================== Tests start here ==================================
+
+
+/* -------------------------------------- setUp ------------------------------------------- */
+
+PRIVATE void * getMem(size_t numBytes) { return calloc(1, numBytes); }
+PRIVATE void myFree(void *p) { free(p); }
+
+PRIVATE RegexLT_S_Cfg const cfg = {          // RegexLT_Init() keeps a pointer to this; so it's not on the stack.
+   .getMem        = getMem,
+   .free          = myFree,
+   .printEnable   = _TRACE_PRINTS_ON,
+   .maxSubmatches = 9,
+   .maxRegexLen   = MAX_U8,
+   .maxStrLen     = MAX_U8 };
+
+void setUp(void) {
+   RegexLT_Init(&cfg);
+}
+
+/* -------------------------------------- tearDown ------------------------------------------- */
+
+void tearDown(void) {
+}
+
+// -------------------------------- test_Stats --------------------------------------
+
+void test_Stats(void)
+{
+   void *prog;
+   RegexLT_S_MatchList *ml = NULL;
+   RegexLT_S_Stats st;
+   U8 fails = 0;
+
+   if(RegexLT_Compile("b(c+)d", &prog) != E_RegexRtn_OK)
+   {
+      printf("stats fail: didn't compile\r\n");
+      TEST_FAIL();
+      return;
+   }
+
+   if(RegexLT_MatchProgStats(prog, "aabcccde", &ml, _RegexLT_Flags_None, &st) != E_RegexRtn_Match)
+      { printf("stats fail: no match\r\n"); fails++; }
+   else
+   {
+      if(st.matches != 2)                                         // The global match and '(c+)'.
+         { printf("stats fail: %u matches\r\n", st.matches); fails++; }
+
+      if(st.cycles < 5 || st.threads < st.cycles || st.peakThreads == 0 || st.overflows != 0)
+         { printf("stats fail: cycles %lu threads %lu peak %lu overflows %lu\r\n",
+              (unsigned long)st.cycles, (unsigned long)st.threads, (unsigned long)st.peakThreads, (unsigned long)st.overflows); fails++; }
+
+      if(st.getMems != st.frees + 2 || st.getMemBytes == 0)      // All freed but the match list, which is 2 getMem()s.
+         { printf("stats fail: getMems %lu frees %lu\r\n", (unsigned long)st.getMems, (unsigned long)st.frees); fails++; }
+   }
+
+   RegexLT_S_Stats st2 = st;                                      // A 2nd call counts afresh.
+   RegexLT_MatchProgStats(prog, "aabcccde", &ml, _RegexLT_Flags_None, &st2);
+   if(st2.threads != st.threads || st2.getMems != st.getMems - 2) // This time the match list is reused.
+      { printf("stats fail: 2nd call threads %lu getMems %lu\r\n", (unsigned long)st2.threads, (unsigned long)st2.getMems); fails++; }
+
+   // No 'stats' is just RegexLT_MatchProg().
+   if(RegexLT_MatchProgStats(prog, "aabcccde", NULL, _RegexLT_Flags_None, NULL) != E_RegexRtn_Match)
+      { printf("stats fail: NULL stats\r\n"); fails++; }
+
+   RegexLT_FreeMatches(ml);
+   RegexLT_FreeProgram(prog);
+
+   // Explosive; removeDuplicateThreads() must fold some.
+   if(RegexLT_Compile("a{1,3}a{1,3}b", &prog) == E_RegexRtn_OK)
+   {
+      RegexLT_MatchProgStats(prog, "aaaaaaaab", NULL, _RegexLT_Flags_None, &st);   // (With the 'b'; without it there's no run.)
+      if(st.merges == 0)
+         { printf("stats fail: no merges\r\n"); fails++; }
+      RegexLT_FreeProgram(prog);
+   }
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+// ----------------------------------------- eof --------------------------------------------
@@ -0,0 +1,122 @@
+#include "libs_support.h"
+   #if _TARGET_IS == _TARGET_UNITY_TDD
+#include "unity.h"
+#define _TRACE_PRINTS_ON false
+   #else
+#define TEST_FAIL()
+#define _TRACE_PRINTS_ON true
+   #endif // _TARGET_IS
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "util.h"
+#include "regexlt_private.h"
+
+PUBLIC U16 tdd_TestNum;    // For labeling error messages with the test that failed.
+
+/* Thread lists, sized by the compiler for the most threads a program can have; and what
+   happens when one is too short.
+*/
+
+// =============================== Tests start here ==================================
+
+
+/* -------------------------------------- setUp ------------------------------------------- */
+
+PRIVATE void * getMem(size_t numBytes) { return calloc(1, numBytes); }
+PRIVATE void myFree(void *p) { free(p); }
+
+PRIVATE RegexLT_S_Cfg const cfg = {          // RegexLT_Init() keeps a pointer to this; so it's not on the stack.
+   .getMem        = getMem,
+   .free          = myFree,
+   .printEnable   = _TRACE_PRINTS_ON,
+   .maxSubmatches = 9,
+   .maxRegexLen   = MAX_U8,
+   .maxStrLen     = MAX_U8 };
+
+void setUp(void) {
+   RegexLT_Init(&cfg);
+}
+
+/* -------------------------------------- tearDown ------------------------------------------- */
+
+void tearDown(void) {
+}
+
+// -------------------------------- test_ThreadBound --------------------------------------
+
+/* The compiler bounds the thread lists; no match should need more. A program with no counted
+   repeats gets 2 threads per instruction, plus 1, at each place in the input it's threads can
+   be at; a Span, or a box in a loop, puts them at more than one. And a list too short for the
+   run fails it, rather than dropping threads.
+*/
+void test_ThreadBound(void)
+{
+   typedef struct { C8 const *regex; C8 const *src; } S_Tst;
+
+   S_Tst const tsts[] = {
+      { "abc",                   "xxabcxx" },
+      { "(a+)+b",                "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa" },
+      { "(a|a)*b",               "aaaaaaaaaaaaaaaaaaaaaaaaaaaaab" },
+      { "a{1,3}a{1,3}a{1,3}b",   "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa" },
+      { "(a{1,9}){1,9}c",        "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa" },
+      { "a{1,100}a{1,100}b",     "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa" },
+      { "(\\d{3})-(\\d{4})",     "call 555-1234 or 555-9876" },
+      { "[ac].+.?",              "1a b1ca  c1 " },
+      { "(ab)+c",                "1abababababaca1a 1b 1aaa 1cbaaaac1a1bbba" },
+   };
+
+   U8 i, fails = 0;
+   RegexLT_S_Stats st;
+   S_Program *prog;
+
+   for(i = 0; i < RECORDS_IN(tsts); i++)
+   {
+      S_Tst const *t = &tsts[i];
+      RegexLT_S_MatchList *ml = NULL;
+
+      if(RegexLT_Compile(t->regex, (void**)&prog) != E_RegexRtn_OK)
+      {
+         printf("bound fail #%u: \"%s\" didn't compile\r\n", i, t->regex);
+         fails++;
+         continue;
+      }
+
+      T_RegexRtn rtn = RegexLT_MatchProgStats(prog, t->src, &ml, _RegexLT_Flags_None, &st);
+
+      if(rtn == E_RegexRtn_RanTooLong || st.overflows != 0 || st.peakThreads > regexlt_threadsNeeded(&prog->instrs, strlen(t->src)))
+      {
+         printf("bound fail #%u: \"%s\" got %s, peak %lu of %u, %lu overflows\r\n",
+            i, t->regex, RegexLT_RtnStr(rtn), (unsigned long)st.peakThreads, regexlt_threadsNeeded(&prog->instrs, strlen(t->src)), (unsigned long)st.overflows);
+         fails++;
+      }
+      RegexLT_FreeMatches(ml);
+      RegexLT_FreeProgram(prog);
+   }
+
+   // No counts; so 2 per instruction.
+   if(RegexLT_Compile("ab*c", (void**)&prog) == E_RegexRtn_OK)
+   {
+      if(prog->instrs.maxThreads != 2 * prog->instrs.put + 1)
+         { printf("bound fail: 'ab*c' %u threads for %u instructions\r\n", prog->instrs.maxThreads, prog->instrs.put); fails++; }
+      RegexLT_FreeProgram(prog);
+   }
+
+   // Too short a list fails the run; it doesn't answer wrongly.
+   if(RegexLT_Compile("(a+)+b", (void**)&prog) == E_RegexRtn_OK)
+   {
+      prog->instrs.maxThreads = 2;
+      if(RegexLT_MatchProgStats(prog, "aaaaaaaaab", NULL, _RegexLT_Flags_None, &st) != E_RegexRtn_RanTooLong ||
+         st.overflows == 0 || st.getMems != st.frees)                // Dropped threads' matches are freed too.
+         { printf("bound fail: short list didn't fail the run\r\n"); fails++; }
+      RegexLT_FreeProgram(prog);
+   }
+
+   if(fails > 0)
+   {
+      TEST_FAIL();
+   }
+}
+
+// ----------------------------------------- eof --------------------------------------------